@@ -0,0 +1,74 @@
+/*
+ * @Description: In-process admin endpoint: metrics, pool state and control verbs
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_ADMIN_SERVER_H
+#define CONNECTION_POOL_ADMIN_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class connection_pool;
+
+/**
+ * Minimal HTTP/1.1 server on a unix domain socket ("unix:/run/app/pool.sock")
+ * or a loopback port ("9100" or "127.0.0.1:9100"), one request per connection.
+ *
+ *   GET  /metrics                               Prometheus text of every pool
+ *   GET  /pool                                  JSON snapshot of every pool and connection
+ *   POST /pool/resize?pool=NAME&maxSize=N[&initSize=N]
+ *   POST /pool/reserve?pool=NAME&reservedSize=N
+ *   POST /pool/drain?pool=NAME                  close idle connections, retire busy ones on return
+ *
+ * Requests are served on the server's own thread. Reads are not lock-free:
+ * the connection registry shards, the statement tables, the logger and, with
+ * lock profiling on, the pool lock itself are taken for the length of a copy,
+ * so a scrape can delay getconnection() by about that much. Control verbs
+ * lock the pool like any other caller
+ */
+class AdminServer
+{
+public:
+    explicit AdminServer(std::string address);
+    ~AdminServer();
+    AdminServer(const AdminServer &) = delete;
+    AdminServer &operator=(const AdminServer &) = delete;
+
+    // Pools are held weakly, a destroyed pool simply disappears from the output
+    void addPool(const std::shared_ptr<connection_pool> &pool);
+
+    // Bind and start serving, false (and logged) when the address is unusable
+    bool start();
+    void stop();
+
+    // Served path and body for one parsed request, exposed for tests
+    struct Response
+    {
+        int status;
+        std::string contentType;
+        std::string body;
+    };
+    Response handle(const std::string &method, const std::string &target);
+
+private:
+    void serve();
+    void serveClient(int fd);
+    std::vector<std::shared_ptr<connection_pool>> pools();
+
+    std::string _address;
+    std::string _unixPath; // unlinked on stop
+    int _listenFd = -1;
+    int _wakeFds[2] = {-1, -1}; // self pipe, stop() wakes poll
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+    std::mutex _poolsMutex;
+    std::vector<std::weak_ptr<connection_pool>> _pools;
+};
+
+#endif // CONNECTION_POOL_ADMIN_SERVER_H
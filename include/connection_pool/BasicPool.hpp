@@ -0,0 +1,769 @@
+/*
+* @Description: Generic policy based resource pool, connection_pool is one instantiation
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "PoolCounters.h"
+#include "ProfiledMutex.hpp"
+#include "SeqLock.hpp"
+
+/**
+ * basic_pool<Resource, Factory, Policies...>
+ *
+ * Factory (held by value, reachable through factory()):
+ *   std::unique_ptr<Resource> create();   nullptr when it cannot be created at all
+ *   bool validate(Resource&);             health check (ping)
+ *   bool repair(Resource&);               e.g. reconnect, false destroys it
+ *   bool reusable(const Resource&);       false drains it (opened with old settings...)
+ * A create that throws counts as nullptr, a validate or repair that throws as
+ * false, the pool never loses the slot
+ *
+ * Policies are given in any order, each one names its role; a role left out
+ * gets the default shown:
+ *   queue       pool_policy::fifo (default), lifo, selectable_order (runtime switch)
+ *   validation  pool_policy::never_validate (default), validate_on_borrow, configurable_validation
+ *   sizing      pool_policy::bounded_sizing (default, runtime), static_sizing<Min, Max, IdleSeconds>
+ *   waiter      pool_policy::blocking_waiters (default), fail_fast
+ *   observer    pool_policy::no_observer (default), event hooks for metrics and tracing
+ *   clock       pool_policy::steady_clock (default)
+ *
+ * Every policy call is resolved at compile time, no virtual dispatch. The lease
+ * deleter is a plain struct as well: acquire allocates nothing for it and the
+ * release is a direct call
+ */
+namespace pool_policy {
+
+struct queue_role {};
+struct validation_role {};
+struct sizing_role {};
+struct waiter_role {};
+struct observer_role {};
+struct clock_role {};
+
+// ---- Queue discipline: which idle resource a borrower gets
+
+template <bool Lifo>
+struct deque_discipline {
+    using role = queue_role;
+    template <typename T>
+    class container {
+    public:
+        void push(T&& item) { _items.push_back(std::move(item)); }
+        // FIFO takes the longest idle, LIFO the most recently returned
+        T pop() {
+            T item = std::move(Lifo ? _items.back() : _items.front());
+            Lifo ? _items.pop_back() : _items.pop_front();
+            return item;
+        }
+        bool empty() const { return _items.empty(); }
+        size_t size() const { return _items.size(); }
+        // Least recently returned first; pushing them back keeps the order
+        std::deque<T> take_all() { return std::exchange(_items, {}); }
+
+    private:
+        std::deque<T> _items;
+    };
+};
+using fifo = deque_discipline<false>;
+using lifo = deque_discipline<true>;
+
+// Either order, switched at runtime through basic_pool::configure_queue
+struct selectable_order {
+    using role = queue_role;
+    template <typename T>
+    class container {
+    public:
+        void set_lifo(bool lifo) { _lifo = lifo; }
+        bool lifo() const { return _lifo; }
+        void push(T&& item) { _items.push_back(std::move(item)); }
+        T pop() {
+            T item = std::move(_lifo ? _items.back() : _items.front());
+            _lifo ? _items.pop_back() : _items.pop_front();
+            return item;
+        }
+        bool empty() const { return _items.empty(); }
+        size_t size() const { return _items.size(); }
+        std::deque<T> take_all() { return std::exchange(_items, {}); }
+
+    private:
+        std::deque<T> _items;
+        bool _lifo = false; // guarded by the pool lock like _items
+    };
+};
+
+// ---- Validation: when Factory::validate runs
+
+struct never_validate {
+    using role = validation_role;
+    bool on_borrow(std::chrono::nanoseconds) const { return false; }
+    bool on_return() const { return false; }
+    bool on_scan() const { return false; }
+};
+
+struct validate_on_borrow {
+    using role = validation_role;
+    bool on_borrow(std::chrono::nanoseconds) const { return true; }
+    bool on_return() const { return false; }
+    bool on_scan() const { return true; }
+};
+
+// Adjustable at runtime: borrow check skipped for resources idle less than interval
+class configurable_validation {
+public:
+    using role = validation_role;
+    void set(bool onBorrow, std::chrono::nanoseconds interval, bool onReturn) {
+        _on_borrow = onBorrow;
+        _interval_ns = interval.count();
+        _on_return = onReturn;
+    }
+    bool on_borrow(std::chrono::nanoseconds idle) const { return _on_borrow && idle.count() >= _interval_ns; }
+    bool on_return() const { return _on_return; }
+    bool on_scan() const { return true; }
+
+private:
+    std::atomic<bool> _on_borrow{true};
+    std::atomic<int64_t> _interval_ns{0};
+    std::atomic<bool> _on_return{false};
+};
+
+// ---- Sizing: min kept open, max open, reserved for high priority, idle eviction
+
+class bounded_sizing {
+public:
+    using role = sizing_role;
+    void set(int minSize, int maxSize, int reserved, std::chrono::nanoseconds idleTimeout) {
+        _min = minSize;
+        _max = maxSize;
+        _reserved = reserved;
+        _idle_timeout_ns = idleTimeout.count();
+    }
+    int min_size() const { return _min; }
+    int max_size() const { return _max; }
+    int reserved() const { return _reserved; }
+    std::chrono::nanoseconds idle_timeout() const { return std::chrono::nanoseconds(_idle_timeout_ns.load()); }
+
+private:
+    std::atomic<int> _min{0};
+    std::atomic<int> _max{1};
+    std::atomic<int> _reserved{0};
+    std::atomic<int64_t> _idle_timeout_ns{std::chrono::nanoseconds(std::chrono::seconds(60)).count()};
+};
+
+template <int Min, int Max, int IdleSeconds = 60>
+struct static_sizing {
+    static_assert(0 <= Min && Min <= Max && Max > 0, "need 0 <= Min <= Max, Max > 0");
+    using role = sizing_role;
+    constexpr int min_size() const { return Min; }
+    constexpr int max_size() const { return Max; }
+    constexpr int reserved() const { return 0; }
+    constexpr std::chrono::nanoseconds idle_timeout() const { return std::chrono::seconds(IdleSeconds); }
+};
+
+// ---- Waiter strategy: what a borrower does when nothing is available
+
+class blocking_waiters {
+public:
+    using role = waiter_role;
+    // Lock is the pool's ProfiledLock, its waits keep the profile honest
+    template <typename Lock, typename Ready>
+    bool wait_for(Lock& lock, std::chrono::nanoseconds timeout, Ready ready) {
+        return lock.wait_for(_cv, timeout, ready);
+    }
+    void notify_all() { _cv.notify_all(); }
+
+private:
+    std::condition_variable _cv;
+};
+
+// Never blocks, acquire times out at once when nothing is idle
+struct fail_fast {
+    using role = waiter_role;
+    template <typename Lock, typename Ready>
+    bool wait_for(Lock&, std::chrono::nanoseconds, Ready ready) { return ready(); }
+    void notify_all() {}
+};
+
+// ---- Observer: hooks for metrics, logging and tracing, all no-ops by default
+
+enum class destroy_reason { stale, surplus, broken, idle, returned, drained, shutdown, abandoned };
+
+struct no_observer {
+    using role = observer_role;
+    template <typename R> void created(R&) {}
+    template <typename R> void destroyed(R&, destroy_reason) {}
+    template <typename R> void validated(R&, bool) {}
+    template <typename R> void repaired(R&, bool) {}
+    template <typename R> void acquired(R&, std::chrono::nanoseconds) {}
+    void timed_out(std::chrono::nanoseconds) {}
+    // Under the pool lock, right before the resource is requeued or destroyed
+    template <typename R> void released(R&, std::chrono::nanoseconds, bool) {}
+};
+
+struct steady_clock {
+    using role = clock_role;
+    using clock = std::chrono::steady_clock;
+    static clock::time_point now() { return clock::now(); }
+};
+
+} // namespace pool_policy
+
+namespace pool_detail {
+
+template <typename Role, typename Default, typename... Policies>
+struct select_policy {
+    using type = Default;
+};
+
+template <typename Role, typename Default, typename Policy, typename... Rest>
+struct select_policy<Role, Default, Policy, Rest...> {
+    using type = std::conditional_t<std::is_same<typename Policy::role, Role>::value, Policy,
+                                    typename select_policy<Role, Default, Rest...>::type>;
+};
+
+template <typename Role, typename... Policies>
+constexpr int count_role() {
+    return (0 + ... + (std::is_same<typename Policies::role, Role>::value ? 1 : 0));
+}
+
+} // namespace pool_detail
+
+template <typename Resource, typename Factory, typename... Policies>
+class basic_pool {
+    template <typename Role, typename Default>
+    using select = typename pool_detail::select_policy<Role, Default, Policies...>::type;
+
+public:
+    using queue_policy = select<pool_policy::queue_role, pool_policy::fifo>;
+    using validation_policy = select<pool_policy::validation_role, pool_policy::never_validate>;
+    using sizing_policy = select<pool_policy::sizing_role, pool_policy::bounded_sizing>;
+    using waiter_policy = select<pool_policy::waiter_role, pool_policy::blocking_waiters>;
+    using observer_policy = select<pool_policy::observer_role, pool_policy::no_observer>;
+    using clock_policy = select<pool_policy::clock_role, pool_policy::steady_clock>;
+    using time_point = typename clock_policy::clock::time_point;
+
+    // Gives the resource back to the pool, or deletes it once the pool is gone
+    struct lease_deleter {
+        basic_pool* pool = nullptr;
+        std::weak_ptr<void> alive;
+        time_point borrowed;
+
+        void operator()(Resource* r) const {
+            if (auto keep = alive.lock()) {
+                pool->release(r, borrowed);
+            } else {
+                delete r;
+            }
+        }
+    };
+    using lease = std::unique_ptr<Resource, lease_deleter>;
+    using destroy_reason = pool_policy::destroy_reason;
+
+    static_assert(sizeof...(Policies) ==
+                      pool_detail::count_role<pool_policy::queue_role, Policies...>() +
+                      pool_detail::count_role<pool_policy::validation_role, Policies...>() +
+                      pool_detail::count_role<pool_policy::sizing_role, Policies...>() +
+                      pool_detail::count_role<pool_policy::waiter_role, Policies...>() +
+                      pool_detail::count_role<pool_policy::observer_role, Policies...>() +
+                      pool_detail::count_role<pool_policy::clock_role, Policies...>(),
+                  "unknown policy role");
+
+    // high may use the sizing policy's reserved resources
+    enum class priority { normal, high };
+
+    explicit basic_pool(Factory factory = Factory(), observer_policy observer = observer_policy())
+        : _factory(std::move(factory)), _observer(std::move(observer)) {}
+
+    // Outstanding leases returned later are simply destroyed
+    ~basic_pool() {
+        stop();
+        std::weak_ptr<void> alive = _alive;
+        _alive.reset();
+        // Wait for release() calls that already saw the pool alive
+        while (!alive.expired()) std::this_thread::yield();
+    }
+
+    basic_pool(const basic_pool&) = delete;
+    basic_pool& operator=(const basic_pool&) = delete;
+
+    Factory& factory() { return _factory; }
+    validation_policy& validation() { return _validation; }
+    sizing_policy& sizing() { return _sizing; }
+    observer_policy& observer() { return _observer; }
+
+    // Open min_size resources, then keep the pool sized from two background
+    // threads: a grower (on demand, one at a time) and an idle evictor
+    void start() {
+        for (int i = 0; i < _sizing.min_size(); i++) {
+            _total++;
+            add(try_create());
+        }
+        _grower = std::thread([this] { grow_loop(); });
+        _evictor = std::thread([this] { evict_loop(); });
+    }
+
+    // Stop the threads, fail waiting borrowers and destroy idle resources
+    void stop() {
+        {
+            ProfiledLock lock(_mutex, "stop");
+            _shutdown = true;
+        }
+        _waiters.notify_all();
+        _maintenance.notify_all();
+        for (std::thread* t : {&_grower, &_evictor}) {
+            if (t->joinable() && t->get_id() != std::this_thread::get_id()) t->join();
+        }
+        ProfiledLock lock(_mutex, "stop");
+        destroy_idle(destroy_reason::shutdown);
+    }
+
+    bool stopped() const { return _shutdown; }
+
+    // Throws std::runtime_error after timeout or when the pool is stopped
+    lease acquire(priority p, std::chrono::nanoseconds timeout) {
+        time_point borrowed;
+        Resource* raw = acquire_raw(p, timeout, borrowed);
+        if (raw == nullptr) throw std::runtime_error("No available connections!");
+        return make_lease(raw, borrowed);
+    }
+
+    // Empty lease when nothing is available right now
+    lease try_acquire(priority p = priority::normal) {
+        time_point borrowed;
+        Resource* raw = acquire_raw(p, std::chrono::nanoseconds(0), borrowed);
+        return raw == nullptr ? lease() : make_lease(raw, borrowed);
+    }
+
+    // Runtime knobs of the idle container, e.g. selectable_order's set_lifo.
+    // Runs under the pool lock
+    template <typename F>
+    void configure_queue(F f) {
+        ProfiledLock lock(_mutex, "configure");
+        f(_idle);
+    }
+
+    // Wake the grower and waiting borrowers after a sizing change, if it
+    // gives them something to do
+    void notify() {
+        wakeup w;
+        {
+            ProfiledLock lock(_mutex, "notify");
+            w = pending_wakeup();
+        }
+        wake(w);
+    }
+
+    // Destroy every idle resource now
+    void clear_idle() {
+        wakeup w;
+        {
+            ProfiledLock lock(_mutex, "clear_idle");
+            destroy_idle(destroy_reason::drained);
+            w = pending_wakeup();
+        }
+        wake(w);
+    }
+
+    // One eviction pass: stale, surplus, broken and (above min_size) idle too long
+    void evict_idle() {
+        ProfiledLock lock(_mutex, "evict");
+        evict(lock);
+    }
+
+    // Create one resource if the pool needs one, the grower thread's step
+    bool grow_one() {
+        return reserve_growth() && add(try_create());
+    }
+
+    // Two-phase growth for callers that create resources themselves, e.g. a
+    // simulation on a virtual clock: reserve a slot when the sizing policy asks
+    // for one, then hand the result to add(). Reserved slots count against
+    // max_size, so concurrent creators never exceed it
+    bool reserve_growth() {
+        ProfiledLock lock(_mutex, "reserve");
+        if (_shutdown || !needs_growth()) return false;
+        _total++;
+        publish();
+        return true;
+    }
+
+    // Fill a reserved slot, nullptr gives it back. Create outside the pool
+    // lock (a network round trip for connections)
+    bool add(std::unique_ptr<Resource> r) {
+        if (!r) {
+            ProfiledLock lock(_mutex, "add");
+            _total--;
+            publish();
+            return false;
+        }
+        _observer.created(*r);
+        {
+            auto& shard = shard_of(r.get());
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.resources.insert(r.get());
+        }
+        bool waiting;
+        {
+            ProfiledLock lock(_mutex, "add");
+            _idle.push({std::move(r), clock_policy::now()});
+            publish();
+            waiting = _waiting > 0;
+        }
+        if (waiting) _waiters.notify_all();
+        return true;
+    }
+
+    // Stop counting a lent resource whose lease looks abandoned (leaked): its
+    // slot goes back to the pool so a replacement can be created, and the
+    // object itself is destroyed whenever the lease is finally released, the
+    // holder may still be using it. still_lent runs under the pool lock and
+    // confirms r is lent on the same lease that was judged abandoned
+    template <typename F>
+    bool abandon(const Resource* r, F still_lent) {
+        wakeup w;
+        {
+            ProfiledLock lock(_mutex, "abandon");
+            // Resources are only destroyed under the pool lock, a registered one is alive
+            if (_shutdown || _abandoned.count(r) > 0 || !registered(r) || !still_lent(*r)) return false;
+            _abandoned.insert(r);
+            _in_use--;
+            _total--;
+            publish();
+            w = pending_wakeup();
+        }
+        wake(w);
+        return true;
+    }
+
+    // Seqlock read, never takes the pool lock
+    PoolCounters counters() const { return _counters.load(); }
+
+    // Wait and hold times of the pool lock per call site, off by default
+    void set_lock_profiling(bool on) { _mutex.set_profiling(on); }
+    LockProfileSnapshot lock_profile() const { return _mutex.snapshot(); }
+
+    // Every live resource, idle or lent. Only create and destroy lock a shard,
+    // so this never stalls acquire or release
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto& shard : _registry) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const Resource* r : shard.resources) f(*r);
+        }
+    }
+
+private:
+    struct idle_entry {
+        std::unique_ptr<Resource> resource;
+        time_point since; // returned or created
+    };
+    struct registry_shard {
+        mutable std::mutex mutex;
+        std::unordered_set<const Resource*> resources;
+    };
+    static constexpr size_t kRegistryShards = 16;
+    static constexpr std::chrono::milliseconds kCreateRetry{100};
+
+    registry_shard& shard_of(const Resource* r) const {
+        return _registry[(reinterpret_cast<uintptr_t>(r) >> 6) % kRegistryShards];
+    }
+
+    bool registered(const Resource* r) const {
+        auto& shard = shard_of(r);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.resources.count(r) > 0;
+    }
+
+    bool available(priority p) const {
+        return !_idle.empty() && (p == priority::high || _in_use < _sizing.max_size() - _sizing.reserved());
+    }
+
+    // Grow when borrowers emptied the queue, or back up to min_size (e.g. after
+    // the sizing changed or stale resources were drained). Resources out for
+    // an eviction check come back, they don't leave the queue empty
+    bool needs_growth() const {
+        return (_idle.empty() && _checking == 0 && _total < _sizing.max_size()) || _total < _sizing.min_size();
+    }
+
+    // Who a state change should wake, taken under _mutex and notified once it
+    // is released. Nobody is woken just to find nothing to do
+    struct wakeup {
+        bool grower = false;
+        bool waiters = false;
+    };
+
+    // Caller holds _mutex
+    wakeup pending_wakeup() const { return {needs_growth(), _waiting > 0}; }
+
+    void wake(wakeup w) {
+        if (w.grower) _maintenance.notify_all();
+        if (w.waiters) _waiters.notify_all();
+    }
+
+    // Caller holds _mutex
+    void publish() {
+        PoolCounters c;
+        c.idle = static_cast<int32_t>(_idle.size());
+        c.inUse = _in_use;
+        c.waiters = _waiting;
+        c.total = _total.load();
+        c.creating = std::max(0, c.total - c.idle - c.inUse - _checking);
+        _counters.store(c);
+    }
+
+    // Unregister, destroy and uncount
+    void destroy(std::unique_ptr<Resource> r, destroy_reason reason) {
+        {
+            auto& shard = shard_of(r.get());
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.resources.erase(r.get());
+        }
+        _observer.destroyed(*r, reason);
+        r.reset();
+        _total--;
+    }
+
+    // A throwing factory counts as a failed create, add() gives the slot back
+    std::unique_ptr<Resource> try_create() {
+        try {
+            return _factory.create();
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    // A throwing check counts as a broken resource, the caller destroys it and
+    // gives its slot back
+    bool try_validate(Resource& r) {
+        try {
+            return _factory.validate(r);
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool try_repair(Resource& r) {
+        try {
+            return _factory.repair(r);
+        } catch (...) {
+            return false;
+        }
+    }
+
+    // Caller holds _mutex
+    void destroy_idle(destroy_reason reason) {
+        while (!_idle.empty()) destroy(std::move(_idle.pop().resource), reason);
+        publish();
+    }
+
+    Resource* acquire_raw(priority p, std::chrono::nanoseconds timeout, time_point& borrowed) {
+        auto start = clock_policy::now();
+        auto deadline = start + std::chrono::duration_cast<typename clock_policy::clock::duration>(timeout);
+        ProfiledLock lock(_mutex, "acquire");
+        for (;;) {
+            if (_shutdown) throw std::runtime_error("Connection pool is shut down!");
+            if (!available(p)) {
+                if (needs_growth()) _maintenance.notify_all(); // wake grower
+                _waiting++;
+                publish();
+                bool ready = _waiters.wait_for(lock, deadline - clock_policy::now(),
+                                               [this, p] { return _shutdown || available(p); });
+                _waiting--;
+                if (_shutdown) throw std::runtime_error("Connection pool is shut down!");
+                if (!ready) {
+                    publish();
+                    _observer.timed_out(clock_policy::now() - start);
+                    return nullptr;
+                }
+            }
+            idle_entry entry = _idle.pop();
+            _in_use++;
+            publish();
+            // Validation is a network round trip, never under the pool lock
+            lock.unlock();
+            auto now = clock_policy::now();
+            Resource& r = *entry.resource;
+            bool valid = true;
+            if (_validation.on_borrow(now - entry.since)) {
+                valid = try_validate(r);
+                _observer.validated(r, valid);
+            }
+            if (!valid) {
+                bool repaired = try_repair(r);
+                _observer.repaired(r, repaired);
+                if (!repaired) {
+                    lock.lock();
+                    _in_use--;
+                    destroy(std::move(entry.resource), destroy_reason::broken);
+                    publish();
+                    if (needs_growth()) _maintenance.notify_all();
+                    continue;
+                }
+            }
+            borrowed = clock_policy::now();
+            _observer.acquired(r, borrowed - start);
+            return entry.resource.release();
+        }
+    }
+
+    lease make_lease(Resource* raw, time_point borrowed) {
+        return lease(raw, lease_deleter{this, _alive, borrowed});
+    }
+
+    void release(Resource* raw, time_point borrowed) {
+        std::unique_ptr<Resource> r(raw);
+        auto now = clock_policy::now();
+        bool valid = true;
+        if (_validation.on_return()) {
+            valid = try_validate(*r);
+            _observer.validated(*r, valid);
+        }
+        valid = valid && _factory.reusable(*r);
+        wakeup w;
+        {
+            ProfiledLock lock(_mutex, "release");
+            bool abandoned = _abandoned.erase(r.get()) > 0;
+            if (abandoned) {
+                // abandon() already uncounted it
+                _in_use++;
+                _total++;
+            }
+            _in_use--;
+            // Destroy instead of requeue when it is broken or stale, the pool is
+            // stopping, or it was shrunk below its current size
+            bool requeue = valid && !abandoned && !_shutdown && _total <= _sizing.max_size();
+            _observer.released(*r, now - borrowed, requeue);
+            if (requeue) {
+                _idle.push({std::move(r), now});
+            } else {
+                destroy(std::move(r), abandoned ? destroy_reason::abandoned : destroy_reason::returned);
+            }
+            publish();
+            w = pending_wakeup();
+        }
+        wake(w);
+    }
+
+    void grow_loop() {
+        while (!_shutdown) {
+            ProfiledLock lock(_mutex, "grow");
+            // Predicate protects against spurious wakeup
+            lock.wait(_maintenance, [this] { return _shutdown || needs_growth(); });
+            if (_shutdown) break;
+            _total++;
+            publish();
+            lock.unlock();
+            if (!add(try_create())) {
+                // Don't spin on a factory that keeps failing
+                lock.lock();
+                lock.wait_for(_maintenance, kCreateRetry, [this] { return _shutdown.load(); });
+            }
+        }
+    }
+
+    void evict_loop() {
+        while (!_shutdown) {
+            ProfiledLock lock(_mutex, "evict");
+            // Sleep one idle timeout, but wake up at once on shutdown
+            lock.wait_for(_maintenance, _sizing.idle_timeout(), [this] { return _shutdown.load(); });
+            if (_shutdown) break;
+            evict(lock);
+        }
+    }
+
+    // Caller holds lock. Resources due for a scan validation leave the queue
+    // and are checked with the lock released, like on borrow
+    void evict(ProfiledLock& lock) {
+        auto now = clock_policy::now();
+        auto entries = _idle.take_all();
+        std::vector<idle_entry> checked;
+        for (auto& entry : entries) {
+            if (!_factory.reusable(*entry.resource)) {
+                destroy(std::move(entry.resource), destroy_reason::stale);
+            } else if (_total > _sizing.max_size()) {
+                destroy(std::move(entry.resource), destroy_reason::surplus);
+            } else if (_validation.on_scan()) {
+                checked.push_back(std::move(entry));
+            } else {
+                keep_or_retire(std::move(entry), now);
+            }
+        }
+        if (!checked.empty()) {
+            _checking += static_cast<int>(checked.size());
+            publish();
+            lock.unlock();
+            std::vector<bool> broken(checked.size(), false);
+            for (size_t i = 0; i < checked.size(); i++) {
+                Resource& r = *checked[i].resource;
+                bool valid = try_validate(r);
+                _observer.validated(r, valid);
+                if (!valid) {
+                    bool repaired = try_repair(r);
+                    _observer.repaired(r, repaired);
+                    broken[i] = !repaired;
+                }
+            }
+            lock.lock();
+            _checking -= static_cast<int>(checked.size());
+            for (size_t i = 0; i < checked.size(); i++) {
+                if (broken[i]) {
+                    destroy(std::move(checked[i].resource), destroy_reason::broken);
+                } else if (_shutdown) {
+                    destroy(std::move(checked[i].resource), destroy_reason::shutdown);
+                } else if (_total > _sizing.max_size()) {
+                    destroy(std::move(checked[i].resource), destroy_reason::surplus);
+                } else {
+                    keep_or_retire(std::move(checked[i]), now);
+                }
+            }
+            if (_waiting > 0) _waiters.notify_all();
+        }
+        publish();
+        // Below min_size, let the grower refill
+        if (_total < _sizing.min_size()) _maintenance.notify_all();
+    }
+
+    // Caller holds _mutex
+    void keep_or_retire(idle_entry entry, time_point now) {
+        if (now - entry.since >= _sizing.idle_timeout() && _total > _sizing.min_size()) {
+            destroy(std::move(entry.resource), destroy_reason::idle);
+        } else {
+            _idle.push(std::move(entry));
+        }
+    }
+
+    Factory _factory;
+    validation_policy _validation;
+    sizing_policy _sizing;
+    waiter_policy _waiters;
+    observer_policy _observer;
+
+    ProfiledMutex _mutex{"pool"}; // guards _idle, _in_use, _waiting, _checking, _abandoned
+    typename queue_policy::template container<idle_entry> _idle;
+    int _in_use = 0;
+    int _waiting = 0;
+    int _checking = 0; // taken out of _idle by evict() for validation
+    std::atomic<int> _total{0}; // idle + in use + being created
+    std::atomic<bool> _shutdown{false};
+    std::unordered_set<const Resource*> _abandoned; // lent but no longer counted, see abandon()
+    std::condition_variable _maintenance; // wakes grower and evictor
+    SeqLock<PoolCounters> _counters;
+    mutable registry_shard _registry[kRegistryShards];
+    std::shared_ptr<void> _alive = std::make_shared<int>(0); // leases check it before release
+    std::thread _grower;
+    std::thread _evictor;
+};
@@ -0,0 +1,101 @@
+/*
+ * @Description: Typed connection pool settings, published as an immutable snapshot
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_CONFIG_H
+#define CONNECTION_POOL_CONFIG_H
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Every problem found while loading, reported at once
+class ConfigError : public std::runtime_error
+{
+public:
+    explicit ConfigError(std::vector<std::string> errors);
+    const std::vector<std::string> &errors() const { return _errors; }
+
+private:
+    std::vector<std::string> _errors;
+};
+
+/**
+ * All pool tuning knobs. Loaded once per (re)load through createConfigManager,
+ * so the same keys work in INI and YAML, then overridden by environment
+ * variables CONNECTION_POOL_<KEY> (e.g. CONNECTION_POOL_MAX_SIZE=64).
+ *
+ * Durations accept a unit suffix (us, ms, s, m, h). A bare number uses the unit
+ * shown next to the field, which is what older config files assume.
+ */
+struct PoolConfig
+{
+    std::string name = "default"; // "pool" label in metrics and the admin endpoint
+
+    // Backend
+    std::string driver = "mysql"; // registered driver name, see Driver.h
+    std::string ip = "localhost";
+    unsigned short port = 3306;
+    std::string username = "root";
+    std::string password;
+    std::string dbname = "test";
+
+    // Sizing
+    int initSize = 5;          // connection pool initial size
+    int maxSize = 10;          // connection pool max size
+    int reservedSize = 0;      // connections only high priority borrowers may take
+    // Which idle connection a borrower gets. FIFO rotates through all of them,
+    // LIFO reuses the most recently returned so surplus ones go idle and are evicted
+    enum class IdleOrder { FIFO, LIFO };
+    IdleOrder idleOrder = IdleOrder::FIFO;
+
+    // Timeouts
+    std::chrono::seconds maxIdleTime{60};             // connection max idle time, bare number = s
+    std::chrono::milliseconds connectionTimeout{100}; // time out for obtaining connection, bare number = ms
+    std::chrono::seconds connectTimeout{10};          // time out for opening a connection, bare number = s
+
+    // Validation policy
+    bool validateOnBorrow = true;
+    std::chrono::milliseconds validationInterval{500}; // skip the borrow ping if used this recently, bare number = ms
+    bool validateOnReturn = false;
+
+    // Diagnostics
+    std::string traceFile; // capture borrows and statements for pool_replay, empty = off
+    bool profileLocks = false; // wait/hold histograms of the pool and logger locks in metrics
+
+    // Leak detection: leases held longer than the threshold are logged and counted
+    std::chrono::milliseconds leakDetectionThreshold{0}; // 0 = off, bare number = ms
+    int leakStackSampling = 100;                         // capture the borrow stack on 1 in N borrows, 0 = never
+    std::chrono::milliseconds leakReclaimTimeout{0};     // then give the slot back after this, 0 = never, bare number = ms
+    int queryTimingSampling = 0; // latency breakdown of 1 in N statements per fingerprint, 0 = off
+    bool statementStats = false; // calls, latency, rows, bytes and errors of every statement per fingerprint
+    std::chrono::milliseconds slowQueryThreshold{0}; // log statements this slow, 0 = off, bare number = ms
+    int slowQueryExplainSampling = 10;               // attach EXPLAIN FORMAT=JSON to 1 in N of them, 0 = never
+    std::string slowQueryLog = "slow_query.log";     // rotating file, written only while the threshold is set
+
+    // Result memory: bytes of buffered results callers hold, pool wide. Past
+    // the budget a buffered select waits up to connectionTimeout, runs
+    // streamed, or fails
+    uint64_t resultMemoryBudget = 0; // 0 = no limit nor accounting, bare number = bytes, K/M/G suffixes
+    enum class ResultMemoryPolicy { WAIT, STREAM, FAIL };
+    ResultMemoryPolicy resultMemoryPolicy = ResultMemoryPolicy::WAIT;
+
+    // Connections opened with other credentials must be drained
+    bool sameEndpoint(const PoolConfig &other) const
+    {
+        return driver == other.driver && ip == other.ip && port == other.port &&
+               username == other.username && password == other.password && dbname == other.dbname;
+    }
+
+    // Empty when the settings are usable
+    std::vector<std::string> validate() const;
+
+    // Parse filename (INI or YAML by extension), apply environment overrides and
+    // validate. Throws ConfigError listing every bad key or value
+    static PoolConfig load(const std::string &filename);
+};
+
+#endif // CONNECTION_POOL_CONFIG_H
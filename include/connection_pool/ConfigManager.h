@@ -3,6 +3,7 @@
 
 #include<string>
 #include<memory>
+#include<vector>
 
 class ConfigManager{
     public:
@@ -11,8 +12,12 @@ class ConfigManager{
         virtual std::string getString(const std::string& key, const std::string& defaultValue="") = 0;
         virtual int getInt(const std::string& key, int defaultValue = 0) = 0;
         virtual bool getBool(const std::string& key, bool defaultValue = false) = 0;
+        virtual bool hasKey(const std::string& key) = 0;
+        // Every top level key, used to reject unknown (usually misspelled) keys.
+        // A key set twice in the file is listed twice
+        virtual std::vector<std::string> keys() = 0;
 };
 
 std::unique_ptr<ConfigManager> createConfigManager(const std::string& filename);
 
-#endif //CONFIG_MANAGER_H
\ No newline at end of file
+#endif //CONFIG_MANAGER_H
@@ -2,19 +2,32 @@
 * @Description: MYSQL connection manager
 * @Author: abellli
 * @Date: 2025-09-16
-* @LastEditTime: 2025-09-16
+* @LastEditTime: 2026-10-17
 */
 #ifndef CONNECTION_POOL_CONNECTION_H
 #define CONNECTION_POOL_CONNECTION_H
 #include "iostream"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mysql/mysql.h>
+#include "Driver.h"
+#include "LeakDetector.h"
 #include "Logger.hpp"
+#include "QueryProfiler.h"
+#include "ResultMemory.h"
+#include "RowStream.h"
+#include "SlowQueryLog.h"
+#include "StatementStats.h"
+#include "SteadyClock.hpp"
 using namespace std;
 
 class connection
 {
 public:
-    connection();
+    connection(); // mysql driver
+    explicit connection(std::shared_ptr<Driver> driver);
     ~connection();
     bool connect(string ip,
                  unsigned short port,
@@ -22,15 +35,83 @@ public:
                  string dbname);
     bool reconnect(string ip, unsigned short port, 
                   string user, string password, string dbname);
-    void refreshsAliveTime(){ _alivetime = clock();}
-    clock_t  getAliveTime() const {return clock() - _alivetime;}
+    // Idle time is wall time, clock() only counts cpu time of the process
+    void refreshsAliveTime(){ _alivetime = steadyUs();}
+    long getAliveTime() const { return static_cast<long>((steadyUs() - _alivetime) / 1000); } // ms since last refresh
+    // Lease state, read concurrently by connection_pool::snapshot
+    void markBorrowed(){
+        _borrowedAt = steadyUs();
+        _borrows.fetch_add(1, std::memory_order_relaxed);
+        _borrowThread = currentThreadId();
+    }
+    void markReturned(){ _borrowedAt = 0;}
+    bool inUse() const { return _borrowedAt != 0; }
+    int64_t getHoldTimeUs() const { return inUse() ? steadyUs() - _borrowedAt : 0; } // us since borrowed
+    long getHoldTime() const { return static_cast<long>(getHoldTimeUs() / 1000); } // ms since borrowed
+    // Leak detection: borrow number, borrowing thread and, for sampled borrows, its stack
+    uint64_t getBorrowCount() const { return _borrows.load(std::memory_order_relaxed); }
+    uint32_t getBorrowThread() const { return _borrowThread; }
+    // Sampled latency breakdown, see QueryProfiler. The acquire wait is charged
+    // to the first statement of the lease
+    void setProfiler(std::shared_ptr<QueryProfiler> profiler){ _profiler = std::move(profiler);}
+    void setAcquireWait(int64_t waitUs){ _acquireWaitUs = waitUs;}
+    // Per fingerprint totals of every statement, see StatementStats
+    void setStatementStats(std::shared_ptr<StatementStats> stats){ _stats = std::move(stats);}
+    // Statements over slowQueryThreshold, see SlowQueryLog
+    void setSlowQueryLog(std::shared_ptr<SlowQueryLog> log){ _slowLog = std::move(log);}
+    // Buffered selects are charged here and admitted against its budget
+    void setResultMemory(std::shared_ptr<ResultMemory> memory){ _memory = std::move(memory);}
+    int64_t getPingTimeUs() const { return _pingUs.load(std::memory_order_relaxed); } // smoothed, 0 before the first ping
+    void setBorrowSite(std::shared_ptr<const BorrowSite> site){ std::atomic_store(&_borrowSite, std::move(site));}
+    // nullptr unless the current lease was sampled
+    std::shared_ptr<const BorrowSite> getBorrowSite() const {
+        auto site = std::atomic_load(&_borrowSite);
+        return site && site->lease == getBorrowCount() ? site : nullptr;
+    }
+    long getAge() const { return static_cast<long>((steadyUs() - _openedAt) / 1000); } // ms since opened
+    // Statements sent on this connection, for per-connection metrics
+    uint64_t getQueryCount() const { return _queries.load(std::memory_order_relaxed); }
+    // Config generation the connection was opened with, stale ones are drained
+    void setGeneration(uint64_t generation){ _generation = generation;}
+    uint64_t getGeneration() const {return _generation;}
+    // Applied to connect and every later reconnect
+    void setConnectTimeout(unsigned int seconds);
     bool isValid(int timeout=30);
     bool update(string sql);
+    // mysql driver only (nullptr otherwise), caller frees the streamed result
     MYSQL_RES* query(string sql);
+    // Any driver. stream keeps the connection busy until the result is destroyed
+    std::unique_ptr<ResultSet> select(const string& sql, bool stream = false);
+    // Streamed select read ahead on a reader thread while onRow runs here on
+    // the next rows, see RowStream. Returns once the rows are read or onRow
+    // stopped them, the lease is held and the connection busy until then
+    RowStream::Status queryStream(const string& sql, const RowStream::Callback& onRow);
+    const char* driverName() const { return _driver->name(); }
+    // value as a string literal for this session, see DriverConnection::quote
+    std::string quote(const string& value) { return _session->quote(value); }
     
 private:
-    MYSQL* _conn; // MYSQL connection
-    clock_t _alivetime; // Alive time
+    // Span of a sampled statement sent at start and answered at end (steadyUs())
+    QuerySpan makeSpan(const string& sql, int64_t waitUs, int64_t start, int64_t end, bool ok, uint64_t rows) const;
+    // Same statement to the slow query log, with the calling thread's stack
+    void logSlow(const string& sql, int64_t waitUs, int64_t start, int64_t end, bool ok, uint64_t rows) const;
+    std::shared_ptr<Driver> _driver;
+    std::unique_ptr<DriverConnection> _session;
+    // steady clock us, atomics so introspection can read them without the pool lock
+    std::atomic<int64_t> _alivetime{steadyUs()}; // Alive time
+    std::atomic<int64_t> _openedAt{steadyUs()};
+    std::atomic<int64_t> _borrowedAt{0};      // 0 while idle
+    std::atomic<uint64_t> _queries{0};        // only the borrower writes, relaxed is enough
+    std::atomic<uint64_t> _generation{0};
+    std::atomic<uint64_t> _borrows{0};
+    std::atomic<uint32_t> _borrowThread{0};
+    std::shared_ptr<const BorrowSite> _borrowSite; // std::atomic_load/store, replaced by sampled borrows only
+    std::shared_ptr<QueryProfiler> _profiler;      // nullptr outside a pool
+    std::shared_ptr<StatementStats> _stats;        // nullptr outside a pool
+    std::shared_ptr<SlowQueryLog> _slowLog;        // nullptr outside a pool
+    std::shared_ptr<ResultMemory> _memory;         // nullptr outside a pool
+    int64_t _acquireWaitUs = 0;                    // borrower only, consumed by the first timed statement
+    std::atomic<int64_t> _pingUs{0};
 };
 
 #endif //CONNECTION_POOL_CONNECTION_H
@@ -2,66 +2,186 @@
  * @Description: Connection pool
  * @Author: abellli
  * @Date: 2025-09-16
- * @LastEditTime: 2025-09-16
+ * @LastEditTime: 2026-10-17
  */
 #ifndef CONNECTION_POOL_CONNECT_POOL_H
 #define CONNECTION_POOL_CONNECT_POOL_H
 
 #include <string>
-#include <queue>
 #include <memory>
 #include "mutex"
 #include "functional"
 #include "atomic"
 #include "thread"
-#include "condition_variable"
+#include <csignal>
+#include <condition_variable>
+#include <vector>
 
+#include "BasicPool.hpp"
+#include "Config.h"
 #include "Connection.h"
 #include "ConfigManager.h"
+#include "LeakDetector.h"
+#include "PoolMetrics.h"
+
+struct PoolSnapshot
+{
+    PoolCounters counters;
+    std::shared_ptr<const PoolConfig> config;
+    std::vector<ConnectionInfo> connections; // each registry shard is read consistently
+};
 
 class connection_pool : public std::enable_shared_from_this<connection_pool>
 {
-using PooledConnection = std::unique_ptr<connection, std::function<void(connection*)>>;
+    // Opens connections with the current config and driver, reconnects broken
+    // ones and tells connections opened with old credentials apart
+    struct ConnectionFactory
+    {
+        connection_pool *pool;
+        std::unique_ptr<connection> create();
+        // Connected with the current config but outside the pool: no
+        // generation and no statement hooks, e.g. for EXPLAIN
+        std::unique_ptr<connection> open();
+        bool validate(connection &conn);
+        bool repair(connection &conn);
+        bool reusable(const connection &conn) const;
+    };
+
+    // Metrics, flight recorder, probes and logs for every pool event
+    struct ConnectionObserver
+    {
+        using role = pool_policy::observer_role;
+        connection_pool *pool;
+        void created(connection &) {}
+        void destroyed(connection &conn, pool_policy::destroy_reason reason);
+        void validated(connection &conn, bool ok);
+        void repaired(connection &conn, bool ok);
+        void acquired(connection &conn, std::chrono::nanoseconds waited);
+        void timed_out(std::chrono::nanoseconds waited);
+        void released(connection &conn, std::chrono::nanoseconds held, bool requeued);
+    };
+
+    using Pool = basic_pool<connection, ConnectionFactory,
+                            pool_policy::selectable_order,
+                            pool_policy::configurable_validation,
+                            pool_policy::bounded_sizing,
+                            pool_policy::blocking_waiters,
+                            ConnectionObserver>;
+
+    // Leases return the connection through a plain deleter, nothing allocated per borrow
+    using PooledConnection = Pool::lease;
+
 public:
+    // HIGH may use the reservedSize connections NORMAL borrowers must leave idle
+    enum class Priority { NORMAL, HIGH };
+
+    // Process wide pool configured from CONNECTION_POOL_CONFIG (default db_config.ini)
     static std::shared_ptr<connection_pool> getconnect_pool();
-    PooledConnection getconnection();
+    // Independent pool without a config file (no file watching or reload).
+    // driver overrides the one named by config.driver, e.g. a tuned FakeDriver.
+    // Throws ConfigError when config is invalid
+    static std::shared_ptr<connection_pool> create(const PoolConfig &config, std::shared_ptr<Driver> driver = nullptr);
+    PooledConnection getconnection(Priority priority = Priority::NORMAL);
     ~connection_pool();
 
+    // Parse and validate the config file on the calling thread, then publish and
+    // apply it to the live pool. Old settings stay in place when it fails
+    bool reloadConfig();
+
+    // Request a reload from a signal handler, served by the config watcher thread
+    static void installReloadSignal(int signo = SIGHUP);
+
+    // Current settings, an immutable snapshot swapped as a whole on reload
+    std::shared_ptr<const PoolConfig> config() const { return std::atomic_load(&_config); }
+
+    // Runtime tuning for a control plane. Each call is validated like a config
+    // file and published as a new snapshot, throws ConfigError when rejected.
+    // A later reload of the config file replaces these values
+    void updateConfig(const std::function<void(PoolConfig &)> &edit);
+    void setMaxSize(int maxSize);
+    void setMaxIdleTime(std::chrono::seconds maxIdleTime);
+    void setValidationInterval(std::chrono::milliseconds validationInterval);
+    void setReservedSize(int reservedSize);
+
+    // Close every idle connection now and the borrowed ones when returned,
+    // the producer then refills the pool to initSize with fresh connections
+    void drain();
+
+    // Counters only: a seqlock read, never takes the pool lock
+    PoolCounters counters() const { return _pool.counters(); }
+    // Counters plus every live connection. Walks the connection registry, which
+    // borrow and return never lock, so borrowers are not stalled
+    PoolSnapshot snapshot() const;
+
+    // Counters, latency histograms and gauges, see renderPrometheus/renderJson
+    PoolMetricsSnapshot metrics() const;
+    const std::string &name() const { return _name; }
+
+    // Leases held longer than leakDetectionThreshold right now, empty when it is off
+    std::vector<LeakReport> leaks() const;
+
+    // Every statement timed under queryTimingSampling, e.g. to export it as a
+    // tracing span. Runs on the thread that finished the statement, keep it
+    // short; an empty function removes it
+    void setQuerySpanCallback(QueryProfiler::Callback callback) { _queryProfiler->setCallback(std::move(callback)); }
+    // Fingerprints in metrics().queryTimings
+    static constexpr size_t kTopFingerprints = 20;
+
+    // Statement table while statementStats is on, most total time first.
+    // metrics().statements holds the first kTopStatements
+    std::vector<StatementStat> statementStats(size_t limit = StatementStats::kMaxStatements) const {
+        return _statementStats->top(limit);
+    }
+    void resetStatementStats() { _statementStats->reset(); }
+    static constexpr size_t kTopStatements = 50;
+
+    // Write the slow query log somewhere else than the slowQueryLog file, e.g.
+    // a RingSink or SyslogSink; nullptr goes back to the file
+    void setSlowQuerySink(std::shared_ptr<LogSink> sink);
+
 private:
-    connection_pool(); // Singleton connection pool
+    connection_pool(std::string configFile, std::shared_ptr<Driver> driver);
+    // Open initSize connections and start the background threads
+    void start();
     connection_pool(const connection_pool &) = delete;
     connection_pool &operator=(const connection_pool &) = delete;
-    bool loadConfigFile(const std::string &filename = "");
+    void applyConfig(std::shared_ptr<const PoolConfig> config);
 
-    // Runs in a separate thread, specifically responsible for generating new connections
-    void produceConnectionTask();
+    // Watch the config file with inotify and serve reload signals
+    void watchConfigTask();
 
-    // Start a new thread to scan for excess idle connections, idle connections that exceed maxIdleTime, and recycle excess connections
-    void scanRunningConnectionTask();
+    // Report leases held past leakDetectionThreshold once each, reclaim them
+    // after leakReclaimTimeout
+    void leakScanTask();
+    // Leases past leakDetectionThreshold with their borrow sites, not symbolized
+    std::vector<std::pair<LeakReport, std::shared_ptr<const BorrowSite>>> findLeaks() const;
 
     // Safely shutdown connection pool
     void shutdown();
-    string _ip;
-    unsigned short _port;
-    string _username;
-    string _password;
-    string _dbname;
-    int _initSize;          // connection pool initial size
-    int _maxSize;           // connection pool max size
-    int _maxIdleTime;       // connection max idle time
-    int _connectionTimeout; // time out for obtaining connection
-
-    std::queue<std::unique_ptr<connection>> _connectionQue; // queue to save connection
-    // bool mutex, allow entry multiple times, only release same times as entrying, lock are really released，depend on inner counter
-    // Ownership semantic, only tasks have mutex can release
-    // Will upgrade thread priority who owner mutex when higher priority task occpy cpu, in case of higher priority task blocking
-    // depends on RTOS(FreeRTOS, uCOS-III)
-    // Inner task manager contains pointer of task, inner method can take task off original priority list
-    // and add to new, so do recovering
-    std::mutex _queueMutex; 
-    std::atomic_int _connectionCnt; // number of active connection
+
+    std::string _name = "default"; // "pool" label in metrics, fixed at construction
+    std::string _configFile;
+    std::shared_ptr<const PoolConfig> _config; // only accessed through std::atomic_load/store
+    std::shared_ptr<Driver> _driver;           // same, replaced when a reload changes driver
+    const bool _driverSupplied;                // by the caller, never replaced by a reload
+    // Hot path copy of _config, the rest lives in the pool's sizing and validation policies
+    std::atomic_int _connectionTimeout; // time out for obtaining connection, ms
+    std::atomic<uint64_t> _generation;  // bumped when credentials or endpoint change
+    std::atomic_int _leakStackSampling{0}; // 0 also while leak detection is off
+    PoolMetrics _metrics;
+    std::shared_ptr<QueryProfiler> _queryProfiler = std::make_shared<QueryProfiler>(); // shared with the connections
+    std::shared_ptr<StatementStats> _statementStats = std::make_shared<StatementStats>(); // shared with the connections
+    std::shared_ptr<SlowQueryLog> _slowQueryLog; // same, created with the first config since it needs the name
+    std::shared_ptr<ResultMemory> _resultMemory = std::make_shared<ResultMemory>(); // shared with the connections
+
     std::atomic<bool> _shutdown; // shutdown flag
-    std::condition_variable cv;     // communication between producers and consumers
+    std::mutex _reloadMutex;     // serializes reloads
+    std::thread _watcher;
+    std::thread _leakScanner;
+    std::mutex _leakMutex;              // only for _leakWake
+    std::condition_variable _leakWake;  // cuts the scanner's sleep short on shutdown
+    // Declared last: destroyed first, while the members its hooks use are alive
+    Pool _pool;
 };
 
 #endif // CONNECTION_POOL_CONNECT_POOL_H
@@ -0,0 +1,104 @@
+/*
+ * @Description: Database driver interface under connection
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_DRIVER_H
+#define CONNECTION_POOL_DRIVER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Rows of one statement, read front to back. Field pointers are valid until next()
+class ResultSet
+{
+public:
+    virtual ~ResultSet() = default;
+    // Advance to the next row, false at the end
+    virtual bool next() = 0;
+    virtual unsigned int fieldCount() const = 0;
+    // nullptr for SQL NULL
+    virtual const char *field(unsigned int index) const = 0;
+    virtual unsigned long fieldLength(unsigned int index) const = 0;
+    // Rows of a buffered result, 0 when not known up front (streamed)
+    virtual uint64_t rowCount() const { return 0; }
+    // Client memory held by a buffered result: field data plus a pointer and a
+    // terminator per field. 0 for streamed results and drivers that don't know
+    virtual uint64_t memoryBytes() const { return 0; }
+    // A streamed fetch that broke off (connection lost, server error), true
+    // once next() returned false because of it rather than the end of the rows
+    virtual bool failed() const { return false; }
+};
+
+/**
+ * Base of the wrappers that watch a driver's rows on their way to the caller
+ * (statement stats, query timing, result memory). Everything is forwarded,
+ * a wrapper overrides what it watches. Destroying _rows of a streamed result
+ * makes the driver read what the caller left unread, a wrapper timing the
+ * statement resets _rows itself in its destructor to count that time
+ */
+class ForwardingResultSet : public ResultSet
+{
+public:
+    explicit ForwardingResultSet(std::unique_ptr<ResultSet> rows) : _rows(std::move(rows)) {}
+    bool next() override { return _rows->next(); }
+    unsigned int fieldCount() const override { return _rows->fieldCount(); }
+    const char *field(unsigned int index) const override { return _rows->field(index); }
+    unsigned long fieldLength(unsigned int index) const override { return _rows->fieldLength(index); }
+    uint64_t rowCount() const override { return _rows->rowCount(); }
+    uint64_t memoryBytes() const override { return _rows->memoryBytes(); }
+    bool failed() const override { return _rows->failed(); }
+
+protected:
+    std::unique_ptr<ResultSet> _rows;
+};
+
+// One server session. connect() may be called again to reconnect
+class DriverConnection
+{
+public:
+    virtual ~DriverConnection() = default;
+    virtual void setConnectTimeout(unsigned int seconds) = 0;
+    virtual bool connect(const std::string &ip, unsigned short port, const std::string &user,
+                         const std::string &password, const std::string &dbname) = 0;
+    virtual void close() = 0;
+    virtual bool ping() = 0;
+    // Statement without a result set, affected rows on success
+    virtual bool execute(const std::string &sql, uint64_t &affectedRows) = 0;
+    // nullptr on error. stream: rows are fetched from the server while reading
+    // (the session is busy until the result is destroyed), else buffered first
+    virtual std::unique_ptr<ResultSet> query(const std::string &sql, bool stream) = 0;
+    virtual std::string error() const = 0;
+    // value as a quoted string literal. The default doubles quotes and escapes
+    // backslashes as the default sql_mode reads them; the mysql driver asks
+    // the session, which knows about NO_BACKSLASH_ESCAPES
+    virtual std::string quote(const std::string &value);
+    // us of the last execute()/query() spent receiving a buffered result, 0
+    // when the driver does not measure it. Only read for sampled statements
+    virtual int64_t lastFetchUs() const { return 0; }
+    // Driver specific handle (MYSQL* for the mysql driver), nullptr if none
+    virtual void *native() { return nullptr; }
+};
+
+// Shared by every connection of a pool, must be thread safe
+class Driver
+{
+public:
+    virtual ~Driver() = default;
+    virtual const char *name() const = 0;
+    virtual std::unique_ptr<DriverConnection> open() = 0;
+};
+
+using DriverFactory = std::function<std::shared_ptr<Driver>()>;
+
+// "mysql" (libmysqlclient) and "fake" (FakeDriver with default options) are built in.
+// Registering an existing name replaces it, e.g. a FakeDriver tuned for a benchmark
+void registerDriver(const std::string &name, DriverFactory factory);
+bool isDriverRegistered(const std::string &name);
+// nullptr for an unknown name
+std::shared_ptr<Driver> createDriver(const std::string &name);
+
+#endif // CONNECTION_POOL_DRIVER_H
@@ -0,0 +1,91 @@
+/*
+ * @Description: In-process fake database for pool benchmarks and tests
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_FAKE_DRIVER_H
+#define CONNECTION_POOL_FAKE_DRIVER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Driver.h"
+
+// Latency model, sampled per call
+struct LatencyDistribution
+{
+    enum class Kind
+    {
+        FIXED,       // always mean
+        UNIFORM,     // min..max
+        EXPONENTIAL, // min + exponential with the given mean
+        LOGNORMAL,   // median mean, shape sigma: a realistic long tail
+    };
+    Kind kind = Kind::FIXED;
+    std::chrono::microseconds mean{0};
+    std::chrono::microseconds min{0};
+    std::chrono::microseconds max{0};
+    double sigma = 0.5;
+
+    static LatencyDistribution fixed(std::chrono::microseconds value);
+    static LatencyDistribution uniform(std::chrono::microseconds min, std::chrono::microseconds max);
+    static LatencyDistribution exponential(std::chrono::microseconds mean, std::chrono::microseconds min = {});
+    static LatencyDistribution lognormal(std::chrono::microseconds median, double sigma);
+
+    std::chrono::microseconds sample(std::mt19937_64 &rng) const;
+};
+
+// Rows returned for one statement. SQL NULL is not modelled
+using FakeRows = std::vector<std::vector<std::string>>;
+
+struct FakeDriverOptions
+{
+    LatencyDistribution connectLatency = LatencyDistribution::fixed(std::chrono::milliseconds(1));
+    LatencyDistribution queryLatency = LatencyDistribution::fixed(std::chrono::microseconds(200));
+    LatencyDistribution pingLatency = LatencyDistribution::fixed(std::chrono::microseconds(50));
+    double connectFailureRate = 0; // 0..1
+    double queryFailureRate = 0;
+    double pingFailureRate = 0;
+    int maxConnections = 151;      // server side limit, like max_connections
+    size_t rowsPerQuery = 1;       // default result: one column, values "1".."n"
+    // Optional: produce the rows of a statement (tables, EXPLAIN output, ...)
+    std::function<FakeRows(const std::string &sql)> handler;
+    uint64_t seed = 42;
+};
+
+/**
+ * Simulates a server: connections count against maxConnections, every call
+ * sleeps for a sampled latency and fails with the configured probability.
+ * killConnections() drops every open session like a server restart would,
+ * so reconnect paths can be exercised
+ */
+class FakeDriver : public Driver, public std::enable_shared_from_this<FakeDriver>
+{
+public:
+    explicit FakeDriver(FakeDriverOptions options = {});
+    const char *name() const override { return "fake"; }
+    std::unique_ptr<DriverConnection> open() override;
+
+    void killConnections() { _epoch++; }
+    int openConnections() const { return _open.load(); }
+    uint64_t statements() const { return _statements.load(); }
+    const FakeDriverOptions &options() const { return _options; }
+
+private:
+    friend class FakeConnection;
+    bool fail(double rate);
+    void delay(const LatencyDistribution &latency);
+
+    FakeDriverOptions _options;
+    std::atomic<int> _open{0};
+    std::atomic<uint64_t> _epoch{0};
+    std::atomic<uint64_t> _statements{0};
+    std::atomic<uint64_t> _streams{0}; // per thread random streams derived from seed
+};
+
+#endif // CONNECTION_POOL_FAKE_DRIVER_H
@@ -0,0 +1,91 @@
+/*
+* @Description: Sharded per SQL fingerprint aggregates with a bounded number of shapes
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Entries keyed by fingerprintSql() hash, split into Shards with a mutex each
+ * so threads running different statements rarely meet. At most MaxEntries
+ * shapes get their own entry, new shapes past that share one "(other)" entry
+ * under fingerprint 0, kept in the first shard. Entry has fingerprint,
+ * normalized and totalUs members
+ */
+template <typename Entry, size_t Shards, size_t MaxEntries>
+class FingerprintTable {
+public:
+    // Runs add(Entry&) under the shard lock; normalized is only copied for a new shape
+    template <typename F>
+    void update(uint64_t fingerprint, const std::string& normalized, F add) {
+        Shard* shard = &_shards[fingerprint % Shards];
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        auto it = shard->entries.find(fingerprint);
+        if (it == shard->entries.end()) {
+            bool room = _entries.fetch_add(1, std::memory_order_relaxed) < MaxEntries;
+            if (!room) {
+                _entries.fetch_sub(1, std::memory_order_relaxed);
+                lock.unlock();
+                shard = &_shards[0];
+                lock = std::unique_lock<std::mutex>(shard->mutex);
+            }
+            uint64_t key = room ? fingerprint : 0;
+            it = shard->entries.find(key);
+            if (it == shard->entries.end()) {
+                Entry entry;
+                entry.fingerprint = key;
+                entry.normalized = room ? normalized : "(other)";
+                it = shard->entries.emplace(key, std::move(entry)).first;
+            }
+        }
+        add(it->second);
+    }
+
+    // Most total time first, at most limit entries
+    std::vector<Entry> top(size_t limit) const {
+        std::vector<Entry> all;
+        for (const auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& entry : shard.entries) all.push_back(entry.second);
+        }
+        auto byTotal = [](const Entry& a, const Entry& b) { return a.totalUs > b.totalUs; };
+        if (all.size() > limit) {
+            std::partial_sort(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(limit), all.end(), byTotal);
+            all.resize(limit);
+        } else {
+            std::sort(all.begin(), all.end(), byTotal);
+        }
+        return all;
+    }
+
+    // Shapes with their own entry, "(other)" not included
+    size_t size() const { return _entries.load(std::memory_order_relaxed); }
+
+    void reset() {
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& entry : shard.entries) {
+                if (entry.first != 0) _entries.fetch_sub(1, std::memory_order_relaxed);
+            }
+            shard.entries.clear();
+        }
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+    };
+
+    std::atomic<size_t> _entries{0};
+    Shard _shards[Shards];
+};
@@ -0,0 +1,296 @@
+/*
+* @Description: Always-on flight recorder for pool debug events
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Binary event ids, stable on disk: external decoders rely on the values
+ */
+enum class FlightEvent : uint16_t {
+    BORROW = 1,     // arg0: connection, arg1: wait in us
+    RETURN = 2,     // arg0: connection, arg1: 1 if returned to idle queue
+    VALIDATE = 3,   // arg0: connection, arg1: 1 if valid
+    RECONNECT = 4,  // arg0: connection, arg1: 1 if succeeded
+    CONNECT = 5,    // arg0: connection, arg1: 1 if succeeded
+    DESTROY = 6,    // arg0: connection
+    TIMEOUT = 7,    // arg1: wait in us
+};
+
+/**
+ * One 32 bytes record. seq is written last, a reader must discard records whose
+ * seq does not match the slot position (torn or never written)
+ */
+struct FlightRecord {
+    uint64_t ticks; // raw TSC, converted with the calibration pair in Header
+    uint32_t seq;
+    uint16_t event;
+    uint16_t reserved;
+    uint64_t arg0;
+    uint64_t arg1;
+};
+static_assert(sizeof(FlightRecord) == 32, "FlightRecord layout is part of the dump format");
+
+/**
+ * Capture DEBUG-level events into per-thread rings without locks and without
+ * formatting, so it can stay enabled in production. Nothing is written to disk
+ * until dump() is called explicitly, by signal, or when a FATAL is logged.
+ *
+ * Memory layout (also the dump file layout):
+ *   Header | Slot[kMaxThreads], each Slot = SlotHeader | FlightRecord[kRecordsPerThread]
+ * When init() is given a name the region lives in /dev/shm/<name>, so a reader can
+ * still inspect it after the process crashed.
+ */
+class FlightRecorder {
+public:
+    static constexpr uint32_t kMagic = 0x43455246; // "FREC"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kMaxThreads = 64;
+    static constexpr uint32_t kRecordsPerThread = 2048; // power of two
+
+    struct alignas(64) Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t max_threads;
+        uint32_t records_per_thread;
+        uint32_t reserved;
+        uint32_t pid;
+        // Two (ticks, steady ns) samples, taken at init and at dump time
+        uint64_t ticks_base;
+        uint64_t ns_base;
+        uint64_t ticks_dump;
+        uint64_t ns_dump;
+        std::atomic<uint64_t> owned_slots; // bit i set while a live thread owns slot i
+    };
+
+    struct alignas(64) SlotHeader {
+        std::atomic<uint64_t> head; // total records ever written into the slot
+        uint32_t thread_id;
+        uint32_t reserved;
+    };
+
+    struct Slot {
+        SlotHeader header;
+        FlightRecord records[kRecordsPerThread];
+    };
+
+    static constexpr size_t kRegionSize = sizeof(Header) + sizeof(Slot) * kMaxThreads;
+    // Written by the threads that found no free slot, thread_id stays 0
+    static constexpr uint32_t kSharedSlot = kMaxThreads - 1;
+    static_assert(kMaxThreads <= 64, "owned_slots is a 64 bit mask");
+    static_assert(sizeof(Header) == 64, "Header layout is part of the dump format");
+
+    static FlightRecorder& instance() {
+        static FlightRecorder recorder;
+        return recorder;
+    }
+
+    /**
+     * Move the recorder into a named shared memory segment. Must be called early,
+     * records written before are not carried over
+     */
+    bool init(const std::string& shm_name) {
+        if (shm_name.empty()) return false;
+        std::string name = shm_name[0] == '/' ? shm_name : "/" + shm_name;
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (fd < 0) return false;
+        if (ftruncate(fd, static_cast<off_t>(kRegionSize)) != 0) {
+            close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return false;
+        format_region(static_cast<char*>(mem));
+        // The previous region is never unmapped, a writer racing with the swap
+        // finishes into it harmlessly
+        _region.store(static_cast<char*>(mem), std::memory_order_release);
+        return true;
+    }
+
+    void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    void set_dump_path(const std::string& path) {
+        size_t n = std::min(path.size(), sizeof(_dump_path) - 1);
+        std::memcpy(_dump_path, path.data(), n);
+        _dump_path[n] = '\0';
+    }
+
+    // Hot path: a TSC read and a 32 bytes store into a thread owned ring, no RMW
+    // unless all kMaxThreads - 1 owned slots are taken by live threads
+    void record(FlightEvent event, uint64_t arg0 = 0, uint64_t arg1 = 0) noexcept {
+        if (!_enabled.load(std::memory_order_relaxed)) return;
+        char* region = _region.load(std::memory_order_acquire);
+        uint32_t index = thread_slot(region);
+        Slot* slot = slot_of(region, index);
+        uint64_t pos;
+        if (index == kSharedSlot) {
+            pos = slot->header.head.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Only the owner ever writes head of an owned slot
+            pos = slot->header.head.load(std::memory_order_relaxed);
+            slot->header.head.store(pos + 1, std::memory_order_relaxed);
+        }
+        FlightRecord& r = slot->records[pos & (kRecordsPerThread - 1)];
+        r.ticks = read_ticks();
+        r.event = static_cast<uint16_t>(event);
+        r.reserved = 0;
+        r.arg0 = arg0;
+        r.arg1 = arg1;
+        std::atomic_thread_fence(std::memory_order_release);
+        r.seq = static_cast<uint32_t>(pos + 1);
+    }
+
+    /**
+     * Write the raw region to path. Only uses open/write/close so it is safe to
+     * call from a signal handler
+     */
+    bool dump(const char* path = nullptr) const noexcept {
+        const char* target = path != nullptr ? path : _dump_path;
+        int fd = ::open(target, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+        if (fd < 0) return false;
+        char* region = _region.load(std::memory_order_acquire);
+        Header* h = reinterpret_cast<Header*>(region);
+        h->ticks_dump = read_ticks();
+        h->ns_dump = steady_ns();
+        const char* p = region;
+        size_t left = kRegionSize;
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n <= 0) {
+                ::close(fd);
+                return false;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    // Dump to the configured path whenever signo is delivered, default SIGUSR2
+    void install_signal_handler(int signo = SIGUSR2) {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = [](int) { FlightRecorder::instance().dump(); };
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(signo, &sa, nullptr);
+    }
+
+private:
+    FlightRecorder() {
+        void* mem = mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        // Keep recorder usable even when mmap fails, fall back to a static buffer
+        char* region = mem == MAP_FAILED ? fallback_region() : static_cast<char*>(mem);
+        format_region(region);
+        _region.store(region, std::memory_order_release);
+        set_dump_path("flight_recorder.bin");
+    }
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    static char* fallback_region() {
+        alignas(64) static char buffer[kRegionSize];
+        return buffer;
+    }
+
+    static void format_region(char* region) {
+        std::memset(region, 0, kRegionSize);
+        Header* h = reinterpret_cast<Header*>(region);
+        h->magic = kMagic;
+        h->version = kVersion;
+        h->max_threads = kMaxThreads;
+        h->records_per_thread = kRecordsPerThread;
+        h->pid = static_cast<uint32_t>(getpid());
+        h->ticks_base = h->ticks_dump = read_ticks();
+        h->ns_base = h->ns_dump = steady_ns();
+    }
+
+    static uint64_t read_ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return steady_ns();
+#endif
+    }
+
+    static uint64_t steady_ns() noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static Slot* slot_of(char* region, uint32_t index) {
+        return reinterpret_cast<Slot*>(region + sizeof(Header)) + index;
+    }
+
+    static Header* header_of(char* region) { return reinterpret_cast<Header*>(region); }
+
+    // A thread owns a slot from its first record until it exits, the slot is
+    // then free for the next thread. Owned slots keep head across owners, so
+    // the previous owner's records left in the ring show the new thread_id.
+    // Threads that find every owned slot taken write the shared slot for the
+    // rest of their life, its head only ever moves with fetch_add
+    struct SlotBinding {
+        char* region = nullptr;
+        uint32_t index = kSharedSlot;
+
+        void release() noexcept {
+            if (region != nullptr && index != kSharedSlot) {
+                header_of(region)->owned_slots.fetch_and(~(uint64_t{1} << index), std::memory_order_release);
+            }
+            region = nullptr;
+            index = kSharedSlot;
+        }
+        ~SlotBinding() { release(); }
+    };
+
+    static uint32_t thread_slot(char* region) {
+        thread_local SlotBinding binding;
+        if (binding.region != region) {
+            // init() moved the recorder, the old region is never unmapped
+            binding.release();
+            constexpr uint64_t kOwnable = (uint64_t{1} << kSharedSlot) - 1;
+            std::atomic<uint64_t>& owned = header_of(region)->owned_slots;
+            uint64_t used = owned.load(std::memory_order_relaxed);
+            uint64_t available;
+            // acquire pairs with the release in SlotBinding::release, the
+            // previous owner's last head store is visible before we load it
+            while ((available = ~used & kOwnable) != 0 &&
+                   !owned.compare_exchange_weak(used, used | (available & -available), std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+            }
+            if (available != 0) {
+                binding.index = static_cast<uint32_t>(__builtin_ctzll(available));
+                slot_of(region, binding.index)->header.thread_id = static_cast<uint32_t>(syscall(SYS_gettid));
+            }
+            binding.region = region;
+        }
+        return binding.index;
+    }
+
+    std::atomic<char*> _region{nullptr};
+    std::atomic<bool> _enabled{true};
+    char _dump_path[256];
+};
+
+#define FLIGHT_RECORD(event, ...) FlightRecorder::instance().record(FlightEvent::event, ##__VA_ARGS__)
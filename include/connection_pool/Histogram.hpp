@@ -0,0 +1,163 @@
+/*
+* @Description: Sharded counters and HDR style latency histograms for metrics
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Shards per metric. A thread keeps the shard it was given, so recording is an
+// uncontended relaxed add as long as there are fewer hot threads than shards
+constexpr size_t kMetricShards = 16;
+
+inline size_t metricShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+class ShardedCounter {
+public:
+    void add(uint64_t n = 1) { _shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t load() const {
+        uint64_t total = 0;
+        for (const auto& shard : _shards) total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> _shards;
+};
+
+/**
+ * Merged histogram counts, owned by the reader. Values are in the unit the
+ * histogram was recorded in (the pool records microseconds)
+ */
+class HistogramSnapshot {
+public:
+    HistogramSnapshot() = default;
+    HistogramSnapshot(std::vector<uint64_t> counts, uint64_t sum)
+        : _counts(std::move(counts)), _sum(sum) {
+        for (uint64_t c : _counts) _count += c;
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t sum() const { return _sum; }
+    double mean() const { return _count == 0 ? 0 : static_cast<double>(_sum) / _count; }
+
+    // Highest value equivalent to the bucket holding quantile q (0..1)
+    uint64_t percentile(double q) const {
+        if (_count == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * _count + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < _counts.size(); i++) {
+            seen += _counts[i];
+            if (seen >= rank) return highestEquivalent(i);
+        }
+        return max();
+    }
+
+    uint64_t max() const {
+        for (size_t i = _counts.size(); i > 0; i--) {
+            if (_counts[i - 1] != 0) return highestEquivalent(i - 1);
+        }
+        return 0;
+    }
+
+    // Number of values <= bound, for cumulative (Prometheus style) buckets
+    uint64_t countAtOrBelow(uint64_t bound) const {
+        uint64_t n = 0;
+        for (size_t i = 0; i < _counts.size() && lowestEquivalent(i) <= bound; i++) n += _counts[i];
+        return n;
+    }
+
+    void merge(const HistogramSnapshot& other) {
+        if (_counts.size() < other._counts.size()) _counts.resize(other._counts.size());
+        for (size_t i = 0; i < other._counts.size(); i++) _counts[i] += other._counts[i];
+        _count += other._count;
+        _sum += other._sum;
+    }
+
+    static uint64_t lowestEquivalent(size_t index);
+    static uint64_t highestEquivalent(size_t index);
+
+private:
+    std::vector<uint64_t> _counts;
+    uint64_t _count = 0;
+    uint64_t _sum = 0;
+};
+
+/**
+ * Log-linear buckets as in HdrHistogram: 64 linear sub-buckets per power of
+ * two, so any value is stored within 1/64 (about 1.6%) of itself, from 0 up
+ * to 2^40 (beyond that it is clamped). Recording is two relaxed adds on the
+ * caller's shard, no locks and no allocation
+ */
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 7;                       // 128 sub-buckets
+    static constexpr int kSubBucketHalfBits = kSubBucketBits - 1;  // 64 per bucket after the first
+    static constexpr uint64_t kSubBucketMask = (uint64_t(1) << kSubBucketBits) - 1;
+    static constexpr int kMaxBits = 40;
+    static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxBits) - 1;
+    static constexpr size_t kBucketCount = kMaxBits - kSubBucketBits + 1;
+    static constexpr size_t kCountsLength = (kBucketCount + 1) << kSubBucketHalfBits;
+    static constexpr size_t kShards = 8;
+
+    void record(uint64_t value) {
+        value = std::min(value, kMaxValue);
+        Shard& shard = _shards[metricShard() % kShards];
+        shard.counts[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const {
+        std::vector<uint64_t> counts(kCountsLength, 0);
+        uint64_t sum = 0;
+        for (const auto& shard : _shards) {
+            for (size_t i = 0; i < kCountsLength; i++) counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+            sum += shard.sum.load(std::memory_order_relaxed);
+        }
+        return HistogramSnapshot(std::move(counts), sum);
+    }
+
+    static size_t indexOf(uint64_t value) {
+        int pow2Ceiling = 64 - __builtin_clzll(value | kSubBucketMask);
+        int bucket = pow2Ceiling - kSubBucketBits;
+        uint64_t subBucket = value >> bucket;
+        return (static_cast<size_t>(bucket + 1) << kSubBucketHalfBits) +
+               (subBucket - (uint64_t(1) << kSubBucketHalfBits));
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[kCountsLength] = {};
+        std::atomic<uint64_t> sum{0};
+    };
+    Shard _shards[kShards];
+};
+
+inline uint64_t HistogramSnapshot::lowestEquivalent(size_t index) {
+    int bucket = static_cast<int>(index >> Histogram::kSubBucketHalfBits) - 1;
+    uint64_t subBucket = (index & ((uint64_t(1) << Histogram::kSubBucketHalfBits) - 1)) +
+                         (uint64_t(1) << Histogram::kSubBucketHalfBits);
+    if (bucket < 0) {
+        subBucket -= uint64_t(1) << Histogram::kSubBucketHalfBits;
+        bucket = 0;
+    }
+    return subBucket << bucket;
+}
+
+inline uint64_t HistogramSnapshot::highestEquivalent(size_t index) {
+    int bucket = std::max(0, static_cast<int>(index >> Histogram::kSubBucketHalfBits) - 1);
+    return lowestEquivalent(index) + (uint64_t(1) << bucket) - 1;
+}
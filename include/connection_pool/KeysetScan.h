@@ -0,0 +1,105 @@
+/*
+ * @Description: Chunked table scan by keyset pagination, the connection goes back between chunks
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_KEYSET_SCAN_H
+#define CONNECTION_POOL_KEYSET_SCAN_H
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RowStream.h"
+
+class connection_pool;
+
+struct KeysetScanOptions
+{
+    std::string table;                   // quoted as an identifier, "db.table" allowed
+    std::vector<std::string> keyColumns; // unique, indexed and NOT NULL, e.g. the primary key; quoted as identifiers
+    std::string columns = "*";           // select list after the key columns, raw SQL
+    std::string where;                   // optional predicate, raw SQL
+    size_t chunkSize = 1000;
+    // Fetch the next chunk on a second connection while the caller reads this one
+    bool prefetch = false;
+    // Resize chunks so one takes about this long, 0 keeps chunkSize
+    std::chrono::milliseconds targetChunkLatency{0};
+    size_t minChunkSize = 100;
+    size_t maxChunkSize = 100000;
+};
+
+/**
+ * Reads a table in key order, one chunk per statement:
+ *   SELECT keys, columns FROM table WHERE (where) AND (keys) > (last keys)
+ *   ORDER BY keys LIMIT n
+ * Every chunk is an index range read that costs the same however far the
+ * scan got, unlike OFFSET, and it borrows a connection only while the chunk
+ * is fetched, so a long scan neither keeps a lease nor a server snapshot
+ * open. Rows changed behind the last key are not seen again. Each row holds
+ * the key columns first, then columns. A NULL key cannot be seeked past, the
+ * chunk holding one fails the scan
+ */
+class KeysetScan
+{
+public:
+    // Throws std::invalid_argument for options without a table or key columns
+    KeysetScan(std::shared_ptr<connection_pool> pool, KeysetScanOptions options);
+    ~KeysetScan();
+    KeysetScan(const KeysetScan &) = delete;
+    KeysetScan &operator=(const KeysetScan &) = delete;
+
+    // Moves to the next chunk, false at the end of the table or when a chunk
+    // could not be read (failed()). Rethrows what getconnection() threw, also
+    // for a chunk prefetched on another thread
+    bool next();
+    size_t size() const { return _current.rows.rows; }
+    // Valid until the next call to next()
+    StreamRow row(size_t index) const { return StreamRow(_current.rows, index, _current.fields); }
+
+    bool failed() const { return _failed; }
+    // Rows the next chunk asks for, see targetChunkLatency
+    size_t chunkSize() const { return _chunkSize; }
+    uint64_t chunks() const { return _chunks; }
+    uint64_t rowsRead() const { return _rowsRead; }
+
+    // Exposed for tests: the statement for the chunk after the key given as
+    // SQL literals, see connection::quote ({} for the first chunk)
+    std::string chunkSql(const std::vector<std::string> &after, size_t limit) const;
+
+private:
+    struct Chunk
+    {
+        RowBatch rows;
+        unsigned int fields = 0;
+        size_t limit = 0;
+        int64_t latencyUs = 0; // statement sent to last row read
+        bool ok = false;
+        std::exception_ptr error; // thrown by getconnection(), rethrown by next()
+    };
+
+    void fetch(Chunk &chunk, std::vector<std::string> after, size_t limit);
+    // Key of the last row of chunk
+    std::vector<std::string> lastKey(const Chunk &chunk) const;
+    void adapt(const Chunk &chunk);
+
+    std::shared_ptr<connection_pool> _pool;
+    const KeysetScanOptions _options;
+    std::string _select; // up to and including FROM table
+    size_t _chunkSize;
+
+    Chunk _current;
+    Chunk _ahead;           // filled by _prefetcher
+    std::thread _prefetcher;
+    bool _end = false;      // the last chunk was short, nothing after it
+    bool _failed = false;
+    uint64_t _chunks = 0;
+    uint64_t _rowsRead = 0;
+};
+
+#endif // CONNECTION_POOL_KEYSET_SCAN_H
@@ -0,0 +1,50 @@
+/*
+ * @Description: Connection leak detection, borrow site sampling and leak reports
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_LEAK_DETECTOR_H
+#define CONNECTION_POOL_LEAK_DETECTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Call stack of a sampled borrow, taken by the borrowing thread
+struct BorrowSite
+{
+    uint64_t lease;            // connection::getBorrowCount() of the borrow it belongs to
+    std::vector<void *> frames; // innermost first, the pool's own frames skipped
+
+    mutable std::once_flag symbolizeOnce; // formatBorrowSite fills symbolized once
+    mutable std::string symbolized;
+};
+
+// A lease held longer than leakDetectionThreshold
+struct LeakReport
+{
+    uintptr_t connection; // same value as ConnectionInfo::id
+    uint64_t lease;       // borrow number on that connection, tells leases apart
+    uint32_t thread;      // kernel thread id of the borrower, as in ps -L or gdb
+    long heldMs;
+    std::string stack;    // one frame per line, empty when the borrow was not sampled
+};
+
+// Kernel thread id of the caller, cached per thread
+uint32_t currentThreadId();
+
+// True on one in everyN calls per thread, never when everyN is 0
+bool sampleBorrow(int everyN);
+
+// Stack of the calling thread, skipping the innermost skip frames
+std::shared_ptr<const BorrowSite> captureBorrowSite(uint64_t lease, int skip);
+
+// backtrace_symbols lines; link with -rdynamic for function names, otherwise
+// resolve the module offsets with addr2line. Symbolized on the first call,
+// later calls return the same text
+const std::string &formatBorrowSite(const BorrowSite &site);
+
+#endif // CONNECTION_POOL_LEAK_DETECTOR_H
@@ -0,0 +1,249 @@
+/*
+* @Description: Allocation free storage for log messages and queues
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+/**
+ * Recycled fixed size chunks for messages that don't fit inline. Chunks are
+ * reference counted because one entry is fanned out to several sinks, and are
+ * only handed back to the heap when the process exits.
+ */
+class LogChunkPool {
+public:
+    static constexpr size_t kChunkSize = 4096;
+
+    struct Chunk {
+        std::atomic<uint32_t> refs;
+        Chunk* next;
+        char data[kChunkSize];
+    };
+
+    // Intentionally leaked: log entries may still be released while static
+    // objects are destroyed
+    static LogChunkPool& instance() {
+        static LogChunkPool* pool = new LogChunkPool();
+        return *pool;
+    }
+
+    Chunk* acquire() {
+        Chunk* chunk = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free != nullptr) {
+                chunk = _free;
+                _free = chunk->next;
+            }
+        }
+        if (chunk == nullptr) {
+            chunk = new Chunk();
+            _allocated.fetch_add(1, std::memory_order_relaxed);
+        }
+        chunk->refs.store(1, std::memory_order_relaxed);
+        chunk->next = nullptr;
+        return chunk;
+    }
+
+    // Preallocate so bursts of long messages don't grow the pool on the hot path
+    void reserve(size_t count) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t have = _allocated.load(std::memory_order_relaxed); have < count; ++have) {
+            Chunk* chunk = new Chunk();
+            chunk->next = _free;
+            _free = chunk;
+            _allocated.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void retain(Chunk* chunk) {
+        chunk->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(Chunk* chunk) {
+        if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        std::lock_guard<std::mutex> lock(_mutex);
+        chunk->next = _free;
+        _free = chunk;
+    }
+
+    // Number of chunks ever created, stays flat at steady state
+    size_t allocated() const { return _allocated.load(std::memory_order_relaxed); }
+
+private:
+    LogChunkPool() = default;
+
+    std::mutex _mutex;
+    Chunk* _free = nullptr;
+    std::atomic<size_t> _allocated{0};
+};
+
+/**
+ * Message payload stored inline up to kInlineSize bytes, longer messages spill
+ * into a pooled chunk. Past LogChunkPool::kChunkSize they are cut short and end
+ * with "...[truncated N bytes]".
+ */
+class LogMessage {
+public:
+    static constexpr size_t kInlineSize = 200;
+
+    LogMessage() = default;
+    LogMessage(const char* data, size_t size) { assign(data, size); }
+
+    LogMessage(const LogMessage& other) { copy_from(other); }
+    LogMessage(LogMessage&& other) noexcept { move_from(other); }
+    LogMessage& operator=(const LogMessage& other) {
+        if (this != &other) {
+            reset();
+            copy_from(other);
+        }
+        return *this;
+    }
+    LogMessage& operator=(LogMessage&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+    ~LogMessage() { reset(); }
+
+    void assign(const char* data, size_t size) {
+        reset();
+        if (size <= kInlineSize) {
+            std::memcpy(_inline, data, size);
+            _size = static_cast<uint32_t>(size);
+            return;
+        }
+        _chunk = LogChunkPool::instance().acquire();
+        _size = static_cast<uint32_t>(std::min(size, LogChunkPool::kChunkSize));
+        std::memcpy(_chunk->data, data, _size);
+        if (size > LogChunkPool::kChunkSize) mark_truncated(size);
+    }
+
+    // Format in place, formatting twice only when the inline slot is too small
+    template <typename... Args>
+    void format(fmt::format_string<Args...> format_str, Args&&... args) {
+        reset();
+        auto store = fmt::make_format_args(args...);
+        auto result = fmt::vformat_to_n(_inline, kInlineSize, fmt::string_view(format_str), store);
+        if (result.size <= kInlineSize) {
+            _size = static_cast<uint32_t>(result.size);
+            return;
+        }
+        _chunk = LogChunkPool::instance().acquire();
+        result = fmt::vformat_to_n(_chunk->data, LogChunkPool::kChunkSize, fmt::string_view(format_str), store);
+        _size = static_cast<uint32_t>(std::min(result.size, LogChunkPool::kChunkSize));
+        if (result.size > LogChunkPool::kChunkSize) mark_truncated(result.size);
+    }
+
+    const char* data() const { return _chunk != nullptr ? _chunk->data : _inline; }
+    size_t size() const { return _size; }
+    fmt::string_view view() const { return fmt::string_view(data(), _size); }
+
+private:
+    // Chunk holds the first kChunkSize of total bytes: overwrite its tail with
+    // the marker, N counts every byte that did not make it
+    void mark_truncated(size_t total) {
+        char marker[48];
+        size_t length = 0;
+        size_t keep = LogChunkPool::kChunkSize;
+        // The marker takes room from the kept text, which changes N and maybe
+        // its digit count; repeat until its length settles
+        for (size_t previous = SIZE_MAX; length != previous;) {
+            previous = length;
+            keep = LogChunkPool::kChunkSize - length;
+            length = fmt::format_to_n(marker, sizeof(marker), "...[truncated {} bytes]", total - keep).size;
+        }
+        std::memcpy(_chunk->data + keep, marker, length);
+        _size = static_cast<uint32_t>(keep + length);
+    }
+
+    void reset() {
+        if (_chunk != nullptr) {
+            LogChunkPool::instance().release(_chunk);
+            _chunk = nullptr;
+        }
+        _size = 0;
+    }
+
+    void copy_from(const LogMessage& other) {
+        _size = other._size;
+        _chunk = other._chunk;
+        if (_chunk != nullptr) {
+            LogChunkPool::retain(_chunk);
+        } else {
+            std::memcpy(_inline, other._inline, _size);
+        }
+    }
+
+    // Steals the chunk reference instead of taking a new one
+    void move_from(LogMessage& other) {
+        _size = other._size;
+        _chunk = other._chunk;
+        if (_chunk != nullptr) {
+            other._chunk = nullptr;
+            other._size = 0;
+        } else {
+            std::memcpy(_inline, other._inline, _size);
+        }
+    }
+
+    uint32_t _size = 0;
+    LogChunkPool::Chunk* _chunk = nullptr;
+    char _inline[kInlineSize];
+};
+
+/**
+ * Fixed capacity FIFO over preallocated slots, not thread safe. Popped slots
+ * are reset so pooled chunks go back promptly
+ */
+template <typename T>
+class BoundedRing {
+public:
+    explicit BoundedRing(size_t capacity = 0) : _slots(capacity) {}
+
+    // Allocates, only call at init time
+    void reset(size_t capacity) {
+        _slots.clear();
+        _slots.resize(capacity);
+        _head = 0;
+        _size = 0;
+    }
+
+    template <typename U>
+    bool push(U&& value) {
+        if (_size >= _slots.size()) return false;
+        _slots[(_head + _size) % _slots.size()] = std::forward<U>(value);
+        _size++;
+        return true;
+    }
+
+    T& front() { return _slots[_head]; }
+
+    void pop() {
+        _slots[_head] = T();
+        _head = (_head + 1) % _slots.size();
+        _size--;
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _slots.size(); }
+    bool empty() const { return _size == 0; }
+    bool full() const { return _size >= _slots.size(); }
+
+private:
+    std::vector<T> _slots;
+    size_t _head = 0;
+    size_t _size = 0;
+};
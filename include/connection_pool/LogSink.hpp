@@ -0,0 +1,350 @@
+/*
+* @Description: Log sinks of AsyncLogger, each one drained by its own thread
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "LogBuffer.hpp"
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    FATAL
+};
+
+// Fixed size, copying it never allocates (see LogMessage)
+struct LogEntry {
+    LogLevel level;
+    LogMessage message;
+    const char* file;
+    int line;
+    std::chrono::system_clock::time_point time;
+};
+
+inline const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO:  return "INFO";
+        case LogLevel::WARN:  return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+// Format log：timestamp + file name + row number + level + msg, appended to out
+inline void format_log_line(const LogEntry& entry, std::string& out) {
+    auto t = std::chrono::system_clock::to_time_t(entry.time);
+    // Don't use localtime, all threads write to the same static memory area
+    std::tm tm_info;
+    localtime_r(&t, &tm_info);
+    char stamp[32];
+    size_t n = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+    fmt::format_to(std::back_inserter(out), "[{}][{}:{}][{}] {}\n",
+                   fmt::string_view(stamp, n), entry.file, entry.line,
+                   log_level_name(entry.level), entry.message.view());
+}
+
+/**
+ * A sink owns a bounded queue and a thread that drains it in batches. offer() never
+ * blocks, a sink that cannot keep up drops its own entries (counted by dropped())
+ * instead of stalling the logger worker or any other sink.
+ *
+ * Queue and batch storage are preallocated, so at steady state a sink does not
+ * touch the heap unless write_batch() does.
+ *
+ * Derived classes must call stop() in their destructor, before their own members
+ * are destroyed, because the drain thread calls write_batch().
+ */
+class LogSink {
+public:
+    explicit LogSink(LogLevel level = LogLevel::DEBUG,
+                     size_t max_queue_size = 1024,
+                     size_t batch_size = 64)
+        : _level(level), _batch_size(batch_size), _queue(max_queue_size) {
+        _batch.reserve(batch_size);
+    }
+
+    virtual ~LogSink() { stop(); }
+
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    void set_level(LogLevel level) { _level.store(level); }
+    LogLevel level() const { return _level.load(); }
+
+    void set_enabled(bool enable) { _enabled.store(enable); }
+    bool enabled() const { return _enabled.load(); }
+
+    uint64_t dropped() const { return _dropped.load(); }
+
+    // Called by the logger worker (and SlowQueryLog, which owns its sink), must stay non-blocking
+    bool offer(const LogEntry& entry) {
+        if (!_enabled.load(std::memory_order_relaxed) || entry.level < _level.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_queue.push(entry)) {
+                _dropped++;
+                return false;
+            }
+        }
+        _condition.notify_one();
+        return true;
+    }
+
+    void start() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_worker.joinable()) return;
+        _stopping = false;
+        _worker = std::thread(&LogSink::run, this);
+    }
+
+    // Block until everything offered so far has been written
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle_condition.wait(lock, [this] { return (_queue.empty() && !_writing) || !_worker.joinable(); });
+    }
+
+    // Drain what is queued, then join
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _condition.notify_one();
+        if (_worker.joinable() && _worker.get_id() != std::this_thread::get_id()) _worker.join();
+    }
+
+protected:
+    virtual void write_batch(const std::vector<LogEntry>& batch) = 0;
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _condition.wait(lock, [this] { return !_queue.empty() || _stopping; });
+            if (_stopping && _queue.empty()) break;
+            while (!_queue.empty() && _batch.size() < _batch_size) {
+                _batch.push_back(std::move(_queue.front()));
+                _queue.pop();
+            }
+            _writing = true;
+            lock.unlock();
+            write_batch(_batch);
+            _batch.clear();
+            lock.lock();
+            _writing = false;
+            if (_queue.empty()) _idle_condition.notify_all();
+        }
+        _idle_condition.notify_all();
+    }
+
+    std::atomic<LogLevel> _level;
+    std::atomic<bool> _enabled{true};
+    std::atomic<uint64_t> _dropped{0};
+    size_t _batch_size;
+    BoundedRing<LogEntry> _queue;
+    std::vector<LogEntry> _batch; // only touched by the drain thread
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _idle_condition;
+    std::thread _worker;
+    bool _stopping = false;
+    bool _writing = false;
+};
+
+// Plain append only file, one flush per batch
+class FileSink : public LogSink {
+public:
+    explicit FileSink(const std::string& filename, LogLevel level = LogLevel::DEBUG,
+                      size_t max_queue_size = 1024, size_t batch_size = 64)
+        : LogSink(level, max_queue_size, batch_size), _filename(filename),
+          _file(filename, std::ios::out | std::ios::app) {}
+    ~FileSink() override { stop(); }
+
+protected:
+    void write_batch(const std::vector<LogEntry>& batch) override {
+        _buffer.clear();
+        for (const auto& entry : batch) format_log_line(entry, _buffer);
+        _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        _file.flush();
+    }
+
+    std::string _filename;
+    std::ofstream _file;
+    std::string _buffer;
+};
+
+// File roll refers to pt realization: rename to <filename>.<unix time> once max_size is passed
+class RotatingFileSink : public FileSink {
+public:
+    RotatingFileSink(const std::string& filename, size_t max_size, LogLevel level = LogLevel::DEBUG,
+                     size_t max_queue_size = 1024, size_t batch_size = 64)
+        : FileSink(filename, level, max_queue_size, batch_size), _max_size(max_size) {}
+    ~RotatingFileSink() override { stop(); }
+
+protected:
+    void write_batch(const std::vector<LogEntry>& batch) override {
+        if (_file.tellp() > static_cast<std::streampos>(_max_size)) {
+            _file.close();
+            std::string new_name = _filename + "." + std::to_string(time(nullptr));
+            std::rename(_filename.c_str(), new_name.c_str());
+            _file.open(_filename, std::ios::out | std::ios::app);
+        }
+        FileSink::write_batch(batch);
+    }
+
+private:
+    size_t _max_size;
+};
+
+class ConsoleSink : public LogSink {
+public:
+    explicit ConsoleSink(LogLevel level = LogLevel::DEBUG,
+                         size_t max_queue_size = 1024, size_t batch_size = 64)
+        : LogSink(level, max_queue_size, batch_size) {}
+    ~ConsoleSink() override { stop(); }
+
+protected:
+    void write_batch(const std::vector<LogEntry>& batch) override {
+        _buffer.clear();
+        for (const auto& entry : batch) format_log_line(entry, _buffer);
+        std::cout.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        std::cout.flush();
+    }
+
+private:
+    std::string _buffer;
+};
+
+/**
+ * RFC 3164 datagrams to the local syslog daemon. Sends are non-blocking, a
+ * stalled daemon costs dropped lines, never a stalled thread
+ */
+class SyslogSink : public LogSink {
+public:
+    explicit SyslogSink(const std::string& ident = "connection_pool",
+                        const std::string& socket_path = "/dev/log",
+                        LogLevel level = LogLevel::INFO,
+                        size_t max_queue_size = 1024, size_t batch_size = 64)
+        : LogSink(level, max_queue_size, batch_size), _ident(ident), _socket_path(socket_path) {}
+    ~SyslogSink() override {
+        stop();
+        if (_fd >= 0) ::close(_fd);
+    }
+
+protected:
+    void write_batch(const std::vector<LogEntry>& batch) override {
+        if (_fd < 0 && !open_socket()) return;
+        for (const auto& entry : batch) {
+            _buffer.clear();
+            // facility user(1) * 8 + severity
+            fmt::format_to(std::back_inserter(_buffer), "<{}>{}: [{}:{}] {}",
+                           8 + severity(entry.level), _ident, entry.file, entry.line, entry.message.view());
+            if (::send(_fd, _buffer.data(), _buffer.size(), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+                errno != EAGAIN && errno != EWOULDBLOCK) {
+                // Daemon restarted, reconnect on next batch
+                ::close(_fd);
+                _fd = -1;
+                return;
+            }
+        }
+    }
+
+private:
+    bool open_socket() {
+        _fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (_fd < 0) return false;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        _socket_path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        if (::connect(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(_fd);
+            _fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    static int severity(LogLevel level) {
+        switch (level) {
+            case LogLevel::DEBUG: return 7;
+            case LogLevel::INFO:  return 6;
+            case LogLevel::WARN:  return 4;
+            case LogLevel::ERROR: return 3;
+            case LogLevel::FATAL: return 2;
+            default: return 6;
+        }
+    }
+
+    std::string _ident;
+    std::string _socket_path;
+    std::string _buffer;
+    int _fd = -1;
+};
+
+// Keeps the last capacity formatted lines in memory, e.g. for an admin endpoint or a crash report.
+// Line buffers are reused once the ring wrapped
+class RingSink : public LogSink {
+public:
+    explicit RingSink(size_t capacity = 1024, LogLevel level = LogLevel::DEBUG,
+                      size_t max_queue_size = 1024, size_t batch_size = 64)
+        : LogSink(level, max_queue_size, batch_size), _ring(std::max<size_t>(capacity, 1)) {} // keeps at least one line
+    ~RingSink() override { stop(); }
+
+    // Oldest first
+    std::vector<std::string> snapshot() const {
+        std::lock_guard<std::mutex> lock(_ring_mutex);
+        std::vector<std::string> lines;
+        lines.reserve(_count);
+        size_t first = (_next + _ring.size() - _count) % _ring.size();
+        for (size_t i = 0; i < _count; ++i) {
+            lines.push_back(_ring[(first + i) % _ring.size()]);
+        }
+        return lines;
+    }
+
+protected:
+    void write_batch(const std::vector<LogEntry>& batch) override {
+        std::lock_guard<std::mutex> lock(_ring_mutex);
+        for (const auto& entry : batch) {
+            std::string& line = _ring[_next];
+            line.clear();
+            format_log_line(entry, line);
+            _next = (_next + 1) % _ring.size();
+            _count = std::min(_count + 1, _ring.size());
+        }
+    }
+
+private:
+    mutable std::mutex _ring_mutex;
+    std::vector<std::string> _ring;
+    size_t _next = 0;
+    size_t _count = 0;
+};
@@ -8,23 +8,22 @@
 #include <iostream>
 #include <fstream>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <condition_variable>
 #include <chrono>
 #include <iomanip>
 #include <cassert>
 #include <atomic>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include <fmt/core.h>
 
-enum class LogLevel {
-    DEBUG, 
-    INFO,
-    WARN, 
-    ERROR, 
-    FATAL 
-};
+#include "FlightRecorder.hpp"
+#include "LogSink.hpp"
+#include "Probes.hpp"
+#include "ProfiledMutex.hpp"
 
 class AsyncLogger {
 public:
@@ -40,155 +39,201 @@ public:
         static AsyncLogger logger;
         return logger;
     }
+    // Default sinks: rotating file and optional console. Calling init again
+    // drains the current sinks and replaces them
     void init(const std::string& filename = "app.log", 
               size_t max_size = 10 * 1024 * 1024, // 10M
               size_t max_queue_size = 1000,
               bool drop_when_full = true,
               bool console_output = false) 
     {
-        _filename = filename;
-        _max_size = max_size;
-        _console_output = console_output;  
-        _max_queue_size = max_queue_size;
-        _drop_when_full = drop_when_full;
+        shutdown();
+        {
+            ProfiledLock lock(_queue_mutex, "init");
+            // Entries queued before init are kept when they still fit
+            BoundedRing<LogEntry> queue(max_queue_size);
+            while (!_log_queue.empty()) {
+                queue.push(std::move(_log_queue.front()));
+                _log_queue.pop();
+            }
+            _log_queue = std::move(queue);
+            _max_queue_size = max_queue_size;
+            _drop_when_full = drop_when_full;
+            _shutdown = false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_sinks_mutex);
+            _sinks.clear();
+        }
+        add_sink(std::make_shared<RotatingFileSink>(filename, max_size));
+        _console_sink = std::make_shared<ConsoleSink>();
+        _console_sink->set_enabled(console_output);
+        add_sink(_console_sink);
         _worker = std::thread(&AsyncLogger::run, this);
     }
 
     void enable_console_output(bool enable) {
-        std::lock_guard<std::mutex> lock(_queue_mutex);
-        _console_output = enable;
+        std::lock_guard<std::mutex> lock(_sinks_mutex);
+        if (_console_sink) _console_sink->set_enabled(enable);
+    }
+
+    // Sinks have their own level threshold, queue and drain thread
+    void add_sink(std::shared_ptr<LogSink> sink) {
+        sink->start();
+        std::lock_guard<std::mutex> lock(_sinks_mutex);
+        _sinks.push_back(std::move(sink));
+    }
+
+    void remove_sink(const std::shared_ptr<LogSink>& sink) {
+        {
+            std::lock_guard<std::mutex> lock(_sinks_mutex);
+            _sinks.erase(std::remove(_sinks.begin(), _sinks.end(), sink), _sinks.end());
+        }
+        sink->stop();
+    }
+
+    // Drop every sink, including the defaults built by init()
+    void clear_sinks() {
+        std::vector<std::shared_ptr<LogSink>> sinks;
+        {
+            std::lock_guard<std::mutex> lock(_sinks_mutex);
+            sinks.swap(_sinks);
+            _console_sink.reset();
+        }
+        for (auto& sink : sinks) sink->stop();
     }
 
     void enqueue(LogLevel level, const std::string& message, const char* file, int line) {
-        // todo optimze: use self-rotate instead of lock,
-        // reduce context switch overhead
-        std::unique_lock<std::mutex> lock(_queue_mutex);
-        if(_current_queue_size.load() >= _max_queue_size){
-            if (_drop_when_full){
-                std::cerr << "WARNING: Log Queue is full, dropping msg" << "\n";
-            } else{
-                _condition_not_full.wait(lock, [this]{
-                    return _current_queue_size.load() < _max_queue_size;
-                    }
-                );
-            }
+        LogEntry entry{level, LogMessage(message.data(), message.size()), file, line,
+                       std::chrono::system_clock::now()};
+        push(std::move(entry));
+    }
+
+    // Used by LOG macros: formats straight into the entry's inline slot, no heap
+    // allocation for messages up to LogMessage::kInlineSize bytes
+    template <typename... Args>
+    void log(LogLevel level, const char* file, int line, fmt::format_string<Args...> format_str, Args&&... args) {
+        LogEntry entry{level, LogMessage(), file, line, std::chrono::system_clock::now()};
+        entry.message.format(format_str, std::forward<Args>(args)...);
+        push(std::move(entry));
+    }
+
+    // Block until everything logged so far reached every sink
+    void flush() {
+        {
+            ProfiledLock lock(_queue_mutex, "flush");
+            lock.wait(_condition_drained, [this] { return (_log_queue.empty() && !_dispatching) || !_worker.joinable(); });
         }
-        _log_queue.push({level, message, file, line, std::chrono::system_clock::now()});
-        _current_queue_size++;
-        _condition.notify_one();
+        std::lock_guard<std::mutex> lock(_sinks_mutex);
+        for (auto& sink : _sinks) sink->wait_idle();
     }
 
+    // Entries refused by the producer queue since start, per sink losses are LogSink::dropped()
+    uint64_t dropped() const { return _dropped.load(); }
+
+    // Wait and hold times of the producer queue lock, off by default
+    void set_lock_profiling(bool on) { _queue_mutex.set_profiling(on); }
+    LockProfileSnapshot lock_profile() const { return _queue_mutex.snapshot(); }
+
     // Be aware of join(may wait for io)
     void shutdown() {
         {
-            std::lock_guard<std::mutex> lock(_queue_mutex);
+            ProfiledLock lock(_queue_mutex, "shutdown");
             _shutdown = true;
         }
         _condition.notify_one();
+        _condition_not_full.notify_all();
         if (_worker.joinable()) _worker.join();
+        std::lock_guard<std::mutex> lock(_sinks_mutex);
+        for (auto& sink : _sinks) sink->stop();
     }
 
 private:
     AsyncLogger() = default;
+
+    void push(LogEntry&& entry) {
+        LogLevel level = entry.level;
+        POOL_PROBE2(log__enqueue, static_cast<int>(level), entry.message.size());
+        // todo optimze: use self-rotate instead of lock,
+        // reduce context switch overhead
+        ProfiledLock lock(_queue_mutex, "push");
+        if (_log_queue.full() && _drop_when_full) {
+            POOL_PROBE1(log__drop, static_cast<int>(level));
+            // Warn once per overflow episode, not once per message
+            if (_dropped.fetch_add(1) == _dropped_reported) {
+                std::cerr << "WARNING: Log Queue is full, dropping msg" << "\n";
+            }
+        } else {
+            if (_log_queue.full()) {
+                lock.wait(_condition_not_full, [this]{
+                    return !_log_queue.full() || _shutdown;
+                    }
+                );
+            }
+            _log_queue.push(std::move(entry));
+            _dropped_reported = _dropped.load();
+            _condition.notify_one();
+        }
+        lock.unlock();
+        // Keep the last seconds of DEBUG detail next to the fatal message, also
+        // when the queue is full and the message itself was dropped
+        if (level == LogLevel::FATAL) {
+            FlightRecorder::instance().dump();
+        }
+    }
     ~AsyncLogger() { shutdown(); }
 
-    struct LogEntry {
-        LogLevel level;
-        std::string message;
-        const char* file;
-        int line;
-        std::chrono::system_clock::time_point time;
-    };
     /**
-     * 
-    */
+     * Single dispatch stage: moves entries off the producer queue and offers
+     * them to every sink. offer() never blocks, so a slow sink only drops its
+     * own output
+     */
     void run() {
+        LogEntry entry;
         while (true) {
-            LogEntry entry;
             {
-                std::unique_lock<std::mutex> lock(_queue_mutex);
-                _condition.wait(lock, [this] { return !_log_queue.empty() || _shutdown; });
+                ProfiledLock lock(_queue_mutex, "dispatch");
+                _dispatching = false;
+                if (_log_queue.empty()) _condition_drained.notify_all();
+                lock.wait(_condition, [this] { return !_log_queue.empty() || _shutdown; });
                 if (_shutdown && _log_queue.empty()) break;
-                if (!_log_queue.empty()) {
-                    entry = _log_queue.front();
-                    _log_queue.pop();
-                    _current_queue_size--;
+                entry = std::move(_log_queue.front());
+                _log_queue.pop();
+                _dispatching = true;
 
-                    if (!_drop_when_full){
-                        _condition_not_full.notify_one();
-                    }
+                if (!_drop_when_full){
+                    _condition_not_full.notify_one();
                 }
             }
 
-            write_to_file(entry);
-            write_to_console(entry);
-        }
-    }
-
-    void write_to_console(const LogEntry& entry) {
-        if (!_console_output) return; 
-        
-        auto t = std::chrono::system_clock::to_time_t(entry.time);
-        std::cout << "[" << std::put_time(std::localtime(&t), "%Y-%m-%d %H:%M:%S")
-                  << "][" << entry.file << ":" << entry.line << "]["
-                  << level_to_string(entry.level) << "] "
-                  << entry.message << "\n";
-    }
-
-    void write_to_file(const LogEntry& entry) {
-        // File roll refers to pt realization
-        if (_file.tellp() > static_cast<std::streampos>(_max_size)) {
-            std::lock_guard<std::mutex> lock(_file_mutex);
-            _file.close();
-            std::string new_name = _filename + "." + std::to_string(time(nullptr));
-            std::rename(_filename.c_str(), new_name.c_str());
-            _file.open(_filename, std::ios::out | std::ios::app);
+            {
+                std::lock_guard<std::mutex> lock(_sinks_mutex);
+                for (auto& sink : _sinks) sink->offer(entry);
+            }
+            entry = LogEntry();
         }
-
-        // Format log：timestamp + file name + row number + level + msg
-        auto t = std::chrono::system_clock::to_time_t(entry.time);
-        // Remind!!!!
-        // Don't use localtime, will cause wrong when reading time because
-        // All Thread WILL write to same static memory area
-        // !!!
-        // Use safe localtime_r
-        std::tm tm_info;
-        localtime_r(&t, &tm_info);
-        _file << "[" << std::put_time(&tm_info, "%Y-%m-%d %H:%M:%S")
-              << "][" << entry.file << ":" << entry.line << "]["
-              << level_to_string(entry.level) << "] "
-              << entry.message << "\n";
-        _file.flush();
+        _condition_drained.notify_all();
     }
 
-    std::string level_to_string(LogLevel level) {
-        switch (level) {
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO:  return "INFO";
-            case LogLevel::WARN:  return "WARN";
-            case LogLevel::ERROR: return "ERROR";
-            case LogLevel::FATAL: return "FATAL";
-            default: return "UNKNOWN";
-        }
-    }
     // Must be aware of oom, because consumer may cannot keep up with
     // the rate of log generating;
     // todo optimize: concurrent queue use self-rotate, further improve 
     // concurrency performance
-    std::queue<LogEntry> _log_queue;
-    std::mutex _queue_mutex;
-    std::mutex _file_mutex;
+    BoundedRing<LogEntry> _log_queue{1000};
+    ProfiledMutex _queue_mutex{"logger_queue"};
     std::condition_variable _condition; //
     std::condition_variable _condition_not_full;
+    std::condition_variable _condition_drained;
     std::thread _worker;
-    std::ofstream _file{"app.log", std::ios::app};
-    std::string _filename;
-    size_t _max_size;
     size_t _max_queue_size = 1000;
-    std::atomic<size_t> _current_queue_size{0};
+    bool _dispatching = false;
+    std::atomic<uint64_t> _dropped{0};
+    uint64_t _dropped_reported = 0; // guarded by _queue_mutex
     std::atomic<bool> _drop_when_full{true}; // Default discard latest logs
     std::atomic<bool> _shutdown{false};
-    bool _console_output = false; 
+    std::mutex _sinks_mutex;
+    std::vector<std::shared_ptr<LogSink>> _sinks;
+    std::shared_ptr<ConsoleSink> _console_sink;
 };
 
 #ifndef LOG_LEVEL
@@ -197,7 +242,7 @@ private:
 
 #define LOG(level, msg, ...) do { \
     if (level >= LOG_LEVEL) { \
-        AsyncLogger::instance().enqueue(level, fmt::format(msg, ##__VA_ARGS__), __FILE__, __LINE__); \
+        AsyncLogger::instance().log(level, __FILE__, __LINE__, msg, ##__VA_ARGS__); \
     } \
 } while (0)
 
@@ -0,0 +1,76 @@
+/*
+ * @Description: libmysqlclient driver
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_MYSQL_DRIVER_H
+#define CONNECTION_POOL_MYSQL_DRIVER_H
+
+#include <mysql/mysql.h>
+
+#include "Driver.h"
+
+class MysqlResultSet : public ResultSet
+{
+public:
+    // stream: session a mysql_use_result result reads from, nullptr for a
+    // buffered one
+    MysqlResultSet(MYSQL_RES *res, MYSQL *stream);
+    ~MysqlResultSet() override;
+    bool next() override;
+    unsigned int fieldCount() const override { return _fields; }
+    const char *field(unsigned int index) const override { return _row[index]; }
+    unsigned long fieldLength(unsigned int index) const override { return _lengths[index]; }
+    // Rows fetched so far for a streamed result
+    uint64_t rowCount() const override { return mysql_num_rows(_res); }
+    // Sized on the first call, a buffered result keeps every row in memory
+    uint64_t memoryBytes() const override;
+    bool failed() const override { return _failed; }
+
+private:
+    MYSQL_RES *_res;
+    MYSQL *_stream;
+    bool _failed = false;
+    mutable bool _sized = false;
+    mutable uint64_t _bytes = 0;
+    MYSQL_ROW _row = nullptr;
+    mutable unsigned long *_lengths = nullptr;
+    my_ulonglong _position = 0; // rows returned by next()
+    unsigned int _fields;
+};
+
+class MysqlConnection : public DriverConnection
+{
+public:
+    MysqlConnection();
+    ~MysqlConnection() override;
+    void setConnectTimeout(unsigned int seconds) override;
+    bool connect(const std::string &ip, unsigned short port, const std::string &user,
+                 const std::string &password, const std::string &dbname) override;
+    void close() override;
+    bool ping() override;
+    bool execute(const std::string &sql, uint64_t &affectedRows) override;
+    std::unique_ptr<ResultSet> query(const std::string &sql, bool stream) override;
+    std::string error() const override;
+    std::string quote(const std::string &value) override;
+    int64_t lastFetchUs() const override { return _fetchUs; }
+    void *native() override { return _conn; }
+
+private:
+    // mysql_store_result, timed: two clock reads next to a network read
+    MYSQL_RES *storeResult();
+
+    MYSQL *_conn; // MYSQL connection
+    int64_t _fetchUs = 0;
+    unsigned int _connectTimeout = 0; // seconds, 0 = driver default
+};
+
+class MysqlDriver : public Driver
+{
+public:
+    const char *name() const override { return "mysql"; }
+    std::unique_ptr<DriverConnection> open() override { return std::make_unique<MysqlConnection>(); }
+};
+
+#endif // CONNECTION_POOL_MYSQL_DRIVER_H
@@ -0,0 +1,22 @@
+/*
+ * @Description: Pool wide counts shared by basic_pool and the pool metrics
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_POOL_COUNTERS_H
+#define CONNECTION_POOL_POOL_COUNTERS_H
+
+#include <cstdint>
+
+// Pool wide counts, published together so they always add up
+struct PoolCounters
+{
+    int32_t idle = 0;     // in the idle queue
+    int32_t inUse = 0;    // lent to borrowers
+    int32_t creating = 0; // counted but still connecting
+    int32_t waiters = 0;  // borrowers blocked in getconnection
+    int32_t total = 0;    // idle + inUse + creating
+};
+
+#endif // CONNECTION_POOL_POOL_COUNTERS_H
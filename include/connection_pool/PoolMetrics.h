@@ -0,0 +1,91 @@
+/*
+ * @Description: Connection pool metrics, snapshots and Prometheus/JSON renderers
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_POOL_METRICS_H
+#define CONNECTION_POOL_POOL_METRICS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Histogram.hpp"
+#include "PoolCounters.h"
+#include "ProfiledMutex.hpp"
+#include "QueryProfiler.h"
+#include "StatementStats.h"
+
+struct ConnectionInfo
+{
+    uintptr_t id;        // same value as the flight recorder connection argument
+    bool inUse;
+    long ageMs;          // since opened or last reconnected
+    long stateMs;        // hold time when in use, idle time otherwise
+    uint64_t generation; // config generation it was opened with
+    uint64_t queries;    // statements sent since opened
+};
+
+// Recorded on the hot path: sharded counters and histograms, no shared cache line
+struct PoolMetrics
+{
+    ShardedCounter timeouts;           // getconnection gave up
+    ShardedCounter creations;          // connections opened
+    ShardedCounter creationFailures;   // opens that failed, kept and retried on borrow
+    ShardedCounter destructions;       // connections closed by the pool
+    ShardedCounter validations;        // pings on borrow, return and idle scan
+    ShardedCounter validationFailures;
+    ShardedCounter reconnects;
+    ShardedCounter reconnectFailures;
+    ShardedCounter retiredQueries;     // statements of connections already destroyed
+    ShardedCounter leaksDetected;      // leases held past leakDetectionThreshold
+    ShardedCounter leaksReclaimed;     // of those, slots given back after leakReclaimTimeout
+    Histogram acquireWait;             // us spent in getconnection, successful ones
+    Histogram holdTime;                // us between borrow and return
+};
+
+struct PoolMetricsSnapshot
+{
+    std::string pool; // "pool" label
+    uint64_t acquires = 0;
+    uint64_t timeouts = 0;
+    uint64_t creations = 0;
+    uint64_t creationFailures = 0;
+    uint64_t destructions = 0;
+    uint64_t validations = 0;
+    uint64_t validationFailures = 0;
+    uint64_t reconnects = 0;
+    uint64_t reconnectFailures = 0;
+    uint64_t queries = 0; // retired plus live connections
+    uint64_t leaksDetected = 0;
+    uint64_t leaksReclaimed = 0;
+    uint64_t slowQueries = 0;     // written to the slow query log
+    uint64_t slowQueryPlans = 0;  // of those, with an EXPLAIN plan
+    uint64_t resultMemoryBytes = 0;    // held by buffered results now
+    uint64_t resultMemoryBudget = 0;   // resultMemoryBudget, 0 = no limit
+    uint64_t resultMemoryWaits = 0;    // buffered selects that waited for the budget
+    uint64_t resultMemoryStreamed = 0; // ran streamed instead
+    uint64_t resultMemoryRejected = 0; // failed, by policy or after waiting
+    HistogramSnapshot acquireWait; // us
+    HistogramSnapshot holdTime;    // us
+    PoolCounters gauges;
+    int maxSize = 0;
+    std::vector<ConnectionInfo> connections;
+    // Profiled locks (profileLocks): the pool lock and the process wide logger
+    // queue lock, which every pool reports. Empty while never profiled
+    std::vector<LockProfileSnapshot> locks;
+    // Sampled latency breakdown (queryTimingSampling) of the fingerprints with
+    // the most total time
+    std::vector<FingerprintTiming> queryTimings;
+    // Statement table (statementStats), the fingerprints with the most total time
+    std::vector<StatementStat> statements;
+};
+
+// Prometheus text exposition format 0.0.4, durations in seconds
+std::string renderPrometheus(const std::vector<PoolMetricsSnapshot> &pools);
+
+// {"pools":[{...}]}, durations in microseconds with p50/p90/p99/p999/max
+std::string renderJson(const std::vector<PoolMetricsSnapshot> &pools);
+
+#endif // CONNECTION_POOL_POOL_METRICS_H
@@ -0,0 +1,94 @@
+/*
+ * @Description: Deterministic discrete-event simulation of pool scheduling on a virtual clock
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_POOL_SIMULATOR_H
+#define CONNECTION_POOL_POOL_SIMULATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "FakeDriver.h"
+#include "Histogram.hpp"
+
+// Simulated time, advanced by the event loop only. Per thread, so independent
+// simulations can run in parallel
+struct SimClock
+{
+    using rep = int64_t;
+    using period = std::micro;
+    using duration = std::chrono::microseconds;
+    using time_point = std::chrono::time_point<SimClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(duration(current())); }
+    static void set(time_point t) { current() = t.time_since_epoch().count(); }
+
+private:
+    static int64_t &current()
+    {
+        thread_local int64_t us = 0;
+        return us;
+    }
+};
+
+// One borrow: getconnection, hold it for serviceUs, return it
+struct SimRequest
+{
+    int64_t arrivalUs = 0;
+    int64_t serviceUs = -1; // < 0: sampled from the backend's queryLatency
+    bool high = false;      // Priority::HIGH
+};
+
+/**
+ * pool: initSize, maxSize, reservedSize, idleOrder, maxIdleTime,
+ *       connectionTimeout and the validation settings are honoured
+ * backend: connectLatency, queryLatency (hold time when a request has none),
+ *       pingLatency and the failure rates; seed makes a run reproducible
+ */
+struct SimConfig
+{
+    PoolConfig pool;
+    FakeDriverOptions backend;
+};
+
+struct SimResult
+{
+    uint64_t requests = 0;
+    uint64_t served = 0;
+    uint64_t timeouts = 0;
+    HistogramSnapshot acquireWait; // us, arrival until the connection is usable (incl. ping/reconnect)
+    HistogramSnapshot response;    // us, arrival until returned
+    int peakSize = 0;
+    double meanSize = 0;           // time weighted
+    int finalSize = 0;
+    uint64_t connects = 0;         // incl. failed ones
+    uint64_t validations = 0;
+    uint64_t validationFailures = 0;
+    uint64_t reconnects = 0;
+    uint64_t evictions = 0;        // closed for idling past maxIdleTime
+    int64_t simulatedUs = 0;
+    double wallSeconds = 0;
+};
+
+// Poisson arrivals at rate per second for durationUs, serviceUs sampled later
+std::vector<SimRequest> poissonArrivals(double rate, int64_t durationUs, uint64_t seed);
+
+// "arrival_us,service_us[,high]" per line, '#' comments. Throws std::runtime_error
+std::vector<SimRequest> loadArrivals(const std::string &filename);
+
+/**
+ * Runs the same basic_pool code as connection_pool (queue discipline, sizing,
+ * reservation, validation window, eviction) against SimClock. The grower is
+ * modelled as one creation in flight at a time, like the grower thread, and
+ * waiting borrowers are served first come first served. Same inputs, same result.
+ * Throws ConfigError when config.pool is invalid
+ */
+SimResult simulate(const SimConfig &config, const std::vector<SimRequest> &requests);
+
+#endif // CONNECTION_POOL_POOL_SIMULATOR_H
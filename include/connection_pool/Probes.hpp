@@ -0,0 +1,44 @@
+/*
+* @Description: USDT static tracepoints for bpftrace / perf
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+
+/**
+ * Provider "connection_pool". Built when CONNECTION_POOL_USDT is defined and
+ * <sys/sdt.h> (systemtap-sdt-dev) is available: each probe is a single nop until
+ * a tracer attaches. Otherwise the macros expand to nothing and their arguments
+ * are never evaluated. List them with `readelf -n <binary>` or
+ * `bpftrace -l 'usdt:<binary>:connection_pool:*'`, examples in scripts/bpftrace.
+ *
+ *   acquire__start(priority)               getconnection entered
+ *   acquire__done(conn, wait_us, ok)       fired in getconnection, conn is 0 when it timed out
+ *   release(conn, hold_us, requeued)       requeued 0 when the pool destroyed it
+ *   validate(conn, ok)                     ping
+ *   connect(conn, ok, duration_us)
+ *   reconnect(conn, ok, duration_us)
+ *   query__start(conn, sql)                sql is a NUL terminated string
+ *   query__done(conn, ok, rows, bytes)     rows -1 for a streamed result (rows are read later), bytes of the statement
+ *   log__enqueue(level, bytes)
+ *   log__drop(level)                       producer queue was full
+ */
+#if defined(CONNECTION_POOL_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CONNECTION_POOL_PROBES_ENABLED 1
+#endif
+#endif
+
+#ifdef CONNECTION_POOL_PROBES_ENABLED
+#define POOL_PROBE1(name, a) DTRACE_PROBE1(connection_pool, name, a)
+#define POOL_PROBE2(name, a, b) DTRACE_PROBE2(connection_pool, name, a, b)
+#define POOL_PROBE3(name, a, b, c) DTRACE_PROBE3(connection_pool, name, a, b, c)
+#define POOL_PROBE4(name, a, b, c, d) DTRACE_PROBE4(connection_pool, name, a, b, c, d)
+#else
+#define POOL_PROBE1(name, a) do {} while (0)
+#define POOL_PROBE2(name, a, b) do {} while (0)
+#define POOL_PROBE3(name, a, b, c) do {} while (0)
+#define POOL_PROBE4(name, a, b, c, d) do {} while (0)
+#endif
@@ -0,0 +1,244 @@
+/*
+* @Description: Mutex that can profile its wait and hold times per call site at runtime
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Histogram.hpp"
+
+// Hold statistics of one call site, sites are the tags given to lock()
+struct LockSiteStats {
+    const char* site = "";
+    uint64_t acquisitions = 0;
+    uint64_t holdNs = 0;     // total
+    uint64_t maxHoldNs = 0;
+};
+
+struct LockProfileSnapshot {
+    std::string name;
+    bool enabled = false;
+    uint64_t acquisitions = 0;      // while enabled
+    uint64_t contended = 0;         // try_lock failed, the caller had to wait
+    HistogramSnapshot waitNs;       // contended acquisitions only
+    HistogramSnapshot holdNs;
+    std::vector<LockSiteStats> sites; // longest single hold first
+};
+
+/**
+ * std::mutex plus optional profiling, switched with set_profiling() while it
+ * is in use. Off, lock() and unlock() cost one flag load and one branch
+ * more than the plain mutex and nothing is allocated. On, an acquisition first
+ * tries the lock and only times the ones that have to wait, so uncontended
+ * locking costs a clock read on each side. Statistics other than the
+ * histograms are updated while the mutex is held, so they need no atomics
+ */
+class ProfiledMutex {
+public:
+    static constexpr size_t kMaxSites = 16; // the rest is counted as "other"
+
+    explicit ProfiledMutex(const char* name = "mutex") : _name(name) {}
+    ~ProfiledMutex() { delete _profile.load(std::memory_order_relaxed); }
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    const char* name() const { return _name; }
+
+    // The statistics are kept when turned off and go on when turned on again
+    void set_profiling(bool on) {
+        if (on && _profile.load(std::memory_order_acquire) == nullptr) {
+            // Not under the mutex, the caller may be holding it
+            auto fresh = std::make_unique<Profile>();
+            Profile* expected = nullptr;
+            if (_profile.compare_exchange_strong(expected, fresh.get(), std::memory_order_acq_rel)) fresh.release();
+        }
+        _enabled.store(on, std::memory_order_release);
+    }
+    bool profiling() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // site: a string literal naming the caller, defaults to the mutex name
+    void lock(const char* site = nullptr) {
+        if (!_enabled.load(std::memory_order_acquire)) {
+            _mutex.lock();
+            return;
+        }
+        Profile* p = _profile.load(std::memory_order_acquire);
+        bool contended = !_mutex.try_lock();
+        uint64_t waited = 0;
+        if (contended) {
+            uint64_t start = nowNs();
+            _mutex.lock();
+            waited = nowNs() - start;
+        }
+        p->acquisitions++;
+        if (contended) {
+            p->contended++;
+            p->wait.record(waited);
+        }
+        beginHold(site);
+    }
+
+    bool try_lock(const char* site = nullptr) {
+        if (!_mutex.try_lock()) return false;
+        if (_enabled.load(std::memory_order_acquire)) {
+            _profile.load(std::memory_order_acquire)->acquisitions++;
+            beginHold(site);
+        }
+        return true;
+    }
+
+    void unlock() {
+        endHold();
+        _mutex.unlock();
+    }
+
+    // For condition variable waits, see ProfiledLock::wait
+    std::mutex& native() { return _mutex; }
+
+    // Caller holds the mutex and is about to release it inside a wait: close
+    // the current hold. Returns the site to pass to resume_hold(), which opens
+    // a new one after the wait, nullptr when this hold was not profiled
+    const char* pause_hold() {
+        const char* site = _lockedAt != 0 ? _site : nullptr;
+        endHold();
+        return site;
+    }
+    void resume_hold(const char* site) {
+        if (site != nullptr && _enabled.load(std::memory_order_acquire)) beginHold(site);
+    }
+
+    // Takes the mutex briefly, without recording it. Empty until profiling was
+    // first turned on
+    LockProfileSnapshot snapshot() const {
+        LockProfileSnapshot s;
+        s.name = _name;
+        s.enabled = profiling();
+        const Profile* p = _profile.load(std::memory_order_acquire);
+        if (p == nullptr) return s;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            s.acquisitions = p->acquisitions;
+            s.contended = p->contended;
+            s.sites.assign(p->sites, p->sites + p->siteCount);
+        }
+        s.waitNs = p->wait.snapshot();
+        s.holdNs = p->hold.snapshot();
+        std::sort(s.sites.begin(), s.sites.end(),
+                  [](const LockSiteStats& a, const LockSiteStats& b) { return a.maxHoldNs > b.maxHoldNs; });
+        return s;
+    }
+
+private:
+    struct Profile {
+        Histogram wait; // ns
+        Histogram hold; // ns
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        LockSiteStats sites[kMaxSites];
+        size_t siteCount = 0;
+    };
+
+    static uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Both under the mutex
+    void beginHold(const char* site) {
+        _site = site != nullptr ? site : _name;
+        _lockedAt = nowNs();
+    }
+
+    void endHold() {
+        if (_lockedAt == 0) return;
+        uint64_t held = nowNs() - _lockedAt;
+        _lockedAt = 0;
+        Profile* p = _profile.load(std::memory_order_relaxed);
+        p->hold.record(held);
+        LockSiteStats& stats = siteOf(*p, _site);
+        stats.acquisitions++;
+        stats.holdNs += held;
+        stats.maxHoldNs = std::max(stats.maxHoldNs, held);
+    }
+
+    // Tags are literals, compared by address first
+    static LockSiteStats& siteOf(Profile& p, const char* site) {
+        for (size_t i = 0; i < p.siteCount; i++) {
+            if (p.sites[i].site == site || std::strcmp(p.sites[i].site, site) == 0) return p.sites[i];
+        }
+        if (p.siteCount < kMaxSites - 1) {
+            p.sites[p.siteCount].site = site;
+            return p.sites[p.siteCount++];
+        }
+        if (p.siteCount == kMaxSites - 1) p.sites[p.siteCount++].site = "other";
+        return p.sites[kMaxSites - 1];
+    }
+
+    const char* _name;
+    mutable std::mutex _mutex;
+    std::atomic<bool> _enabled{false};
+    std::atomic<Profile*> _profile{nullptr}; // allocated once, on first enable
+    // Current holder, only touched by it
+    const char* _site = nullptr;
+    uint64_t _lockedAt = 0; // 0: this hold is not profiled
+};
+
+/**
+ * unique_lock for a ProfiledMutex with a call-site tag. Condition variable
+ * waits go through wait()/wait_for() so the time spent waiting, with the mutex
+ * released, is not counted as hold time
+ */
+class ProfiledLock {
+public:
+    ProfiledLock(ProfiledMutex& mutex, const char* site) : _mutex(mutex), _site(site) { lock(); }
+    ~ProfiledLock() {
+        if (_owns) _mutex.unlock();
+    }
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+    void lock() {
+        _mutex.lock(_site);
+        _owns = true;
+    }
+    void unlock() {
+        _mutex.unlock();
+        _owns = false;
+    }
+    bool owns_lock() const { return _owns; }
+
+    template <typename Predicate>
+    void wait(std::condition_variable& cv, Predicate ready) {
+        const char* site = _mutex.pause_hold();
+        std::unique_lock<std::mutex> native(_mutex.native(), std::adopt_lock);
+        cv.wait(native, ready);
+        native.release();
+        _mutex.resume_hold(site);
+    }
+
+    template <typename Rep, typename Period, typename Predicate>
+    bool wait_for(std::condition_variable& cv, std::chrono::duration<Rep, Period> timeout, Predicate ready) {
+        const char* site = _mutex.pause_hold();
+        std::unique_lock<std::mutex> native(_mutex.native(), std::adopt_lock);
+        bool result = cv.wait_for(native, timeout, ready);
+        native.release();
+        _mutex.resume_hold(site);
+        return result;
+    }
+
+private:
+    ProfiledMutex& _mutex;
+    const char* _site;
+    bool _owns = false;
+};
@@ -0,0 +1,103 @@
+/*
+ * @Description: Sampled per statement latency breakdown, aggregated per SQL fingerprint
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_QUERY_PROFILER_H
+#define CONNECTION_POOL_QUERY_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Driver.h"
+#include "FingerprintTable.hpp"
+
+/**
+ * Where the time of one statement went, in us. Network and server time cannot
+ * be told apart from the client directly: the round trip of the connection's
+ * last pings stands in for the network part of the statement's round trip,
+ * the rest is the server's. Without validation pings it is all server time
+ */
+struct QueryPhases
+{
+    uint32_t waitUs = 0;    // getconnection(), charged to the first statement of the lease
+    uint32_t networkUs = 0; // estimated round trip plus receiving the result (streamed rows too)
+    uint32_t serverUs = 0;  // statement round trip minus the estimated network round trip
+    uint32_t decodeUs = 0;  // reading the rows of a buffered result through ResultSet::next()
+    uint32_t totalUs = 0;   // the four above
+};
+
+// One timed statement, handed to the span callback
+struct QuerySpan
+{
+    std::string sql;        // as sent
+    std::string normalized; // fingerprintSql(sql).normalized
+    uint64_t fingerprint = 0;
+    uintptr_t connection = 0;  // same value as ConnectionInfo::id
+    int64_t startEpochUs = 0;  // wall clock when the lease wait or statement began
+    QueryPhases phases;
+    uint64_t rows = 0;         // read, or affected by an update
+    bool ok = false;
+};
+
+// Phase sums of the sampled statements of one fingerprint
+struct FingerprintTiming
+{
+    uint64_t fingerprint = 0;  // 0 collects the fingerprints past kMaxFingerprints
+    std::string normalized;
+    uint64_t samples = 0;
+    uint64_t waitUs = 0;
+    uint64_t networkUs = 0;
+    uint64_t serverUs = 0;
+    uint64_t decodeUs = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxTotalUs = 0;
+};
+
+/**
+ * One per pool, shared with its connections. Only 1 in sampling() statements
+ * per thread is timed and fingerprinted, the others pay a thread local
+ * counter, so sampling 1 in 100 costs well below 1% of a statement
+ */
+class QueryProfiler : public std::enable_shared_from_this<QueryProfiler>
+{
+public:
+    static constexpr size_t kMaxFingerprints = 1024;
+    using Callback = std::function<void(const QuerySpan &)>;
+
+    // 1 in everyN statements, 0 = off
+    void setSampling(int everyN) { _sampling.store(everyN, std::memory_order_relaxed); }
+    int sampling() const { return _sampling.load(std::memory_order_relaxed); }
+    bool sample() const;
+
+    // Called on the thread that finished the statement (for a result set, the
+    // one that destroyed it); empty removes it
+    void setCallback(Callback callback);
+
+    // Phases of a statement from its round trip, the part of it spent receiving
+    // the result and the connection's ping round trip (0 when unknown)
+    static QueryPhases split(int64_t waitUs, int64_t roundTripUs, int64_t fetchUs, int64_t pingUs);
+
+    // Sets totalUs, fingerprints the span, aggregates it and passes it to the callback
+    void record(QuerySpan &span);
+
+    // Most total time first, at most limit entries
+    std::vector<FingerprintTiming> top(size_t limit) const { return _table.top(limit); }
+    void reset() { _table.reset(); }
+
+    // Times ResultSet::next() of a sampled select and records the span when
+    // the rows are destroyed. streamed: row reads count as network time
+    std::unique_ptr<ResultSet> timeRows(std::unique_ptr<ResultSet> rows, QuerySpan span, bool streamed);
+
+private:
+    std::atomic<int> _sampling{0};
+    std::shared_ptr<const Callback> _callback; // std::atomic_load/store
+    FingerprintTable<FingerprintTiming, 16, kMaxFingerprints> _table;
+};
+
+#endif // CONNECTION_POOL_QUERY_PROFILER_H
@@ -0,0 +1,162 @@
+/*
+ * @Description: Opt-in capture of borrows and statements into a binary trace file for replay
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_QUERY_TRACE_H
+#define CONNECTION_POOL_QUERY_TRACE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Record kinds, stable on disk: pool_replay and scripts/trace_decode.py rely on the values
+ */
+enum class TraceKind : uint8_t
+{
+    BORROW = 1, // durationUs: acquire wait
+    RETURN = 2, // durationUs: hold time
+    QUERY = 3,  // select/query, resultSize: rows (0 when streamed)
+    UPDATE = 4, // update, resultSize: affected rows
+    DICT = 5,   // fingerprint -> normalized text, resultSize bytes follow padded to 8
+};
+
+/**
+ * One 48 bytes record. Literal values are never stored, only their hash, so a
+ * trace can leave the machine without leaking data
+ */
+struct TraceRecord
+{
+    uint64_t timeUs;      // since the trace started
+    uint64_t connection;  // connection address, pairs BORROW, statements and RETURN
+    uint64_t fingerprint; // SqlFingerprint::hash, 0 for BORROW/RETURN
+    uint64_t paramsHash;  // SqlFingerprint::paramsHash
+    uint32_t durationUs;
+    uint32_t resultSize;
+    uint32_t thread;      // small per process thread number, in order of first record
+    uint8_t kind;         // TraceKind
+    uint8_t ok;
+    uint16_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 48, "TraceRecord layout is part of the trace format");
+
+// File layout: TraceHeader | TraceRecord... (DICT records followed by their text)
+struct TraceHeader
+{
+    char magic[8];         // "CPTRACE1"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t startEpochUs; // wall clock at timeUs 0
+    uint64_t reserved;
+};
+static_assert(sizeof(TraceHeader) == 32, "TraceHeader layout is part of the trace format");
+
+/**
+ * Process wide recorder, off unless started. When off every hook is one relaxed
+ * load. When on a statement costs a fingerprint pass and a push into a bounded
+ * lock-free ring; a background thread drains the ring into the file through a
+ * memory-mapped window, so no caller ever waits on disk. Records that do not fit
+ * in the ring are dropped and counted, the trace never applies backpressure
+ */
+class QueryTrace
+{
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kDefaultCapacity = 1 << 16; // records, power of two
+
+    static QueryTrace &instance();
+
+    // Truncates path. False when already tracing or the file cannot be created
+    bool start(const std::string &path, size_t capacity = kDefaultCapacity);
+    // Flushes everything recorded so far and closes the file
+    void stop();
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+    std::string path() const;
+
+    uint64_t recorded() const { return _recorded.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    void borrow(const void *conn, int64_t waitUs);
+    void release(const void *conn, int64_t holdUs);
+    void statement(TraceKind kind, const void *conn, std::string_view sql, int64_t durationUs,
+                   uint64_t resultSize, bool ok);
+
+    ~QueryTrace();
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        TraceRecord record;
+    };
+    // Vyukov bounded queue, many producers and the writer thread as consumer
+    struct Ring
+    {
+        explicit Ring(size_t capacity);
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueue{0};
+        alignas(64) size_t dequeue = 0;
+    };
+
+    QueryTrace();
+    QueryTrace(const QueryTrace &) = delete;
+    QueryTrace &operator=(const QueryTrace &) = delete;
+
+    uint64_t sinceStart(int64_t at) const;
+    void push(const TraceRecord &record);
+    bool pop(Ring &ring, TraceRecord &record);
+    void writerTask();
+    void drain();
+    bool write(const void *data, size_t size);
+    bool remap(size_t offset);
+
+    std::atomic<bool> _enabled{false};
+    std::atomic<uint64_t> _recorded{0};
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _epoch{0}; // bumped per start, invalidates per thread fingerprint caches
+    std::atomic<int64_t> _startUs{0}; // steady clock
+
+    // A producer may still hold the ring of a stopped trace, rings are never freed
+    // while the process runs, a restart with the same capacity reuses the last one
+    std::atomic<Ring *> _ring{nullptr};
+    std::vector<std::unique_ptr<Ring>> _rings;
+
+    // Fingerprints whose text is already in the file, and texts still to write
+    std::mutex _dictMutex;
+    std::unordered_set<uint64_t> _known;
+    std::vector<std::pair<uint64_t, std::string>> _pendingText;
+
+    // Writer side, only touched by the writer thread and start/stop
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop = false;
+    std::thread _writer;
+    std::string _path;
+    int _fd = -1;
+    char *_window = nullptr;
+    size_t _windowOffset = 0; // file offset of _window
+    size_t _size = 0;         // bytes written
+};
+
+// Load a trace file, text of every fingerprint and the records in file order.
+// Throws std::runtime_error when it is not a trace
+struct TraceFile
+{
+    TraceHeader header;
+    std::unordered_map<uint64_t, std::string> text;
+    std::vector<TraceRecord> records; // DICT records excluded
+};
+TraceFile loadTrace(const std::string &path);
+
+#endif // CONNECTION_POOL_QUERY_TRACE_H
@@ -0,0 +1,81 @@
+/*
+ * @Description: Memory held by buffered result sets, with a pool wide budget
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_RESULT_MEMORY_H
+#define CONNECTION_POOL_RESULT_MEMORY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "Driver.h"
+
+/**
+ * One per pool, shared with its connections. Every buffered result is charged
+ * its ResultSet::memoryBytes() until the caller destroys it. The size of a
+ * result is only known once it is buffered, so the budget is checked before a
+ * buffered select is sent: while the pool is at or over it, the select waits
+ * for memory to be released, runs streamed instead, or fails, depending on the
+ * policy. Selects admitted together can overshoot the budget by their own size
+ */
+class ResultMemory : public std::enable_shared_from_this<ResultMemory>
+{
+public:
+    enum class Policy
+    {
+        WAIT,   // until enough is released, failing after the wait timeout
+        STREAM, // fetch the rows while they are read, nothing is buffered
+        FAIL,
+    };
+    enum class Admission
+    {
+        BUFFERED,
+        STREAMED,
+        REJECTED,
+    };
+
+    // budget 0: no limit and nothing is charged. Results already charged
+    // keep their charge until destroyed
+    void configure(uint64_t budget, Policy policy, std::chrono::milliseconds waitTimeout);
+
+    // Before a buffered select, may block under Policy::WAIT for the wait
+    // timeout in total
+    Admission admit();
+    // Charges a buffered result until it is destroyed, while there is a budget
+    std::unique_ptr<ResultSet> charge(std::unique_ptr<ResultSet> rows);
+
+    uint64_t used() const { return _used.load(std::memory_order_relaxed); }
+    uint64_t budget() const { return _budget.load(std::memory_order_relaxed); }
+    uint64_t waits() const { return _waits.load(std::memory_order_relaxed); }
+    uint64_t streamed() const { return _streamed.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return _rejected.load(std::memory_order_relaxed); }
+
+    void release(uint64_t bytes);
+
+private:
+    bool available() const
+    {
+        uint64_t limit = _budget.load();
+        return limit == 0 || _used.load() < limit;
+    }
+
+    std::atomic<uint64_t> _used{0};
+    std::atomic<uint64_t> _budget{0};
+    std::atomic<Policy> _policy{Policy::WAIT};
+    std::atomic<int64_t> _waitMs{0};
+    std::atomic<uint64_t> _waits{0};
+    std::atomic<uint64_t> _streamed{0};
+    std::atomic<uint64_t> _rejected{0};
+
+    std::mutex _mutex; // only for _released
+    std::condition_variable _released;
+    std::atomic<int> _waiters{0}; // release() skips the lock while nobody waits
+};
+
+#endif // CONNECTION_POOL_RESULT_MEMORY_H
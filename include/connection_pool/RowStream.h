@@ -0,0 +1,134 @@
+/*
+ * @Description: Streamed select read ahead into a bounded ring of row batches
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_ROW_STREAM_H
+#define CONNECTION_POOL_ROW_STREAM_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Driver.h"
+
+// A batch of rows copied out of the driver, NUL terminated like MYSQL_ROW
+struct RowBatch
+{
+    struct Field
+    {
+        size_t offset;
+        unsigned long length;
+        bool null;
+    };
+    std::string data;
+    std::vector<Field> fields; // rows * fieldCount
+    size_t rows = 0;
+
+    void clear()
+    {
+        data.clear();
+        fields.clear();
+        rows = 0;
+    }
+    // Copies the current row of source, its first count fields
+    void append(const ResultSet &source, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const char *value = source.field(i);
+            unsigned long length = value ? source.fieldLength(i) : 0;
+            fields.push_back({data.size(), length, value == nullptr});
+            if (value)
+                data.append(value, length);
+            data.push_back('\0');
+        }
+        rows++;
+    }
+};
+
+// One row of RowStream, only valid during the callback it is passed to
+class StreamRow
+{
+public:
+    StreamRow(const RowBatch &batch, size_t row, unsigned int fields) : _batch(batch), _row(row), _fields(fields) {}
+    unsigned int fieldCount() const { return _fields; }
+    // nullptr for SQL NULL
+    const char *field(unsigned int index) const
+    {
+        const RowBatch::Field &f = at(index);
+        return f.null ? nullptr : _batch.data.data() + f.offset;
+    }
+    unsigned long fieldLength(unsigned int index) const { return at(index).length; }
+
+private:
+    const RowBatch::Field &at(unsigned int index) const { return _batch.fields[_row * _fields + index]; }
+
+    const RowBatch &_batch;
+    size_t _row;
+    unsigned int _fields;
+};
+
+/**
+ * Rows of a streamed select handed to a callback on the calling thread while
+ * a reader thread fetches the next ones, so network reads overlap with the
+ * processing. The reader copies rows into a ring of kBatches batches and
+ * waits while every batch is full; a batch closes at kBatchRows rows or
+ * kBatchBytes of field data, so memory stays the same whatever the size of
+ * the result. A row larger than kBatchBytes gets a batch of its own, which is
+ * given back once consumed
+ */
+class RowStream
+{
+public:
+    // false stops the stream
+    using Callback = std::function<bool(const StreamRow &)>;
+    static constexpr size_t kBatches = 4;
+    static constexpr size_t kBatchRows = 1024;
+    static constexpr size_t kBatchBytes = 256 * 1024;
+
+    enum class Status
+    {
+        FINISHED,  // every row was handed to the callback
+        CANCELLED, // the callback returned false or threw
+        FAILED,    // the fetch broke off (ResultSet::failed()), or the select failed
+    };
+
+    // rows: a streamed result, read on the reader thread only
+    explicit RowStream(std::unique_ptr<ResultSet> rows);
+    RowStream(const RowStream &) = delete;
+    RowStream &operator=(const RowStream &) = delete;
+
+    // Blocks until the stream ends. The result is freed, and so the session
+    // drained, before it returns, also when the callback throws
+    Status run(const Callback &onRow);
+    uint64_t rows() const { return _delivered; }
+
+private:
+    void readTask();
+    // Fills one batch, false at the end of the result or when cancelled
+    bool fill(RowBatch &batch);
+
+    std::unique_ptr<ResultSet> _rows;
+    const unsigned int _fields;
+    std::array<RowBatch, kBatches> _ring;
+
+    std::mutex _mutex; // _written, _consumed, _done, _failed
+    std::condition_variable _filled;
+    std::condition_variable _freed;
+    uint64_t _written = 0;  // batches the reader published
+    uint64_t _consumed = 0; // batches the callback is done with
+    bool _done = false;
+    bool _failed = false;
+    std::atomic<bool> _cancelled{false};
+    uint64_t _delivered = 0;
+};
+
+#endif // CONNECTION_POOL_ROW_STREAM_H
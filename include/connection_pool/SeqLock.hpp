@@ -0,0 +1,61 @@
+/*
+* @Description: Sequence lock for publishing small snapshots to lock-free readers
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/**
+ * Writers must be serialized by the caller (e.g. they already hold the pool
+ * lock). Readers never block a writer: they copy and retry when a write
+ * overlapped. The value is kept in atomic words so the copy is race free
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() { store(T{}); }
+
+    void store(const T& value) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t words[kWords];
+        for (unsigned spins = 0;; spins++) {
+            uint32_t before = _seq.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (size_t i = 0; i < kWords; i++) {
+                    words[i] = _words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == before) break;
+            }
+            // A writer was preempted mid-store, let it finish
+            if (spins > 64) std::this_thread::yield();
+        }
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    std::atomic<uint32_t> _seq{0};
+    std::atomic<uint64_t> _words[kWords];
+};
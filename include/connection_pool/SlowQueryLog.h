@@ -0,0 +1,119 @@
+/*
+ * @Description: Slow statement log with sampled EXPLAIN plans, written to its own sink
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_SLOW_QUERY_LOG_H
+#define CONNECTION_POOL_SLOW_QUERY_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "LeakDetector.h"
+#include "LogSink.hpp"
+#include "QueryProfiler.h"
+
+class connection;
+
+// A statement that took slowQueryThreshold or longer
+struct SlowQuery
+{
+    std::string sql;
+    uintptr_t connection = 0; // same value as ConnectionInfo::id
+    int64_t startEpochUs = 0;
+    QueryPhases phases;       // wait, network and server, see QueryProfiler::split
+    uint64_t rows = 0;        // buffered rows read, or affected by an update
+    bool ok = false;
+    std::shared_ptr<const BorrowSite> site; // stack of the thread that ran it
+};
+
+/**
+ * One per pool, shared with its connections. record() runs on the slow
+ * statement's thread: it formats the entry and offers it to the sink, which
+ * writes it from its own thread. One in explainSampling slow statements is
+ * instead handed to an explain thread, which runs EXPLAIN FORMAT=JSON for it
+ * on a connection of its own, opened on first use outside the pool's count,
+ * and logs the entry with the plan. At most kMaxPendingExplains wait for it,
+ * further ones are logged without a plan
+ */
+class SlowQueryLog
+{
+public:
+    // Opens the explain connection, nullptr when it cannot
+    using Opener = std::function<std::unique_ptr<connection>()>;
+    static constexpr size_t kMaxPendingExplains = 16;
+    static constexpr size_t kMaxFileSize = 100 * 1024 * 1024;
+
+    SlowQueryLog(std::string pool, Opener opener);
+    ~SlowQueryLog();
+    SlowQueryLog(const SlowQueryLog &) = delete;
+    SlowQueryLog &operator=(const SlowQueryLog &) = delete;
+
+    // threshold 0 turns the log off. path: rotating file written unless a
+    // sink was set, opened again when it changes
+    void configure(std::chrono::microseconds threshold, int explainSampling, const std::string &path);
+    // Replaces the file, e.g. a RingSink or SyslogSink; nullptr goes back to it
+    void setSink(std::shared_ptr<LogSink> sink);
+
+    int64_t thresholdUs() const { return _thresholdUs.load(std::memory_order_relaxed); }
+    bool enabled() const { return thresholdUs() > 0; }
+    bool slow(int64_t latencyUs) const { return enabled() && latencyUs >= thresholdUs(); }
+
+    void record(SlowQuery query);
+
+    // Joins the explain thread and closes its connection, entries still
+    // waiting for a plan are logged without one
+    void stop();
+
+    uint64_t logged() const { return _logged.load(std::memory_order_relaxed); }
+    uint64_t explained() const { return _explained.load(std::memory_order_relaxed); }
+
+    // Statements MySQL can EXPLAIN, from their normalized text
+    static bool explainable(std::string_view normalized);
+    // EXPLAIN FORMAT=JSON is pretty printed, this drops whitespace outside strings
+    static std::string compactJson(std::string_view json);
+
+private:
+    struct Entry
+    {
+        SlowQuery query;
+        std::string normalized;
+        uint64_t fingerprint = 0;
+    };
+
+    void write(const Entry &entry, const std::string &plan);
+    void explainTask();
+    std::string explain(const std::string &sql);
+
+    const std::string _pool;
+    const Opener _opener;
+    std::atomic<int64_t> _thresholdUs{0};
+    std::atomic<int> _explainSampling{0};
+    std::atomic<uint64_t> _slowCount{0};
+    std::atomic<uint64_t> _logged{0};
+    std::atomic<uint64_t> _explained{0};
+
+    std::mutex _sinkMutex; // _sink, _customSink and _path
+    std::shared_ptr<LogSink> _sink;
+    bool _customSink = false;
+    std::string _path;
+
+    std::mutex _mutex; // explain queue and thread
+    std::condition_variable _wake;
+    std::deque<Entry> _pending;
+    std::thread _explainer;
+    bool _stopping = false;
+    std::unique_ptr<connection> _explainConn; // explain thread only
+};
+
+#endif // CONNECTION_POOL_SLOW_QUERY_LOG_H
@@ -0,0 +1,44 @@
+/*
+ * @Description: Normalized SQL text and hashes that group statements by shape
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_SQL_FINGERPRINT_H
+#define CONNECTION_POOL_SQL_FINGERPRINT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * One pass over the statement: comments dropped, whitespace kept only between words,
+ * words lower-cased, string and number literals replaced by ?, and lists of them
+ * ("IN (1, 2, 3)", multi-row VALUES) collapsed to one ?. Quoted identifiers
+ * keep their case.
+ *   SELECT * FROM t WHERE id IN (1,2,3) AND name='x'  -> select * from t where id in(?) and name=?
+ */
+struct SqlFingerprint
+{
+    std::string normalized;
+    uint64_t hash = 0;       // of normalized, same statement shape = same hash
+    uint64_t paramsHash = 0; // of the literal values, in order
+};
+
+SqlFingerprint fingerprintSql(std::string_view sql);
+// Same, into fp, reusing the capacity of fp.normalized: no allocation on a hot
+// path that keeps one SqlFingerprint per thread
+void fingerprintSql(std::string_view sql, SqlFingerprint &fp);
+
+// FNV-1a, shared by fingerprints and trace dictionaries
+inline uint64_t fnv1a(std::string_view text, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+#endif // CONNECTION_POOL_SQL_FINGERPRINT_H
@@ -0,0 +1,66 @@
+/*
+ * @Description: Client side statistics of every statement, per SQL fingerprint
+ * @Author: abellli
+ * @Date: 2026-10-17
+ * @LastEditTime: 2026-10-17
+ */
+#ifndef CONNECTION_POOL_STATEMENT_STATS_H
+#define CONNECTION_POOL_STATEMENT_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Driver.h"
+#include "FingerprintTable.hpp"
+
+// Totals of one statement shape since the pool started or the last reset()
+struct StatementStat
+{
+    uint64_t fingerprint = 0; // 0 collects the shapes past kMaxStatements
+    std::string normalized;
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    uint64_t rows = 0;    // read through the result, or affected by an update
+    uint64_t bytes = 0;   // statement text sent plus field bytes read
+    uint64_t totalUs = 0; // statement round trip, plus reading the rows of a streamed result
+    uint64_t maxUs = 0;
+
+    uint64_t meanUs() const { return calls > 0 ? totalUs / calls : 0; }
+};
+
+/**
+ * Like pg_stat_statements, from the client: one pool wide table keyed by the
+ * fingerprint of each statement (fingerprintSql), shared with the pool's
+ * connections. At most kMaxStatements shapes, see FingerprintTable
+ */
+class StatementStats : public std::enable_shared_from_this<StatementStats>
+{
+public:
+    static constexpr size_t kMaxStatements = 5000;
+
+    void setEnabled(bool on) { _enabled.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    void record(std::string_view sql, int64_t latencyUs, uint64_t rows, uint64_t bytes, bool ok);
+
+    // Most total time first, at most limit entries
+    std::vector<StatementStat> top(size_t limit) const { return _table.top(limit); }
+    size_t size() const { return _table.size(); }
+    void reset() { _table.reset(); }
+
+    // Counts the rows and field bytes read from a select's result and records
+    // the statement when the rows are destroyed. streamed: reading is part of
+    // the statement's time
+    std::unique_ptr<ResultSet> countRows(std::unique_ptr<ResultSet> rows, std::string sql, int64_t latencyUs,
+                                         bool streamed);
+
+private:
+    std::atomic<bool> _enabled{false};
+    FingerprintTable<StatementStat, 32, kMaxStatements> _table;
+};
+
+#endif // CONNECTION_POOL_STATEMENT_STATS_H
@@ -0,0 +1,15 @@
+/*
+* @Description: Monotonic microsecond clock for statement and lease timings
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Only differences of two readings mean anything
+inline int64_t steadyUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Decode a flight recorder dump (or /dev/shm segment) into time ordered text.
+
+Usage: flight_decode.py flight_recorder.bin
+       flight_decode.py /dev/shm/<name>
+"""
+import struct
+import sys
+
+EVENTS = {1: "BORROW", 2: "RETURN", 3: "VALIDATE", 4: "RECONNECT",
+          5: "CONNECT", 6: "DESTROY", 7: "TIMEOUT"}
+HEADER_SIZE = 64
+SLOT_HEADER_SIZE = 64
+RECORD = struct.Struct("<QIHHQQ")
+
+
+def decode(data):
+    magic, version, max_threads, per_thread, _, pid = struct.unpack_from("<IIIIII", data, 0)
+    if magic != 0x43455246:
+        raise SystemExit("not a flight recorder dump")
+    ticks_base, ns_base, ticks_dump, ns_dump = struct.unpack_from("<QQQQ", data, 24)
+    ns_per_tick = (ns_dump - ns_base) / (ticks_dump - ticks_base) if ticks_dump > ticks_base else 1.0
+    slot_size = SLOT_HEADER_SIZE + RECORD.size * per_thread
+    records = []
+    for slot in range(max_threads):
+        base = HEADER_SIZE + slot * slot_size
+        head, tid = struct.unpack_from("<QI", data, base)
+        first = max(0, head - per_thread)
+        for pos in range(first, head):
+            off = base + SLOT_HEADER_SIZE + (pos % per_thread) * RECORD.size
+            ticks, seq, event, _, arg0, arg1 = RECORD.unpack_from(data, off)
+            if seq != (pos + 1) & 0xFFFFFFFF:
+                continue  # torn or overwritten
+            ts = ns_base + (ticks - ticks_base) * ns_per_tick
+            records.append((ts, tid, EVENTS.get(event, str(event)), arg0, arg1))
+    records.sort()
+    print(f"pid={pid} version={version} records={len(records)}")
+    try:
+        for ts, tid, event, arg0, arg1 in records:
+            print(f"{ts / 1e9:.9f} tid={tid} {event:<9} arg0={arg0:#x} arg1={arg1}")
+    except BrokenPipeError:
+        pass
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        raise SystemExit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        decode(f.read())
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Compare two Google Benchmark JSON files written with --benchmark_repetitions.
+
+Each benchmark's repetitions are treated as samples. The 95% confidence
+interval of the relative difference in means (Welch) decides: a benchmark
+regressed when the whole interval lies above +threshold, i.e. it is slower by
+at least --threshold percent with 95% confidence. Significant changes smaller
+than that are reported as slower/faster. Exit status 1 when anything
+regressed, so CI can gate on it.
+
+Usage: perf_compare.py [--threshold=5] [--metric=real_time|cpu_time] baseline.json current.json
+"""
+import json
+import math
+import sys
+
+# Two sided 95% Student t quantiles by degrees of freedom
+T975 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+T975_TAIL = [(40, 2.021), (60, 2.000), (120, 1.980)]
+TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def t975(df):
+    df = max(1, int(math.floor(df)))  # rounding down is conservative
+    if df <= len(T975):
+        return T975[df - 1]
+    for limit, t in T975_TAIL:
+        if df <= limit:
+            return t
+    return 1.960
+
+
+def load(path, metric):
+    with open(path) as f:
+        data = json.load(f)
+    samples = {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type", "iteration") != "iteration" or b.get("error_occurred"):
+            continue
+        name = b.get("run_name", b["name"])
+        samples.setdefault(name, []).append(b[metric] * TO_NS.get(b.get("time_unit", "ns"), 1.0))
+    return data.get("context", {}), samples
+
+
+def describe(values):
+    n = len(values)
+    mean = sum(values) / n
+    var = sum((v - mean) ** 2 for v in values) / (n - 1) if n > 1 else 0.0
+    return n, mean, var
+
+
+def compare(base, cur):
+    """Relative change of the mean and its 95% interval, or None without enough samples"""
+    n1, m1, v1 = describe(base)
+    n2, m2, v2 = describe(cur)
+    change = (m2 - m1) / m1
+    if n1 < 2 or n2 < 2:
+        return change, None, None
+    se2 = v1 / n1 + v2 / n2
+    if se2 == 0:
+        return change, change, change
+    df = se2 ** 2 / ((v1 / n1) ** 2 / (n1 - 1) + (v2 / n2) ** 2 / (n2 - 1))
+    half = t975(df) * math.sqrt(se2)
+    return change, (m2 - m1 - half) / m1, (m2 - m1 + half) / m1
+
+
+def fmt_ns(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.3g}{unit}"
+    return f"{ns:.3g}ns"
+
+
+def main(argv):
+    threshold = 5.0
+    metric = "real_time"
+    files = []
+    for arg in argv:
+        if arg.startswith("--threshold="):
+            threshold = float(arg.split("=", 1)[1])
+        elif arg.startswith("--metric="):
+            metric = arg.split("=", 1)[1]
+        elif arg.startswith("--"):
+            raise SystemExit(__doc__)
+        else:
+            files.append(arg)
+    if len(files) != 2 or metric not in ("real_time", "cpu_time"):
+        raise SystemExit(__doc__)
+    base_ctx, base = load(files[0], metric)
+    cur_ctx, cur = load(files[1], metric)
+    for key in ("num_cpus", "library_build_type", "host_name"):
+        if base_ctx.get(key) != cur_ctx.get(key):
+            print(f"warning: {key} differs: {base_ctx.get(key)} vs {cur_ctx.get(key)}")
+
+    regressions = 0
+    print(f"{'benchmark':<44} {'baseline':>10} {'current':>10} {'change':>8}  {'95% interval':<19} verdict")
+    for name in sorted(set(base) | set(cur)):
+        if name not in cur:
+            print(f"{name:<44} {fmt_ns(describe(base[name])[1]):>10} {'-':>10} {'':>8}  {'':<19} missing")
+            continue
+        if name not in base:
+            print(f"{name:<44} {'-':>10} {fmt_ns(describe(cur[name])[1]):>10} {'':>8}  {'':<19} new")
+            continue
+        change, low, high = compare(base[name], cur[name])
+        if low is None:
+            interval, verdict = "", "need repetitions"
+        else:
+            interval = f"[{low * 100:+.1f}%, {high * 100:+.1f}%]"
+            if low * 100 >= threshold:
+                verdict = "REGRESSION"
+                regressions += 1
+            elif high * 100 <= -threshold:
+                verdict = "improved"
+            elif low > 0:
+                verdict = "slower"
+            elif high < 0:
+                verdict = "faster"
+            else:
+                verdict = "same"
+        print(f"{name:<44} {fmt_ns(describe(base[name])[1]):>10} {fmt_ns(describe(cur[name])[1]):>10} "
+              f"{change * 100:>+7.1f}%  {interval:<19} {verdict}")
+    if regressions:
+        print(f"{regressions} benchmark(s) slower by more than {threshold:g}% with 95% confidence")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
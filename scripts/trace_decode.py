@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Decode a query trace (QueryTrace / traceFile) into text, a per fingerprint
+summary, or pool_sim arrivals.
+
+Usage: trace_decode.py run.trace              one line per record
+       trace_decode.py --summary run.trace    count and latency per fingerprint
+       trace_decode.py --sim-csv run.trace    arrival_us,service_us per borrow for pool_sim --trace
+"""
+import struct
+import sys
+
+KINDS = {1: "BORROW", 2: "RETURN", 3: "QUERY", 4: "UPDATE", 5: "DICT"}
+HEADER = struct.Struct("<8sIIQQ")
+RECORD = struct.Struct("<QQQQIIIBBH")
+
+
+def load(data):
+    magic, version, record_size, start_epoch_us, _ = HEADER.unpack_from(data, 0)
+    if magic != b"CPTRACE1" or record_size != RECORD.size:
+        raise SystemExit("not a query trace")
+    text, records = {}, []
+    off = HEADER.size
+    while off + RECORD.size <= len(data):
+        r = RECORD.unpack_from(data, off)
+        off += RECORD.size
+        time_us, conn, fingerprint, params, duration, size, thread, kind, ok, _ = r
+        if kind == 0:
+            break  # zeroed tail of a trace that was not stopped
+        if kind == 5:
+            text[fingerprint] = data[off:off + size].decode("utf-8", "replace")
+            off += (size + 7) // 8 * 8
+            continue
+        records.append((time_us, thread, kind, conn, fingerprint, params, duration, size, ok))
+    return version, start_epoch_us, text, records
+
+
+def dump(start_epoch_us, text, records):
+    print(f"start={start_epoch_us / 1e6:.6f} records={len(records)} fingerprints={len(text)}")
+    for time_us, thread, kind, conn, fingerprint, params, duration, size, ok in sorted(records):
+        line = f"{time_us / 1e6:.6f} t{thread:<3} {KINDS.get(kind, str(kind)):<6} conn={conn:#x} {duration}us"
+        if kind in (3, 4):
+            line += f" rows={size}{'' if ok else ' FAILED'} params={params:016x} {text.get(fingerprint, hex(fingerprint))}"
+        print(line)
+
+
+def summary(text, records):
+    stats = {}
+    for _, _, kind, _, fingerprint, _, duration, _, ok in records:
+        if kind not in (3, 4):
+            continue
+        s = stats.setdefault(fingerprint, [])
+        s.append(duration)
+    print(f"{'count':>8} {'p50_us':>8} {'p99_us':>8} {'total_ms':>10}  statement")
+    for fingerprint, durations in sorted(stats.items(), key=lambda kv: -sum(kv[1])):
+        durations.sort()
+        p50 = durations[len(durations) // 2]
+        p99 = durations[min(len(durations) - 1, int(len(durations) * 0.99))]
+        print(f"{len(durations):>8} {p50:>8} {p99:>8} {sum(durations) / 1e3:>10.1f}  "
+              f"{text.get(fingerprint, hex(fingerprint))}")
+
+
+def sim_csv(records):
+    # A borrow's service time is the hold time of the matching return on that connection
+    borrowed = {}
+    rows = []
+    for time_us, _, kind, conn, _, _, duration, _, _ in sorted(records):
+        if kind == 1:
+            borrowed[conn] = time_us
+        elif kind == 2 and conn in borrowed:
+            rows.append((borrowed.pop(conn), duration))
+    print("# arrival_us,service_us")
+    for arrival, service in sorted(rows):
+        print(f"{arrival},{service}")
+
+
+if __name__ == "__main__":
+    args = sys.argv[1:]
+    mode = args.pop(0) if args and args[0].startswith("--") else None
+    if len(args) != 1 or mode not in (None, "--summary", "--sim-csv"):
+        raise SystemExit(__doc__)
+    with open(args[0], "rb") as f:
+        version, start, text, records = load(f.read())
+    try:
+        if mode == "--summary":
+            summary(text, records)
+        elif mode == "--sim-csv":
+            sim_csv(records)
+        else:
+            dump(start, text, records)
+    except BrokenPipeError:
+        pass
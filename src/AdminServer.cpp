@@ -0,0 +1,377 @@
+#include "AdminServer.h"
+#include "ConnectionPool.h"
+#include "Logger.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+namespace {
+
+const size_t kMaxRequestSize = 8192;
+const int kClientTimeoutMs = 1000;
+
+const char *statusText(int status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    default: return "Internal Server Error";
+    }
+}
+
+std::string urlDecode(const std::string &in)
+{
+    std::string out;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        if (in[i] == '+')
+            out += ' ';
+        else if (in[i] == '%' && i + 2 < in.size() && isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+                 isxdigit(static_cast<unsigned char>(in[i + 2])))
+        {
+            out += static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            out += in[i];
+    }
+    return out;
+}
+
+std::string queryParam(const std::string &query, const std::string &key)
+{
+    size_t pos = 0;
+    while (pos <= query.size())
+    {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos)
+            end = query.size();
+        std::string pair = query.substr(pos, end - pos);
+        size_t eq = pair.find('=');
+        if (urlDecode(pair.substr(0, eq)) == key)
+            return eq == std::string::npos ? "" : urlDecode(pair.substr(eq + 1));
+        pos = end + 1;
+    }
+    return "";
+}
+
+bool parseCount(const std::string &raw, int &out)
+{
+    try
+    {
+        size_t used = 0;
+        out = std::stoi(raw, &used);
+        return used == raw.size();
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+// Wait until fd is ready for events, false once deadline passed
+bool waitReady(int fd, short events, std::chrono::steady_clock::time_point deadline)
+{
+    for (;;)
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0)
+            return false;
+        pollfd pfd{fd, events, 0};
+        int n = ::poll(&pfd, 1, static_cast<int>(left.count()));
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n > 0;
+    }
+}
+
+void writeAll(int fd, const std::string &data, std::chrono::steady_clock::time_point deadline)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || ((errno == EAGAIN || errno == EWOULDBLOCK) && waitReady(fd, POLLOUT, deadline))))
+            continue;
+        if (n <= 0)
+            return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+AdminServer::AdminServer(std::string address) : _address(std::move(address)) {}
+
+AdminServer::~AdminServer()
+{
+    stop();
+}
+
+void AdminServer::addPool(const std::shared_ptr<connection_pool> &pool)
+{
+    std::lock_guard<std::mutex> lock(_poolsMutex);
+    _pools.push_back(pool);
+}
+
+std::vector<std::shared_ptr<connection_pool>> AdminServer::pools()
+{
+    std::vector<std::shared_ptr<connection_pool>> alive;
+    std::lock_guard<std::mutex> lock(_poolsMutex);
+    for (const auto &weak : _pools)
+    {
+        if (auto pool = weak.lock())
+            alive.push_back(std::move(pool));
+    }
+    return alive;
+}
+
+bool AdminServer::start()
+{
+    if (_running)
+        return true;
+    if (_address.rfind("unix:", 0) == 0)
+    {
+        _unixPath = _address.substr(5);
+        sockaddr_un addr{};
+        if (_unixPath.empty() || _unixPath.size() >= sizeof(addr.sun_path))
+        {
+            ERROR_LOG("Admin server: bad unix socket path '{}'", _unixPath);
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, _unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        _listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        // A socket file left behind by a previous run would make bind fail
+        ::unlink(_unixPath.c_str());
+        // Control verbs change the pool, keep them to the owning user and group.
+        // The socket file is created 0660 by bind itself, a chmod afterwards
+        // would leave it open to anyone in between
+        mode_t mask = ::umask(0117);
+        bool bound = _listenFd >= 0 && ::bind(_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+        int bindErrno = errno;
+        ::umask(mask);
+        if (!bound)
+        {
+            ERROR_LOG("Admin server: cannot bind {}: {}", _unixPath, strerror(bindErrno));
+            stop();
+            return false;
+        }
+    }
+    else
+    {
+        // Loopback only: the endpoint has no authentication
+        std::string host = "127.0.0.1";
+        std::string port = _address;
+        size_t colon = _address.rfind(':');
+        if (colon != std::string::npos)
+        {
+            host = _address.substr(0, colon);
+            port = _address.substr(colon + 1);
+        }
+        int portNumber = 0;
+        if (host == "localhost")
+            host = "127.0.0.1";
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        if (!parseCount(port, portNumber) || portNumber <= 0 || portNumber > 65535 ||
+            ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 || (ntohl(addr.sin_addr.s_addr) >> 24) != 127)
+        {
+            ERROR_LOG("Admin server: '{}' is not a unix:<path> or loopback [host:]port address", _address);
+            return false;
+        }
+        addr.sin_port = htons(static_cast<uint16_t>(portNumber));
+        _listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (_listenFd >= 0)
+            ::setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (_listenFd < 0 || ::bind(_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            ERROR_LOG("Admin server: cannot bind {}: {}", _address, strerror(errno));
+            stop();
+            return false;
+        }
+    }
+    if (::listen(_listenFd, 16) < 0 || ::pipe2(_wakeFds, O_CLOEXEC) < 0)
+    {
+        ERROR_LOG("Admin server: cannot listen on {}: {}", _address, strerror(errno));
+        stop();
+        return false;
+    }
+    _running = true;
+    _thread = std::thread(&AdminServer::serve, this);
+    INFO_LOG("Admin server listening on {}", _address);
+    return true;
+}
+
+void AdminServer::stop()
+{
+    bool wasRunning = _running.exchange(false);
+    if (wasRunning && _wakeFds[1] >= 0)
+    {
+        char c = 0;
+        (void)!::write(_wakeFds[1], &c, 1);
+    }
+    if (_thread.joinable())
+        _thread.join();
+    for (int *fd : {&_listenFd, &_wakeFds[0], &_wakeFds[1]})
+    {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+    if (!_unixPath.empty())
+    {
+        ::unlink(_unixPath.c_str());
+        _unixPath.clear();
+    }
+}
+
+void AdminServer::serve()
+{
+    while (_running)
+    {
+        pollfd fds[2] = {{_listenFd, POLLIN, 0}, {_wakeFds[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ERROR_LOG("Admin server: poll failed: {}", strerror(errno));
+            break;
+        }
+        if (fds[1].revents != 0)
+            break;
+        if (fds[0].revents & POLLIN)
+        {
+            int client = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0)
+            {
+                serveClient(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+// One request, then close. A client trickling bytes costs at most
+// kClientTimeoutMs in total, not per read
+void AdminServer::serveClient(int fd)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kClientTimeoutMs);
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestSize)
+    {
+        if (!waitReady(fd, POLLIN, deadline))
+            return;
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+            continue;
+        if (n <= 0)
+            return;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    Response response{413, "text/plain", "request too large\n"};
+    if (request.find("\r\n\r\n") != std::string::npos)
+    {
+        // Request line: METHOD SP target SP HTTP/1.x
+        std::string line = request.substr(0, request.find("\r\n"));
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos || line.compare(sp2 + 1, 5, "HTTP/") != 0)
+            response = {400, "text/plain", "malformed request line\n"};
+        else
+            response = handle(line.substr(0, sp1), line.substr(sp1 + 1, sp2 - sp1 - 1));
+    }
+
+    std::string head = "HTTP/1.1 " + std::to_string(response.status) + " " + statusText(response.status) +
+                       "\r\nContent-Type: " + response.contentType +
+                       "\r\nContent-Length: " + std::to_string(response.body.size()) +
+                       "\r\nConnection: close\r\n\r\n";
+    writeAll(fd, head + response.body, deadline);
+}
+
+AdminServer::Response AdminServer::handle(const std::string &method, const std::string &target)
+{
+    size_t q = target.find('?');
+    std::string path = target.substr(0, q);
+    std::string query = q == std::string::npos ? "" : target.substr(q + 1);
+
+    if (path == "/metrics" || path == "/pool")
+    {
+        if (method != "GET")
+            return {405, "text/plain", "use GET\n"};
+        std::vector<PoolMetricsSnapshot> snapshots;
+        for (const auto &pool : pools())
+            snapshots.push_back(pool->metrics());
+        if (path == "/metrics")
+            return {200, "text/plain; version=0.0.4", renderPrometheus(snapshots)};
+        return {200, "application/json", renderJson(snapshots) + "\n"};
+    }
+
+    if (path != "/pool/resize" && path != "/pool/reserve" && path != "/pool/drain")
+        return {404, "text/plain", "unknown path " + path + "\n"};
+    if (method != "POST")
+        return {405, "text/plain", "use POST\n"};
+
+    std::string name = queryParam(query, "pool");
+    if (name.empty())
+        name = "default";
+    std::shared_ptr<connection_pool> pool;
+    for (auto &candidate : pools())
+    {
+        if (candidate->name() == name)
+            pool = candidate;
+    }
+    if (!pool)
+        return {404, "text/plain", "unknown pool " + name + "\n"};
+
+    try
+    {
+        if (path == "/pool/drain")
+        {
+            pool->drain();
+        }
+        else if (path == "/pool/resize")
+        {
+            int maxSize = 0;
+            int initSize = 0;
+            std::string rawInit = queryParam(query, "initSize");
+            if (!parseCount(queryParam(query, "maxSize"), maxSize) || (!rawInit.empty() && !parseCount(rawInit, initSize)))
+                return {400, "text/plain", "expected maxSize=N and optional initSize=N\n"};
+            pool->updateConfig([&](PoolConfig &c) {
+                c.maxSize = maxSize;
+                if (!rawInit.empty())
+                    c.initSize = initSize;
+            });
+        }
+        else
+        {
+            int reservedSize = 0;
+            if (!parseCount(queryParam(query, "reservedSize"), reservedSize))
+                return {400, "text/plain", "expected reservedSize=N\n"};
+            pool->setReservedSize(reservedSize);
+        }
+    }
+    catch (const ConfigError &e)
+    {
+        return {400, "text/plain", std::string(e.what()) + "\n"};
+    }
+    INFO_LOG("Admin server: {} on pool {}", target, name);
+    return {200, "text/plain", "ok\n"};
+}
@@ -0,0 +1,372 @@
+#include "Config.h"
+#include "ConfigManager.h"
+#include "Driver.h"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <set>
+
+namespace {
+
+using Setter = bool (*)(PoolConfig &config, const std::string &raw, std::string &error);
+
+struct Field
+{
+    const char *key; // key in INI/YAML
+    const char *env; // environment override
+    Setter set;
+};
+
+bool parseInt(const std::string &raw, long long &out, std::string &error)
+{
+    try
+    {
+        size_t used = 0;
+        out = std::stoll(raw, &used);
+        if (used == raw.size())
+            return true;
+    }
+    catch (const std::exception &)
+    {
+    }
+    error = "expected an integer, got '" + raw + "'";
+    return false;
+}
+
+bool parseBool(const std::string &raw, bool &out, std::string &error)
+{
+    std::string v = raw;
+    std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+    if (v == "true" || v == "yes" || v == "on" || v == "1")
+    {
+        out = true;
+        return true;
+    }
+    if (v == "false" || v == "no" || v == "off" || v == "0")
+    {
+        out = false;
+        return true;
+    }
+    error = "expected a boolean, got '" + raw + "'";
+    return false;
+}
+
+// "250ms", "3s", "2m", "1h", "500us"; a bare number is in Duration's own unit.
+// Never negative, 0 is how a duration turns a feature off
+template <typename Duration>
+bool parseDuration(const std::string &raw, Duration &out, std::string &error)
+{
+    if (!raw.empty() && raw[0] == '-')
+    {
+        error = "expected a duration of 0 or more, got '" + raw + "'";
+        return false;
+    }
+    size_t split = 0;
+    while (split < raw.size() && isdigit(static_cast<unsigned char>(raw[split])))
+        split++;
+    long long value = 0;
+    if (!parseInt(raw.substr(0, split), value, error))
+    {
+        error = "expected a duration like 500ms or 3s, got '" + raw + "'";
+        return false;
+    }
+    std::string unit = raw.substr(split);
+    if (unit.empty())
+        out = Duration(value);
+    else if (unit == "us")
+        out = std::chrono::duration_cast<Duration>(std::chrono::microseconds(value));
+    else if (unit == "ms")
+        out = std::chrono::duration_cast<Duration>(std::chrono::milliseconds(value));
+    else if (unit == "s")
+        out = std::chrono::duration_cast<Duration>(std::chrono::seconds(value));
+    else if (unit == "m")
+        out = std::chrono::duration_cast<Duration>(std::chrono::minutes(value));
+    else if (unit == "h")
+        out = std::chrono::duration_cast<Duration>(std::chrono::hours(value));
+    else
+    {
+        error = "unknown duration unit '" + unit + "' in '" + raw + "'";
+        return false;
+    }
+    return true;
+}
+
+// "512K", "64M", "2G" (powers of 1024); a bare number is bytes
+bool parseSize(const std::string &raw, uint64_t &out, std::string &error)
+{
+    std::string digits = raw;
+    uint64_t scale = 1;
+    char unit = raw.empty() ? '\0' : static_cast<char>(::toupper(static_cast<unsigned char>(raw.back())));
+    if (unit == 'K' || unit == 'M' || unit == 'G')
+    {
+        digits.pop_back();
+        scale = unit == 'K' ? 1024ull : unit == 'M' ? 1024ull * 1024 : 1024ull * 1024 * 1024;
+    }
+    long long value = 0;
+    if (!parseInt(digits, value, error) || value < 0)
+    {
+        error = "expected a size like 512K, 64M or 2G, got '" + raw + "'";
+        return false;
+    }
+    out = static_cast<uint64_t>(value) * scale;
+    return true;
+}
+
+template <typename T>
+bool setInt(T &field, const std::string &raw, std::string &error)
+{
+    long long value = 0;
+    if (!parseInt(raw, value, error))
+        return false;
+    // Narrowing would wrap, e.g. 4294967297 into an int is 1
+    if (value < static_cast<long long>(std::numeric_limits<T>::min()) ||
+        value > static_cast<long long>(std::numeric_limits<T>::max()))
+    {
+        error = "out of range, got '" + raw + "'";
+        return false;
+    }
+    field = static_cast<T>(value);
+    return true;
+}
+
+const Field kFields[] = {
+    {"name", "CONNECTION_POOL_NAME",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.name = raw; return true; }},
+    {"driver", "CONNECTION_POOL_DRIVER",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.driver = raw; return true; }},
+    {"ip", "CONNECTION_POOL_IP",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.ip = raw; return true; }},
+    {"port", "CONNECTION_POOL_PORT",
+     [](PoolConfig &c, const std::string &raw, std::string &e) {
+         long long v = 0;
+         if (!parseInt(raw, v, e))
+             return false;
+         if (v <= 0 || v > 65535)
+         {
+             e = "expected 1..65535, got " + raw;
+             return false;
+         }
+         c.port = static_cast<unsigned short>(v);
+         return true;
+     }},
+    {"username", "CONNECTION_POOL_USERNAME",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.username = raw; return true; }},
+    {"password", "CONNECTION_POOL_PASSWORD",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.password = raw; return true; }},
+    {"dbname", "CONNECTION_POOL_DBNAME",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.dbname = raw; return true; }},
+    {"initSize", "CONNECTION_POOL_INIT_SIZE",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.initSize, raw, e); }},
+    {"maxSize", "CONNECTION_POOL_MAX_SIZE",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.maxSize, raw, e); }},
+    {"reservedSize", "CONNECTION_POOL_RESERVED_SIZE",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.reservedSize, raw, e); }},
+    {"idleOrder", "CONNECTION_POOL_IDLE_ORDER",
+     [](PoolConfig &c, const std::string &raw, std::string &e) {
+         if (raw == "fifo" || raw == "FIFO")
+             c.idleOrder = PoolConfig::IdleOrder::FIFO;
+         else if (raw == "lifo" || raw == "LIFO")
+             c.idleOrder = PoolConfig::IdleOrder::LIFO;
+         else
+         {
+             e = "expected fifo or lifo, got " + raw;
+             return false;
+         }
+         return true;
+     }},
+    {"maxIdleTime", "CONNECTION_POOL_MAX_IDLE_TIME",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.maxIdleTime, e); }},
+    {"connectionTimeOut", "CONNECTION_POOL_CONNECTION_TIMEOUT",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.connectionTimeout, e); }},
+    {"connectTimeout", "CONNECTION_POOL_CONNECT_TIMEOUT",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.connectTimeout, e); }},
+    {"validateOnBorrow", "CONNECTION_POOL_VALIDATE_ON_BORROW",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseBool(raw, c.validateOnBorrow, e); }},
+    {"validationInterval", "CONNECTION_POOL_VALIDATION_INTERVAL",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.validationInterval, e); }},
+    {"validateOnReturn", "CONNECTION_POOL_VALIDATE_ON_RETURN",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseBool(raw, c.validateOnReturn, e); }},
+    {"traceFile", "CONNECTION_POOL_TRACE_FILE",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.traceFile = raw; return true; }},
+    {"profileLocks", "CONNECTION_POOL_PROFILE_LOCKS",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseBool(raw, c.profileLocks, e); }},
+    {"leakDetectionThreshold", "CONNECTION_POOL_LEAK_DETECTION_THRESHOLD",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.leakDetectionThreshold, e); }},
+    {"leakStackSampling", "CONNECTION_POOL_LEAK_STACK_SAMPLING",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.leakStackSampling, raw, e); }},
+    {"leakReclaimTimeout", "CONNECTION_POOL_LEAK_RECLAIM_TIMEOUT",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.leakReclaimTimeout, e); }},
+    {"queryTimingSampling", "CONNECTION_POOL_QUERY_TIMING_SAMPLING",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.queryTimingSampling, raw, e); }},
+    {"statementStats", "CONNECTION_POOL_STATEMENT_STATS",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseBool(raw, c.statementStats, e); }},
+    {"slowQueryThreshold", "CONNECTION_POOL_SLOW_QUERY_THRESHOLD",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseDuration(raw, c.slowQueryThreshold, e); }},
+    {"slowQueryExplainSampling", "CONNECTION_POOL_SLOW_QUERY_EXPLAIN_SAMPLING",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return setInt(c.slowQueryExplainSampling, raw, e); }},
+    {"slowQueryLog", "CONNECTION_POOL_SLOW_QUERY_LOG",
+     [](PoolConfig &c, const std::string &raw, std::string &) { c.slowQueryLog = raw; return true; }},
+    {"resultMemoryBudget", "CONNECTION_POOL_RESULT_MEMORY_BUDGET",
+     [](PoolConfig &c, const std::string &raw, std::string &e) { return parseSize(raw, c.resultMemoryBudget, e); }},
+    {"resultMemoryPolicy", "CONNECTION_POOL_RESULT_MEMORY_POLICY",
+     [](PoolConfig &c, const std::string &raw, std::string &e) {
+         std::string v = raw;
+         std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+         if (v == "wait")
+             c.resultMemoryPolicy = PoolConfig::ResultMemoryPolicy::WAIT;
+         else if (v == "stream")
+             c.resultMemoryPolicy = PoolConfig::ResultMemoryPolicy::STREAM;
+         else if (v == "fail")
+             c.resultMemoryPolicy = PoolConfig::ResultMemoryPolicy::FAIL;
+         else
+         {
+             e = "expected wait, stream or fail, got " + raw;
+             return false;
+         }
+         return true;
+     }},
+};
+
+// Old spellings still accepted, with a warning
+const std::pair<const char *, const char *> kAliases[] = {
+    {"maxConnectionTimeOut", "connectionTimeOut"},
+};
+
+const Field *findField(const std::string &key)
+{
+    for (const auto &field : kFields)
+    {
+        if (key == field.key)
+            return &field;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+ConfigError::ConfigError(std::vector<std::string> errors)
+    : std::runtime_error([&errors] {
+          std::string what = "invalid connection pool config:";
+          for (const auto &e : errors)
+              what += "\n  " + e;
+          return what;
+      }()),
+      _errors(std::move(errors))
+{
+}
+
+std::vector<std::string> PoolConfig::validate() const
+{
+    using namespace std::chrono;
+    std::vector<std::string> errors;
+    if (!isDriverRegistered(driver))
+        errors.push_back("driver: unknown driver '" + driver + "'");
+    if (name.empty())
+        errors.push_back("name: must not be empty");
+    if (ip.empty())
+        errors.push_back("ip: must not be empty");
+    if (maxSize < 1 || maxSize > 10000)
+        errors.push_back("maxSize: expected 1..10000, got " + std::to_string(maxSize));
+    if (initSize < 0 || initSize > maxSize)
+        errors.push_back("initSize: expected 0..maxSize(" + std::to_string(maxSize) + "), got " + std::to_string(initSize));
+    if (reservedSize < 0 || reservedSize >= maxSize)
+        errors.push_back("reservedSize: expected 0..maxSize-1(" + std::to_string(maxSize - 1) + "), got " +
+                         std::to_string(reservedSize));
+    // Bounds catch unit mistakes, e.g. 100 meant as seconds but read as milliseconds
+    if (connectionTimeout < milliseconds(1) || connectionTimeout > minutes(10))
+        errors.push_back("connectionTimeOut: expected 1ms..10m, got " + std::to_string(connectionTimeout.count()) +
+                         "ms (bare numbers are milliseconds, use a suffix such as 3s)");
+    if (maxIdleTime < seconds(1) || maxIdleTime > hours(24))
+        errors.push_back("maxIdleTime: expected 1s..24h, got " + std::to_string(maxIdleTime.count()) +
+                         "s (bare numbers are seconds)");
+    if (connectTimeout < seconds(1) || connectTimeout > minutes(10))
+        errors.push_back("connectTimeout: expected 1s..10m, got " + std::to_string(connectTimeout.count()) +
+                         "s (bare numbers are seconds)");
+    if (validationInterval < milliseconds(0) || validationInterval > maxIdleTime)
+        errors.push_back("validationInterval: expected 0..maxIdleTime, got " +
+                         std::to_string(validationInterval.count()) + "ms");
+    if (leakDetectionThreshold < milliseconds(0))
+        errors.push_back("leakDetectionThreshold: expected 0 (off) or more, got " +
+                         std::to_string(leakDetectionThreshold.count()) + "ms");
+    if (leakStackSampling < 0)
+        errors.push_back("leakStackSampling: expected 0 (never) or more, got " + std::to_string(leakStackSampling));
+    // Only detected leaks are reclaimed
+    if (leakReclaimTimeout != milliseconds(0) &&
+        (leakDetectionThreshold == milliseconds(0) || leakReclaimTimeout < leakDetectionThreshold))
+        errors.push_back("leakReclaimTimeout: expected 0 (never) or leakDetectionThreshold(" +
+                         std::to_string(leakDetectionThreshold.count()) + "ms) or more, got " +
+                         std::to_string(leakReclaimTimeout.count()) + "ms");
+    if (queryTimingSampling < 0)
+        errors.push_back("queryTimingSampling: expected 0 (off) or more, got " + std::to_string(queryTimingSampling));
+    if (slowQueryThreshold < milliseconds(0))
+        errors.push_back("slowQueryThreshold: expected 0 (off) or more, got " +
+                         std::to_string(slowQueryThreshold.count()) + "ms");
+    if (slowQueryExplainSampling < 0)
+        errors.push_back("slowQueryExplainSampling: expected 0 (never) or more, got " +
+                         std::to_string(slowQueryExplainSampling));
+    return errors;
+}
+
+PoolConfig PoolConfig::load(const std::string &filename)
+{
+    PoolConfig config;
+    std::vector<std::string> errors;
+
+    std::unique_ptr<ConfigManager> manager;
+    try
+    {
+        manager = createConfigManager(filename);
+    }
+    catch (const std::exception &e)
+    {
+        throw ConfigError({filename + ": " + e.what()});
+    }
+    if (!manager->loadConfig(filename))
+        throw ConfigError({filename + ": cannot be read or parsed"});
+
+    std::set<std::string> seen;
+    for (const auto &key : manager->keys())
+    {
+        std::string name = key;
+        for (const auto &alias : kAliases)
+        {
+            if (key == alias.first)
+            {
+                WARN_LOG("Config key {} is deprecated, use {}", alias.first, alias.second);
+                name = alias.second;
+            }
+        }
+        const Field *field = findField(name);
+        if (field == nullptr)
+        {
+            errors.push_back(key + ": unknown key");
+            continue;
+        }
+        if (!seen.insert(name).second)
+        {
+            errors.push_back(key + ": set twice");
+            continue;
+        }
+        std::string error;
+        if (!field->set(config, manager->getString(key, ""), error))
+            errors.push_back(key + ": " + error);
+    }
+
+    for (const auto &field : kFields)
+    {
+        const char *value = std::getenv(field.env);
+        if (value == nullptr)
+            continue;
+        std::string error;
+        if (!field.set(config, value, error))
+            errors.push_back(std::string(field.env) + ": " + error);
+    }
+
+    if (errors.empty())
+        errors = config.validate();
+    if (!errors.empty())
+        throw ConfigError(std::move(errors));
+    return config;
+}
@@ -1,6 +1,8 @@
 #include "ConfigManager.h"
 #include <stdexcept>
 #include <algorithm>
+#include <fstream>
+#include <map>
 #include "Logger.hpp"
 #ifdef USE_SIMPLE_INI
 #include "SimpleIni.h"
@@ -10,8 +12,10 @@ public:
     bool loadConfig(const std::string &filename) override
     {
         _ini.SetUnicode();
-        SI_ERROR rc = _ini.LoadFile(filename.c_str());
-        return (rc >= 0)
+        // Keeps repeated keys so that keys() lists them
+        _ini.SetMultiKey(true);
+        SI_Error rc = _ini.LoadFile(filename.c_str());
+        return (rc >= 0);
     }
     std::string getString(const std::string &key, const std::string &defaultValue) override
     {
@@ -26,6 +30,24 @@ public:
     {
         return _ini.GetBoolValue("", key.c_str(), defaultValue);
     }
+    bool hasKey(const std::string &key) override
+    {
+        return _ini.GetValue("", key.c_str(), nullptr) != nullptr;
+    }
+    std::vector<std::string> keys() override
+    {
+        CSimpleIniA::TNamesDepend names;
+        _ini.GetAllKeys("", names);
+        std::vector<std::string> result;
+        for (const auto &name : names)
+        {
+            // GetAllKeys lists a repeated key once, every value of it counts
+            CSimpleIniA::TNamesDepend values;
+            _ini.GetAllValues("", name.pItem, values);
+            result.insert(result.end(), std::max<size_t>(values.size(), 1), name.pItem);
+        }
+        return result;
+    }
 
 private:
     CSimpleIniA _ini;
@@ -46,7 +68,7 @@ public:
         }
         catch (const YAML::Exception &e)
         {
-            ERROR_LOG("Load config failed:" + e.msg);
+            ERROR_LOG("Load config failed: {}", e.msg);
             return false;
         }
     }
@@ -83,12 +105,109 @@ public:
             return defaultValue;
         }
     }
+    bool hasKey(const std::string &key) override
+    {
+        return _config.IsMap() && _config[key].IsDefined();
+    }
+    std::vector<std::string> keys() override
+    {
+        std::vector<std::string> result;
+        if (!_config.IsMap())
+            return result;
+        for (const auto &item : _config)
+        {
+            result.push_back(item.first.as<std::string>());
+        }
+        return result;
+    }
 
 private:
     YAML::Node _config;
 };
 #endif
 
+// Used for `key=value` files when SimpleIni is not compiled in. '#' and ';'
+// start comments, [section] headers are ignored, keys and values are trimmed
+class KeyValueConfigManager : public ConfigManager
+{
+public:
+    bool loadConfig(const std::string &filename) override
+    {
+        std::ifstream in(filename);
+        if (!in)
+            return false;
+        _values.clear();
+        _keys.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            line = trim(line);
+            if (line.empty() || line[0] == '#' || line[0] == ';' || line[0] == '[')
+                continue;
+            size_t idx = line.find('=');
+            if (idx == std::string::npos)
+                continue;
+            std::string key = trim(line.substr(0, idx));
+            _keys.push_back(key);
+            _values[key] = trim(line.substr(idx + 1));
+        }
+        return true;
+    }
+    std::string getString(const std::string &key, const std::string &defaultValue) override
+    {
+        auto it = _values.find(key);
+        return it == _values.end() ? defaultValue : it->second;
+    }
+    int getInt(const std::string &key, int defaultValue) override
+    {
+        auto it = _values.find(key);
+        if (it == _values.end())
+            return defaultValue;
+        try
+        {
+            return std::stoi(it->second);
+        }
+        catch (const std::exception &)
+        {
+            return defaultValue;
+        }
+    }
+    bool getBool(const std::string &key, bool defaultValue) override
+    {
+        auto it = _values.find(key);
+        if (it == _values.end())
+            return defaultValue;
+        std::string v = it->second;
+        std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+        if (v == "true" || v == "yes" || v == "on" || v == "1")
+            return true;
+        if (v == "false" || v == "no" || v == "off" || v == "0")
+            return false;
+        return defaultValue;
+    }
+    bool hasKey(const std::string &key) override
+    {
+        return _values.count(key) > 0;
+    }
+    std::vector<std::string> keys() override
+    {
+        return _keys;
+    }
+
+private:
+    static std::string trim(const std::string &s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos)
+            return "";
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    std::map<std::string, std::string> _values; // the last of repeated keys wins
+    std::vector<std::string> _keys;              // in file order, repeats included
+};
+
 std::unique_ptr<ConfigManager> createConfigManager(const std::string &filename)
 {
     // Determine file loader according to file extension
@@ -103,7 +222,7 @@ std::unique_ptr<ConfigManager> createConfigManager(const std::string &filename)
 #ifdef USE_SIMPLE_INI
             return std::make_unique<IniConfigManager>();
 #else
-            throw new std::runtime_error("INI support not compiled or not found!");
+            return std::make_unique<KeyValueConfigManager>();
 #endif
         }
         else if ("yaml" == extension || "yml" == extension)
@@ -111,7 +230,7 @@ std::unique_ptr<ConfigManager> createConfigManager(const std::string &filename)
 #ifdef USE_YAML_CPP
             return std::make_unique<YamlConfigManager>();
 #else
-            throw new std::runtime_error("YAML support not compiled or not found!");
+            throw std::runtime_error("YAML support not compiled or not found!");
 #endif
         }
     }
@@ -119,6 +238,6 @@ std::unique_ptr<ConfigManager> createConfigManager(const std::string &filename)
 #ifdef USE_SIMPLE_INI
     return std::make_unique<IniConfigManager>();
 #else
-    throw new std::runtime_error("Not implemented");
+    return std::make_unique<KeyValueConfigManager>();
 #endif
 }
\ No newline at end of file
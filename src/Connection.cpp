@@ -1,79 +1,247 @@
 #include "Connection.h"
 #include "Logger.hpp"
+#include "MysqlDriver.h"
+#include "Probes.hpp"
+#include "QueryTrace.h"
 #include <mysql/mysql.h>
 #include <string>
+#include <utility>
 using namespace std;
-connection::connection()
+connection::connection() : connection(std::make_shared<MysqlDriver>())
+{
+}
+connection::connection(std::shared_ptr<Driver> driver)
+    : _driver(std::move(driver)), _session(_driver->open())
 {
-    _conn = mysql_init(nullptr);
 }
 connection::~connection()
 {
-    if (_conn != nullptr)
-        mysql_close(_conn);
+    _session->close();
+}
+void connection::setConnectTimeout(unsigned int seconds)
+{
+    _session->setConnectTimeout(seconds);
 }
 bool connection::connect(string ip, unsigned short port, string user, string password,
              string dbname)
 {
-    MYSQL *p = mysql_real_connect(_conn, ip.c_str(), user.c_str(),
-                                  password.c_str(), dbname.c_str(), port, nullptr, 0);
-    return p != nullptr;
+#ifdef CONNECTION_POOL_PROBES_ENABLED
+    int64_t start = steadyUs();
+#endif
+    bool ok = _session->connect(ip, port, user, password, dbname);
+    POOL_PROBE3(connect, this, ok, steadyUs() - start);
+    return ok;
 }
 bool connection::update(string sql)
 {
-    if (mysql_query(_conn, sql.c_str()))
+    _queries.fetch_add(1, std::memory_order_relaxed);
+    POOL_PROBE2(query__start, this, sql.c_str());
+    QueryTrace& trace = QueryTrace::instance();
+    bool traced = trace.enabled();
+    bool timed = _profiler && _profiler->sample();
+    bool counted = _stats && _stats->enabled();
+    bool watched = _slowLog && _slowLog->enabled();
+    int64_t waitUs = std::exchange(_acquireWaitUs, 0);
+    int64_t start = traced || timed || counted || watched ? steadyUs() : 0;
+    uint64_t affected = 0;
+    bool ok = _session->execute(sql, affected);
+    if (start != 0)
+    {
+        int64_t end = steadyUs();
+        if (traced)
+            trace.statement(TraceKind::UPDATE, this, sql, end - start, affected, ok);
+        if (counted)
+            _stats->record(sql, end - start, affected, sql.size(), ok);
+        if (watched && _slowLog->slow(end - start))
+            logSlow(sql, waitUs, start, end, ok, affected);
+        if (timed)
+        {
+            QuerySpan span = makeSpan(sql, waitUs, start, end, ok, affected);
+            _profiler->record(span);
+        }
+    }
+    if (!ok)
     {
-        WARN_LOG("Update failed:" + sql);
+        POOL_PROBE4(query__done, this, 0, int64_t(0), sql.size());
+        WARN_LOG("Update failed: {}", sql);
         return false;
     }
+    POOL_PROBE4(query__done, this, 1, static_cast<int64_t>(affected), sql.size());
     return true;
 }
 MYSQL_RES* connection::query(string sql)
 {
-    if (mysql_query(_conn, sql.c_str()))
+    MYSQL* conn = static_cast<MYSQL*>(_session->native());
+    if (conn == nullptr)
     {
-        WARN_LOG("Query failed:" + sql);
+        WARN_LOG("query() needs a connected mysql driver session, use select() with driver {}", _driver->name());
         return nullptr;
     }
-    return mysql_use_result(_conn);
+    _queries.fetch_add(1, std::memory_order_relaxed);
+    POOL_PROBE2(query__start, this, sql.c_str());
+    QueryTrace& trace = QueryTrace::instance();
+    bool traced = trace.enabled();
+    bool timed = _profiler && _profiler->sample();
+    bool counted = _stats && _stats->enabled();
+    bool watched = _slowLog && _slowLog->enabled();
+    int64_t waitUs = std::exchange(_acquireWaitUs, 0);
+    int64_t start = traced || timed || counted || watched ? steadyUs() : 0;
+    bool failed = mysql_query(conn, sql.c_str()) != 0;
+    if (start != 0)
+    {
+        int64_t end = steadyUs();
+        if (traced)
+            trace.statement(TraceKind::QUERY, this, sql, end - start, 0, !failed);
+        // The caller streams the rows itself, they are not part of the span or the counts
+        if (counted)
+            _stats->record(sql, end - start, 0, sql.size(), !failed);
+        if (watched && _slowLog->slow(end - start))
+            logSlow(sql, waitUs, start, end, !failed, 0);
+        if (timed)
+        {
+            QuerySpan span = makeSpan(sql, waitUs, start, end, !failed, 0);
+            _profiler->record(span);
+        }
+    }
+    if (failed)
+    {
+        POOL_PROBE4(query__done, this, 0, int64_t(0), sql.size());
+        WARN_LOG("Query failed: {}", sql);
+        return nullptr;
+    }
+    // Rows are streamed by the caller, unknown here
+    POOL_PROBE4(query__done, this, 1, int64_t(-1), sql.size());
+    return mysql_use_result(conn);
 }
-
-bool connection::reconnect(string ip, unsigned short port, 
-                          string user, string password, string dbname) {
-    
-    if (_conn != nullptr) {
-        mysql_close(_conn);
-        _conn = nullptr;
+std::unique_ptr<ResultSet> connection::select(const string& sql, bool stream)
+{
+    _queries.fetch_add(1, std::memory_order_relaxed);
+    POOL_PROBE2(query__start, this, sql.c_str());
+    if (!stream && _memory)
+    {
+        // Over the result memory budget: wait, stream instead, or give up before sending
+        ResultMemory::Admission admission = _memory->admit();
+        if (admission == ResultMemory::Admission::REJECTED)
+        {
+            POOL_PROBE4(query__done, this, 0, int64_t(0), sql.size());
+            WARN_LOG("Query rejected, result memory budget exhausted: {}", sql);
+            return nullptr;
+        }
+        stream = admission == ResultMemory::Admission::STREAMED;
     }
-    
-    _conn = mysql_init(nullptr);
-    if (_conn == nullptr) {
-        ERROR_LOG("MySQL initialization failed during reconnect");
-        return false;
+    QueryTrace& trace = QueryTrace::instance();
+    bool traced = trace.enabled();
+    bool timed = _profiler && _profiler->sample();
+    bool counted = _stats && _stats->enabled();
+    bool watched = _slowLog && _slowLog->enabled();
+    int64_t waitUs = std::exchange(_acquireWaitUs, 0);
+    int64_t start = traced || timed || counted || watched ? steadyUs() : 0;
+    auto result = _session->query(sql, stream);
+    if (result && !stream && _memory)
+        result = _memory->charge(std::move(result));
+    if (start != 0)
+    {
+        int64_t end = steadyUs();
+        if (traced)
+            trace.statement(TraceKind::QUERY, this, sql, end - start, result ? result->rowCount() : 0, result != nullptr);
+        // Streamed: until the first row
+        if (watched && _slowLog->slow(end - start))
+            logSlow(sql, waitUs, start, end, result != nullptr, result ? result->rowCount() : 0);
+        if (counted && !result)
+            _stats->record(sql, end - start, 0, sql.size(), false);
+        else if (counted) // recorded when the caller is done with the rows
+            result = _stats->countRows(std::move(result), sql, end - start, stream);
+        if (timed)
+        {
+            QuerySpan span = makeSpan(sql, waitUs, start, end, result != nullptr, 0);
+            if (!result)
+                _profiler->record(span);
+            else // recorded when the caller is done with the rows
+                result = _profiler->timeRows(std::move(result), std::move(span), stream);
+        }
     }
-    
-    MYSQL *p = mysql_real_connect(_conn, ip.c_str(), user.c_str(),
-                                 password.c_str(), dbname.c_str(), port, nullptr, 0);
-    if (p == nullptr) {
-        ERROR_LOG("MySQL reconnect failed: " + string(mysql_error(_conn)));
+    if (!result)
+    {
+        POOL_PROBE4(query__done, this, 0, int64_t(0), sql.size());
+        WARN_LOG("Query failed: {}", sql);
+        return nullptr;
+    }
+    // A streamed result's rows are read later
+    POOL_PROBE4(query__done, this, 1, stream ? int64_t(-1) : static_cast<int64_t>(result->rowCount()), sql.size());
+    return result;
+}
+
+RowStream::Status connection::queryStream(const string& sql, const RowStream::Callback& onRow)
+{
+    auto rows = select(sql, true);
+    if (!rows)
+        return RowStream::Status::FAILED;
+    RowStream stream(std::move(rows));
+    RowStream::Status status = stream.run(onRow);
+    if (status == RowStream::Status::FAILED)
+        WARN_LOG("Query stream broke off after {} rows: {}", stream.rows(), sql);
+    return status;
+}
+
+bool connection::reconnect(string ip, unsigned short port,
+                          string user, string password, string dbname) {
+
+#ifdef CONNECTION_POOL_PROBES_ENABLED
+    int64_t start = steadyUs();
+#endif
+    // The driver closes the old session and opens a new one
+    bool ok = _session->connect(ip, port, user, password, dbname);
+    POOL_PROBE3(reconnect, this, ok, steadyUs() - start);
+    if (!ok) {
+        ERROR_LOG("MySQL reconnect failed: {}", _session->error());
         return false;
     }
-    
+
+    _openedAt = steadyUs();
     INFO_LOG("MySQL connection reestablished successfully");
     return true;
 }
 
+QuerySpan connection::makeSpan(const string& sql, int64_t waitUs, int64_t start, int64_t end, bool ok,
+                               uint64_t rows) const
+{
+    QuerySpan span;
+    span.sql = sql;
+    span.connection = reinterpret_cast<uintptr_t>(this);
+    int64_t epochUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    span.startEpochUs = epochUs - (steadyUs() - start) - waitUs;
+    span.phases = QueryProfiler::split(waitUs, end - start, _session->lastFetchUs(), getPingTimeUs());
+    span.rows = rows;
+    span.ok = ok;
+    return span;
+}
+
+void connection::logSlow(const string& sql, int64_t waitUs, int64_t start, int64_t end, bool ok,
+                         uint64_t rows) const
+{
+    QuerySpan span = makeSpan(sql, waitUs, start, end, ok, rows);
+    SlowQuery query;
+    query.sql = std::move(span.sql);
+    query.connection = span.connection;
+    query.startEpochUs = span.startEpochUs;
+    query.phases = span.phases;
+    query.rows = rows;
+    query.ok = ok;
+    query.site = captureBorrowSite(getBorrowCount(), 1);
+    _slowLog->record(std::move(query));
+}
+
 bool connection::isValid(int timeout) {
-    if (_conn == nullptr) {
-        INFO_LOG("MySQL connection not initialized or has been destroyed!");
-        return false;
+    // Driver provides ping method to test if connection is valid
+    int64_t start = steadyUs();
+    bool ok = _session->ping();
+    if (ok) {
+        // Smoothed round trip, the network share of a timed statement
+        int64_t rtt = steadyUs() - start;
+        int64_t previous = _pingUs.load(std::memory_order_relaxed);
+        _pingUs.store(previous == 0 ? rtt : (previous * 7 + rtt) / 8, std::memory_order_relaxed);
     }
-    
-    // MYSQL driver provides ping method to test if connection is valid
-    // USE COM_PING with low cost
-    if (mysql_ping(_conn) == 0) {
-        return true;
-    }
-    return false;
+    POOL_PROBE2(validate, this, ok);
+    return ok;
 }
-
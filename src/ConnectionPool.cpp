@@ -1,277 +1,514 @@
 #include "ConnectionPool.h"
 #include<Logger.hpp>
+#include "FlightRecorder.hpp"
+#include "Probes.hpp"
+#include "QueryTrace.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+// Set from the signal handler, lock-free atomics are async-signal-safe
+std::atomic<bool> g_reloadRequested{false};
+}
 
 //Construct connection pool
-connection_pool::connection_pool() : _connectionCnt(0){
-    // Load config
-    if(!loadConfigFile())
-    {
-        ERROR_LOG("Failed to load configuration file!");
-        return;
-    }
+connection_pool::connection_pool(std::string configFile, std::shared_ptr<Driver> driver)
+    : _configFile(std::move(configFile)),
+      _config(std::make_shared<const PoolConfig>()), _driver(std::move(driver)), _driverSupplied(_driver != nullptr),
+      _connectionTimeout(0), _generation(0), _shutdown(false),
+      _pool(ConnectionFactory{this}, ConnectionObserver{this}){
+}
+
+void connection_pool::start() {
     // Create core connection
     // Similar as java thread pool, connection pool keeps core connection,
-    // which will not be destoryed after use
-    for(int i=0; i<_initSize; i++){
-        // Create connection object using default constructor
-        auto p = std::make_unique<connection>();
-        p->connect(_ip, _port, _username, _password, _dbname);
-        p->refreshsAliveTime();
-        // Remind: After the original pointer managed by std::unique_ptr<connection> (obtained via .get()) is stored in _connectionQue, 
-        // the std::unique_ptr<connection> object p is destructed at the end of the loop, and the connection object it manages is destroyed. 
-        // This causes the pointers stored in _connectionQue to become dangling pointers, and subsequent use of these pointers will cause undefined behavior.
-        // Thus, consider seperate ownership of queue and client, use unique_prt
-        _connectionQue.push(std::move(p));
-        _connectionCnt++;
+    // which will not be destoryed after use. The pool's grower and evictor
+    // threads are joined in shutdown(), so they can never outlive "this"
+    _pool.start();
+    _leakScanner = thread(&connection_pool::leakScanTask, this);
+    // Start config watcher, serves inotify events and reload signals
+    if (!_configFile.empty()) {
+        _watcher = thread(&connection_pool::watchConfigTask, this);
     }
-
-    // Start background connection producer thread(named as produce)
-    // Use std::bind to make produce thread call produceConnectionTask, because produceConnectionTask
-    // needs "this" pointer
-    // So produce must pass "this"
-    thread produce(std::bind(&connection_pool::produceConnectionTask, this));
-    produce.detach();
-    // Start background connection to collect thread
-    thread scanner(std::bind(&connection_pool::scanRunningConnectionTask, this));
-    scanner.detach();
-};
+}
 
 //Lazy singleton connection pool
 std::shared_ptr<connection_pool> connection_pool::getconnect_pool()
 {
-    static std::shared_ptr<connection_pool> pool(new connection_pool());
+    static std::shared_ptr<connection_pool> pool = []{
+        std::string configFile = getenv("CONNECTION_POOL_CONFIG") != nullptr ? getenv("CONNECTION_POOL_CONFIG") : "db_config.ini";
+        std::shared_ptr<connection_pool> p(new connection_pool(configFile, nullptr));
+        // Load config
+        try {
+            auto config = std::make_shared<const PoolConfig>(PoolConfig::load(configFile));
+            p->_name = config->name;
+            p->applyConfig(std::move(config));
+        } catch (const ConfigError& e) {
+            for (const auto& error : e.errors()) {
+                ERROR_LOG("Config {}: {}", configFile, error);
+            }
+            ERROR_LOG("Failed to load configuration file!");
+            return p;
+        }
+        INFO_LOG("Configuration loaded successfully from {}", configFile);
+        p->start();
+        return p;
+    }();
     return pool; // return copied shared ptr
 };
 
+std::shared_ptr<connection_pool> connection_pool::create(const PoolConfig& config, std::shared_ptr<Driver> driver)
+{
+    auto errors = config.validate();
+    if (!errors.empty()) {
+        throw ConfigError(std::move(errors));
+    }
+    std::shared_ptr<connection_pool> p(new connection_pool("", std::move(driver)));
+    p->_name = config.name;
+    p->applyConfig(std::make_shared<const PoolConfig>(config));
+    p->start();
+    return p;
+}
 
-bool connection_pool::loadConfigFile(const std::string& filename) {
-    std::string configFile = filename.empty() ? "db_config.ini" : filename;
-    
+
+// Publish a new snapshot (RCU style pointer swap) and let the background
+// threads converge the live pool to it: producer grows one connection at a
+// time, return path and scanner shrink, stale credentials are drained
+void connection_pool::applyConfig(std::shared_ptr<const PoolConfig> config) {
+    auto previous = this->config();
+    bool rotate = !previous->sameEndpoint(*config);
+    _connectionTimeout = static_cast<int>(config->connectionTimeout.count());
+    _pool.sizing().set(config->initSize, config->maxSize, config->reservedSize, config->maxIdleTime);
+    _pool.validation().set(config->validateOnBorrow, config->validationInterval, config->validateOnReturn);
+    bool lifo = config->idleOrder == PoolConfig::IdleOrder::LIFO;
+    _pool.configure_queue([lifo](auto& queue) { queue.set_lifo(lifo); });
+    // Before the config store, see ConnectionFactory::create. A driver handed
+    // to create() is kept whatever config.driver says
+    auto driver = std::atomic_load(&_driver);
+    if (!_driverSupplied && (!driver || config->driver != driver->name())) {
+        if (auto next = createDriver(config->driver)) {
+            std::atomic_store(&_driver, std::move(next));
+        }
+    }
+    if (config->traceFile != previous->traceFile) {
+        // The trace is process wide, a pool only stops the one it started
+        QueryTrace& trace = QueryTrace::instance();
+        if (!previous->traceFile.empty() && trace.path() == previous->traceFile) trace.stop();
+        if (!config->traceFile.empty()) trace.start(config->traceFile);
+    }
+    _pool.set_lock_profiling(config->profileLocks);
+    _leakStackSampling = config->leakDetectionThreshold.count() > 0 ? config->leakStackSampling : 0;
+    _queryProfiler->setSampling(config->queryTimingSampling);
+    _statementStats->setEnabled(config->statementStats);
+    if (!_slowQueryLog) {
+        _slowQueryLog = std::make_shared<SlowQueryLog>(_name, [this] { return ConnectionFactory{this}.open(); });
+    }
+    _slowQueryLog->configure(config->slowQueryThreshold, config->slowQueryExplainSampling, config->slowQueryLog);
+    ResultMemory::Policy memoryPolicy =
+        config->resultMemoryPolicy == PoolConfig::ResultMemoryPolicy::STREAM ? ResultMemory::Policy::STREAM
+        : config->resultMemoryPolicy == PoolConfig::ResultMemoryPolicy::FAIL ? ResultMemory::Policy::FAIL
+                                                                              : ResultMemory::Policy::WAIT;
+    _resultMemory->configure(config->resultMemoryBudget, memoryPolicy, config->connectionTimeout);
+    if (config->profileLocks != previous->profileLocks) {
+        // Process wide too, the last pool to change the setting wins
+        AsyncLogger::instance().set_lock_profiling(config->profileLocks);
+    }
+    std::atomic_store(&_config, std::move(config));
+    // After the store: a connection tagged with the new generation is always
+    // opened with the new credentials
+    if (rotate) {
+        _generation++;
+    }
+    _pool.notify();
+}
+
+bool connection_pool::reloadConfig() {
+    std::lock_guard<std::mutex> reloadLock(_reloadMutex);
+    if (_configFile.empty()) {
+        WARN_LOG("Pool {} was created without a config file, nothing to reload", _name);
+        return false;
+    }
+    PoolConfig next;
     try {
-        auto configManager = createConfigManager(configFile);
-        if (!configManager->loadConfig(configFile)) {
-            ERROR_LOG("Failed to load config file: " + configFile);
-            return false;
+        next = PoolConfig::load(_configFile);
+    } catch (const ConfigError& e) {
+        for (const auto& error : e.errors()) {
+            ERROR_LOG("Config {}: {}", _configFile, error);
         }
-        
-        _ip = configManager->getString("ip", "localhost");
-        _port = configManager->getInt("port", 3306);
-        _username = configManager->getString("username", "root");
-        _password = configManager->getString("password", "");
-        _dbname = configManager->getString("dbname", "test");
-        _initSize = configManager->getInt("initSize", 5);
-        _maxSize = configManager->getInt("maxSize", 10);
-        _maxIdleTime = configManager->getInt("maxIdleTime", 60);
-        _connectionTimeout = configManager->getInt("connectionTimeOut", 100);
-        
-        INFO_LOG("Configuration loaded successfully from " + configFile);
-        return true;
-    } catch (const std::exception& e) {
-        ERROR_LOG(std::string("Config loading error: ") + e.what());
-        //Try loading mysql config file using default way
-        // todo :
-        //    Remind default way isn't responsible for loading result
-        //    Parser will only work for `key=value` way
-        FILE *pf = fopen(configFile.c_str(),"r");
-        if(pf == nullptr)
+        ERROR_LOG("Config reload failed, keep current settings");
+        return false;
+    }
+    auto current = config();
+    bool rotate = !current->sameEndpoint(next);
+    INFO_LOG("Config reloaded: initSize {}->{} maxSize {}->{} maxIdleTime {}s->{}s connectionTimeOut {}ms->{}ms{}",
+             current->initSize, next.initSize, current->maxSize, next.maxSize,
+             current->maxIdleTime.count(), next.maxIdleTime.count(),
+             current->connectionTimeout.count(), next.connectionTimeout.count(),
+             rotate ? ", draining connections with old credentials" : "");
+    applyConfig(std::make_shared<const PoolConfig>(std::move(next)));
+    return true;
+}
+
+void connection_pool::updateConfig(const std::function<void(PoolConfig&)>& edit) {
+    std::lock_guard<std::mutex> reloadLock(_reloadMutex);
+    PoolConfig next = *config();
+    edit(next);
+    auto errors = next.validate();
+    if (!errors.empty()) {
+        throw ConfigError(std::move(errors));
+    }
+    INFO_LOG("Config updated at runtime: maxSize {} maxIdleTime {}s validationInterval {}ms reservedSize {}",
+             next.maxSize, next.maxIdleTime.count(), next.validationInterval.count(), next.reservedSize);
+    applyConfig(std::make_shared<const PoolConfig>(std::move(next)));
+}
+
+void connection_pool::setMaxSize(int maxSize) {
+    updateConfig([maxSize](PoolConfig& c) { c.maxSize = maxSize; });
+}
+
+void connection_pool::setMaxIdleTime(std::chrono::seconds maxIdleTime) {
+    updateConfig([maxIdleTime](PoolConfig& c) { c.maxIdleTime = maxIdleTime; });
+}
+
+void connection_pool::setValidationInterval(std::chrono::milliseconds validationInterval) {
+    updateConfig([validationInterval](PoolConfig& c) { c.validationInterval = validationInterval; });
+}
+
+void connection_pool::setReservedSize(int reservedSize) {
+    updateConfig([reservedSize](PoolConfig& c) { c.reservedSize = reservedSize; });
+}
+
+void connection_pool::drain() {
+    // Borrowed connections now carry a stale generation, retired on return
+    _generation++;
+    _pool.clear_idle();
+    INFO_LOG("Pool {} drained", _name);
+}
+
+PoolSnapshot connection_pool::snapshot() const {
+    PoolSnapshot snap;
+    snap.counters = _pool.counters();
+    snap.config = config();
+    snap.connections.reserve(static_cast<size_t>(snap.counters.total));
+    _pool.for_each([&snap](const connection& conn) {
+        bool inUse = conn.inUse();
+        snap.connections.push_back({reinterpret_cast<uintptr_t>(&conn), inUse, conn.getAge(),
+                                    inUse ? conn.getHoldTime() : conn.getAliveTime(),
+                                    conn.getGeneration(), conn.getQueryCount()});
+    });
+    return snap;
+}
+
+PoolMetricsSnapshot connection_pool::metrics() const {
+    PoolSnapshot snap = snapshot();
+    PoolMetricsSnapshot m;
+    m.pool = _name;
+    m.acquireWait = _metrics.acquireWait.snapshot();
+    m.holdTime = _metrics.holdTime.snapshot();
+    m.acquires = m.acquireWait.count();
+    m.timeouts = _metrics.timeouts.load();
+    m.creations = _metrics.creations.load();
+    m.creationFailures = _metrics.creationFailures.load();
+    m.destructions = _metrics.destructions.load();
+    m.validations = _metrics.validations.load();
+    m.validationFailures = _metrics.validationFailures.load();
+    m.reconnects = _metrics.reconnects.load();
+    m.reconnectFailures = _metrics.reconnectFailures.load();
+    m.queries = _metrics.retiredQueries.load();
+    m.leaksDetected = _metrics.leaksDetected.load();
+    m.leaksReclaimed = _metrics.leaksReclaimed.load();
+    m.queryTimings = _queryProfiler->top(kTopFingerprints);
+    m.statements = _statementStats->top(kTopStatements);
+    if (_slowQueryLog) {
+        m.slowQueries = _slowQueryLog->logged();
+        m.slowQueryPlans = _slowQueryLog->explained();
+    }
+    m.resultMemoryBytes = _resultMemory->used();
+    m.resultMemoryBudget = _resultMemory->budget();
+    m.resultMemoryWaits = _resultMemory->waits();
+    m.resultMemoryStreamed = _resultMemory->streamed();
+    m.resultMemoryRejected = _resultMemory->rejected();
+    for (const auto& conn : snap.connections) {
+        m.queries += conn.queries;
+    }
+    m.gauges = snap.counters;
+    m.maxSize = snap.config->maxSize;
+    m.connections = std::move(snap.connections);
+    for (LockProfileSnapshot lock : {_pool.lock_profile(), AsyncLogger::instance().lock_profile()}) {
+        if (lock.enabled || lock.acquisitions > 0) m.locks.push_back(std::move(lock));
+    }
+    return m;
+}
+
+void connection_pool::setSlowQuerySink(std::shared_ptr<LogSink> sink) {
+    if (_slowQueryLog) _slowQueryLog->setSink(std::move(sink));
+}
+
+std::vector<std::pair<LeakReport, std::shared_ptr<const BorrowSite>>> connection_pool::findLeaks() const {
+    std::vector<std::pair<LeakReport, std::shared_ptr<const BorrowSite>>> leaks;
+    int64_t thresholdUs = chrono::duration_cast<chrono::microseconds>(config()->leakDetectionThreshold).count();
+    if (thresholdUs <= 0) return leaks;
+    _pool.for_each([&](const connection& conn) {
+        int64_t heldUs = conn.getHoldTimeUs();
+        if (!conn.inUse() || heldUs < thresholdUs) return;
+        leaks.push_back({{reinterpret_cast<uintptr_t>(&conn), conn.getBorrowCount(), conn.getBorrowThread(),
+                          static_cast<long>(heldUs / 1000), ""},
+                         conn.getBorrowSite()});
+    });
+    return leaks;
+}
+
+std::vector<LeakReport> connection_pool::leaks() const {
+    std::vector<LeakReport> leaks;
+    // Symbolized outside the registry locks
+    for (auto& [leak, site] : findLeaks()) {
+        if (site) leak.stack = formatBorrowSite(*site);
+        leaks.push_back(std::move(leak));
+    }
+    return leaks;
+}
+
+void connection_pool::leakScanTask() {
+    std::unordered_map<uintptr_t, uint64_t> reported; // connection -> lease already logged
+    while (!_shutdown) {
         {
-            ERROR_LOG("Ini file is not exit!");
-            return false;
+            std::unique_lock<std::mutex> lock(_leakMutex);
+            _leakWake.wait_for(lock, chrono::milliseconds(200), [this] { return _shutdown.load(); });
         }
-        while(!feof(pf)) 
-        {
-            char line[1024] = {0};
-            fgets(line,1023,pf);
-            string str = line;
-            int idx= str.find('=',0); 
-            if(idx == -1)
-            {
-                continue;
-            }
-            int endidx = str.find('\n', idx); 
-            string key = str.substr(0,idx); 
-            string value = str.substr(idx+1, endidx -idx -1); 
-            if (key == "ip")
-            {
-                _ip = value;
-            }
-            else if (key == "port")
-            {
-                _port = atoi(value.c_str()); 
-            }
-            else if (key == "username")
-            {
-                _username = value;
-            }
-            else if (key == "password")
-            {
-                _password = value;
+        auto config = this->config();
+        long reclaimMs = static_cast<long>(config->leakReclaimTimeout.count());
+        std::unordered_map<uintptr_t, uint64_t> leaking;
+        for (const auto& [leak, site] : findLeaks()) {
+            leaking[leak.connection] = leak.lease;
+            auto it = reported.find(leak.connection);
+            if (it == reported.end() || it->second != leak.lease) {
+                // Only new leases are symbolized, the scan repeats every 200ms
+                const std::string& stack = site ? formatBorrowSite(*site) : leak.stack;
+                _metrics.leaksDetected.add();
+                WARN_LOG("Pool {}: connection {:#x} held {}ms by thread {}, possible leak{}{}", _name,
+                         leak.connection, leak.heldMs, leak.thread,
+                         stack.empty() ? " (borrow stack not sampled)" : ", borrowed at:\n", stack);
             }
-            else if (key == "dbname")
-            {
-                _dbname = value;
-            }
-            else if (key == "initSize")
-            {
-                _initSize = atoi(value.c_str());
-            }
-            else if (key == "maxSize")
-            {
-                _maxSize = atoi(value.c_str());
-            }
-            else if (key == "maxIdleTime")
-            {
-                _maxIdleTime = atoi(value.c_str());
-            }
-            else if (key == "connectionTimeOut")
-            {
-                _connectionTimeout = atoi(value.c_str());
+            if (reclaimMs <= 0 || leak.heldMs < reclaimMs) continue;
+            uint64_t lease = leak.lease;
+            bool reclaimed = _pool.abandon(reinterpret_cast<const connection*>(leak.connection),
+                                           [lease](const connection& conn) {
+                                               return conn.inUse() && conn.getBorrowCount() == lease;
+                                           });
+            if (reclaimed) {
+                _metrics.leaksReclaimed.add();
+                WARN_LOG("Pool {}: reclaimed the slot of leaked connection {:#x}, it is closed when its holder "
+                         "returns it", _name, leak.connection);
             }
         }
-        return true;
+        reported = std::move(leaking);
     }
 }
 
+void connection_pool::installReloadSignal(int signo) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = [](int) { g_reloadRequested.store(true); };
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(signo, &sa, nullptr);
+}
 
-// Running in independent thread
-void connection_pool::produceConnectionTask(){
-    for(;;)
-    {   
-        // _queueMutex is used to protect shared resouce
-        // unique_lock automically lock "_queueMutex" and unlock to release resouce
-        // unique lock is more heavy than lock guard, but allows manual lock and support condition
-        unique_lock<mutex> lock(_queueMutex);
-        // Check if existing idle connection, if having, don't need to produce, block producer
-        // Otherwise, double check if empty and start producing
-        while(!_connectionQue.empty()){ // to avoid Spurious Wakeup
-            cv.wait(lock); // atomic unlock and block thread(depends on atomically operate blocking queue)
-        }
+// Opened outside of the pool lock, see basic_pool::add
+std::unique_ptr<connection> connection_pool::ConnectionFactory::create() {
+    // Before open() reads the config, see applyConfig
+    uint64_t generation = pool->_generation.load();
+    auto p = open();
+    p->setGeneration(generation);
+    p->setProfiler(pool->_queryProfiler);
+    p->setStatementStats(pool->_statementStats);
+    p->setSlowQueryLog(pool->_slowQueryLog);
+    p->setResultMemory(pool->_resultMemory);
+    p->refreshsAliveTime();
+    return p;
+}
 
-        if(_connectionCnt < _maxSize){
-            auto p = std::make_unique<connection>();
-            p->connect( _ip,  _port, _username, _password, _dbname);
-            p->refreshsAliveTime();
-            _connectionQue.push(std::move(p));
-            _connectionCnt++;
-        }
-        // Notify all consumers
-        cv.notify_all(); // non-blocking, keep running
+std::unique_ptr<connection> connection_pool::ConnectionFactory::open() {
+    auto config = pool->config();
+    auto p = std::make_unique<connection>(std::atomic_load(&pool->_driver));
+    p->setConnectTimeout(static_cast<unsigned int>(config->connectTimeout.count()));
+    bool ok = p->connect(config->ip, config->port, config->username, config->password, config->dbname);
+    FLIGHT_RECORD(CONNECT, reinterpret_cast<uintptr_t>(p.get()), ok);
+    (ok ? pool->_metrics.creations : pool->_metrics.creationFailures).add();
+    if (!ok) {
+        // Kept anyway, it is reconnected on borrow
+        WARN_LOG("Create connection to {}:{} failed", config->ip, config->port);
+    }
+    return p;
+}
+
+bool connection_pool::ConnectionFactory::validate(connection& conn) {
+    return conn.isValid();
+}
+
+bool connection_pool::ConnectionFactory::repair(connection& conn) {
+    auto config = pool->config();
+    bool ok = conn.reconnect(config->ip, config->port, config->username, config->password, config->dbname);
+    conn.setGeneration(pool->_generation.load());
+    conn.refreshsAliveTime();
+    return ok;
+}
+
+// Connections opened with credentials from an older config are drained
+bool connection_pool::ConnectionFactory::reusable(const connection& conn) const {
+    return conn.getGeneration() == pool->_generation.load();
+}
+
+void connection_pool::ConnectionObserver::destroyed(connection& conn, pool_policy::destroy_reason reason) {
+    if (reason == pool_policy::destroy_reason::stale) {
+        INFO_LOG("Drain connection opened with old credentials");
+    } else if (reason == pool_policy::destroy_reason::idle) {
+        INFO_LOG("Collect idle connection");
+    } else if (reason == pool_policy::destroy_reason::abandoned) {
+        INFO_LOG("Close leaked connection {:#x}, returned after its slot was reclaimed", reinterpret_cast<uintptr_t>(&conn));
+    }
+    FLIGHT_RECORD(DESTROY, reinterpret_cast<uintptr_t>(&conn));
+    pool->_metrics.destructions.add();
+    pool->_metrics.retiredQueries.add(conn.getQueryCount());
+}
+
+void connection_pool::ConnectionObserver::validated(connection& conn, bool ok) {
+    FLIGHT_RECORD(VALIDATE, reinterpret_cast<uintptr_t>(&conn), ok);
+    pool->_metrics.validations.add();
+    if (!ok) {
+        pool->_metrics.validationFailures.add();
+        WARN_LOG("Discovered invalid connection, prepare to reconnect");
     }
 }
 
-// Expose to business, to obtain a free connection
-connection_pool::PooledConnection connection_pool::getconnection()
+void connection_pool::ConnectionObserver::repaired(connection& conn, bool ok) {
+    FLIGHT_RECORD(RECONNECT, reinterpret_cast<uintptr_t>(&conn), ok);
+    pool->_metrics.reconnects.add();
+    if (!ok) pool->_metrics.reconnectFailures.add();
+}
+
+void connection_pool::ConnectionObserver::acquired(connection& conn, std::chrono::nanoseconds waited) {
+    uint64_t waitedUs = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(waited).count());
+    conn.markBorrowed();
+    conn.setAcquireWait(static_cast<int64_t>(waitedUs));
+    if (sampleBorrow(pool->_leakStackSampling.load(std::memory_order_relaxed))) {
+        conn.setBorrowSite(captureBorrowSite(conn.getBorrowCount(), 1));
+    }
+    FLIGHT_RECORD(BORROW, reinterpret_cast<uintptr_t>(&conn), waitedUs);
+    QueryTrace::instance().borrow(&conn, static_cast<int64_t>(waitedUs));
+    pool->_metrics.acquireWait.record(waitedUs);
+}
+
+void connection_pool::ConnectionObserver::timed_out(std::chrono::nanoseconds waited) {
+    uint64_t waitedUs = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(waited).count());
+    FLIGHT_RECORD(TIMEOUT, 0, waitedUs);
+    pool->_metrics.timeouts.add();
+    WARN_LOG("Obtain free connection failed!");
+}
+
+// Under the pool lock, keep it short
+void connection_pool::ConnectionObserver::released(connection& conn, std::chrono::nanoseconds held, bool requeued) {
+    uint64_t holdUs = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(held).count());
+    pool->_metrics.holdTime.record(holdUs);
+    conn.markReturned();
+    FLIGHT_RECORD(RETURN, reinterpret_cast<uintptr_t>(&conn), requeued ? 1 : 0);
+    POOL_PROBE3(release, &conn, holdUs, requeued ? 1 : 0);
+    QueryTrace::instance().release(&conn, static_cast<int64_t>(holdUs));
+    if (requeued) conn.refreshsAliveTime();
+}
+
+// Expose to business, to obtain a free connection. Normal borrowers leave the
+// last reservedSize connections to high priority ones
+connection_pool::PooledConnection connection_pool::getconnection(Priority priority)
 {
-    unique_lock<mutex> lock(_queueMutex); // Depends on cas and Mutex primitives
-    while(_connectionQue.empty()) // All connections have been borrowed
-    {
-        if( cv_status::timeout == cv.wait_for(lock, chrono::microseconds (_connectionTimeout))){ // wait for notify
-            if(_connectionQue.empty())
-            {
-                WARN_LOG("Obtain free connection failed!");
-                throw std::runtime_error("No available connections!");
-            }
-        }
+    POOL_PROBE1(acquire__start, static_cast<int>(priority));
+    auto p = priority == Priority::HIGH ? Pool::priority::high : Pool::priority::normal;
+    auto timeout = chrono::milliseconds(_connectionTimeout.load());
+#ifdef CONNECTION_POOL_PROBES_ENABLED
+    // Fired here rather than from the observer, so a tracer's ustack() starts
+    // at getconnection and its caller instead of inside basic_pool
+    int64_t start = steadyUs();
+    try {
+        auto conn = _pool.acquire(p, timeout);
+        POOL_PROBE3(acquire__done, conn.get(), steadyUs() - start, 1);
+        return conn;
+    } catch (...) {
+        POOL_PROBE3(acquire__done, 0, steadyUs() - start, 0);
+        throw;
     }
-    std::unique_ptr<connection> conn = std::move(_connectionQue.front());
-    _connectionQue.pop();
-    if (!conn->isValid()){
-        WARN_LOG("Obtained invalid connection!");
-        try {
-            conn->reconnect(_ip,_port,_username,_password,_dbname);
-            conn->refreshsAliveTime();
-        } catch(const std::exception& e){
-            _connectionCnt--;
-            cv.notify_all();
-        }
+#else
+    return _pool.acquire(p, timeout);
+#endif
+}
+
+// Reload when the config file is rewritten or replaced (editors and config
+// management usually write a temp file and rename it), or on reload signal
+void connection_pool::watchConfigTask() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    std::string dir = ".";
+    std::string base = _configFile;
+    size_t slash = _configFile.find_last_of('/');
+    if (slash != std::string::npos) {
+        dir = _configFile.substr(0, slash == 0 ? 1 : slash);
+        base = _configFile.substr(slash + 1);
     }
-    connection* rawConn = conn.release(); // release ownership and return original pointer
-    // Must use shared from this(inner weak ptr)
-    // Class needs to be managed by shared ptr
-    // when shared ptr initialized, base class "weak and mutable member" will be set as "this" 
-    std::weak_ptr<connection_pool> poolWeakPtr = this->shared_from_this();
-    auto deleter = [poolWeakPtr](connection* p){ // use weak ptr instead of this
-        // return pooled connection to pool
-        // Need to check if connection_pool is alive
-        if (auto poolPtr = poolWeakPtr.lock()){
-            std::lock_guard<std::mutex> lock(poolPtr->_queueMutex);
-            if (p == nullptr || !p->isValid()){
-                delete p;
-                poolPtr->_connectionCnt--;
-            } else{
-                p->refreshsAliveTime();
-                poolPtr->_connectionQue.push(std::unique_ptr<connection>(p));
-            }
-            poolPtr->cv.notify_all();
-        } else{
-            delete p;
-        }
-    };
-    cv.notify_all();
-    return PooledConnection(rawConn, deleter);
-}
-
-// Collect connections whose idle time > threshold
-void connection_pool::scanRunningConnectionTask() {
-    for(;;) {
-        this_thread::sleep_for(chrono::seconds(_maxIdleTime));
-        
-        unique_lock<mutex> lock(_queueMutex);
-        int invalidCount = 0;
-        
-        // Temporary Queue to store valid connections
-        std::queue<std::unique_ptr<connection>> validConns;
-        
-        while (!_connectionQue.empty()) {
-            auto conn = std::move(_connectionQue.front());
-            _connectionQue.pop();
-            
-            // Check if valid is valid
-            if (!conn->isValid()) {
-                WARN_LOG("Discovered invalid connection, prepare to reconnect");
-                if (!conn->reconnect(_ip, _port, _username, _password, _dbname)) {
-                    // Reconnect failed, destory it in pool
-                    invalidCount++;
-                    _connectionCnt--;
-                    continue;
+    if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        WARN_LOG("Cannot watch {}, config reload only by signal or API", dir);
+        close(fd);
+        fd = -1;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (!_shutdown) {
+        bool reload = g_reloadRequested.exchange(false);
+        if (fd >= 0) {
+            struct pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) > 0) {
+                // Drain every pending event so a burst of writes costs one reload
+                ssize_t n;
+                while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + n;) {
+                        auto* event = reinterpret_cast<struct inotify_event*>(p);
+                        if (event->len > 0 && base == event->name) {
+                            reload = true;
+                        }
+                        p += sizeof(struct inotify_event) + event->len;
+                    }
                 }
             }
-            
-            // Check if connection live time > maxIdleTime
-            if (conn->getAliveTime() >= (_maxIdleTime * 1000) && _connectionCnt > _initSize) {
-                INFO_LOG("Collect idle connection");
-                _connectionCnt--;
-                continue;
-            }
-            
-            // Return to queue
-            validConns.push(std::move(conn));
-        }
-        
-        // Put valid connection to pool
-        while (!validConns.empty()) {
-            _connectionQue.push(std::move(validConns.front()));
-            validConns.pop();
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(200));
         }
-        // If connection number < _initSize, call producer to supply
-        if (_connectionCnt < _initSize) {
-            cv.notify_all();
+        if (reload && !_shutdown) {
+            reloadConfig();
         }
-        
-        lock.unlock();
     }
+    if (fd >= 0) close(fd);
 }
 
 void connection_pool::shutdown(){
-    std::lock_guard<std::mutex> lock(_queueMutex);
-    _shutdown.store(true);
-
-    // Clear queue
-    while(!_connectionQue.empty()){
-        _connectionQue.pop();
+    {
+        std::lock_guard<std::mutex> lock(_leakMutex);
+        _shutdown.store(true);
+    }
+    _leakWake.notify_all();
+    for (std::thread* t : {&_watcher, &_leakScanner}) {
+        if (t->joinable() && t->get_id() != this_thread::get_id()) t->join();
     }
+    // Its explain thread opens connections through this pool
+    if (_slowQueryLog) _slowQueryLog->stop();
+    // Fails waiting borrowers, joins grower and evictor, closes idle connections
+    _pool.stop();
+    auto traceFile = config()->traceFile;
+    if (!traceFile.empty() && QueryTrace::instance().path() == traceFile) QueryTrace::instance().stop();
 }
 
 connection_pool::~connection_pool(){
     shutdown();
-}
\ No newline at end of file
+}
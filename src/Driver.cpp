@@ -0,0 +1,66 @@
+#include "Driver.h"
+#include "FakeDriver.h"
+#include "MysqlDriver.h"
+
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct DriverRegistry
+{
+    std::mutex mutex;
+    std::map<std::string, DriverFactory> factories{
+        {"mysql", [] { return std::make_shared<MysqlDriver>(); }},
+        {"fake", [] { return std::make_shared<FakeDriver>(); }},
+    };
+};
+
+DriverRegistry &registry()
+{
+    static DriverRegistry instance;
+    return instance;
+}
+
+} // namespace
+
+std::string DriverConnection::quote(const std::string &value)
+{
+    std::string out = "'";
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '\0': out += "\\0"; break;
+        case '\\': out += "\\\\"; break;
+        case '\'': out += "''"; break;
+        default: out += c;
+        }
+    }
+    return out + "'";
+}
+
+void registerDriver(const std::string &name, DriverFactory factory)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().factories[name] = std::move(factory);
+}
+
+bool isDriverRegistered(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    return registry().factories.count(name) != 0;
+}
+
+std::shared_ptr<Driver> createDriver(const std::string &name)
+{
+    DriverFactory factory;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        auto it = registry().factories.find(name);
+        if (it == registry().factories.end())
+            return nullptr;
+        factory = it->second;
+    }
+    return factory();
+}
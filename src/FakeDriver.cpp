@@ -0,0 +1,232 @@
+#include "FakeDriver.h"
+
+#include <cmath>
+#include <thread>
+
+LatencyDistribution LatencyDistribution::fixed(std::chrono::microseconds value)
+{
+    LatencyDistribution d;
+    d.kind = Kind::FIXED;
+    d.mean = value;
+    return d;
+}
+
+LatencyDistribution LatencyDistribution::uniform(std::chrono::microseconds min, std::chrono::microseconds max)
+{
+    LatencyDistribution d;
+    d.kind = Kind::UNIFORM;
+    d.min = min;
+    d.max = max;
+    return d;
+}
+
+LatencyDistribution LatencyDistribution::exponential(std::chrono::microseconds mean, std::chrono::microseconds min)
+{
+    LatencyDistribution d;
+    d.kind = Kind::EXPONENTIAL;
+    d.mean = mean;
+    d.min = min;
+    return d;
+}
+
+LatencyDistribution LatencyDistribution::lognormal(std::chrono::microseconds median, double sigma)
+{
+    LatencyDistribution d;
+    d.kind = Kind::LOGNORMAL;
+    d.mean = median;
+    d.sigma = sigma;
+    return d;
+}
+
+std::chrono::microseconds LatencyDistribution::sample(std::mt19937_64 &rng) const
+{
+    using std::chrono::microseconds;
+    switch (kind)
+    {
+    case Kind::FIXED:
+        return mean;
+    case Kind::UNIFORM:
+        return microseconds(std::uniform_int_distribution<int64_t>(min.count(), std::max(min, max).count())(rng));
+    case Kind::EXPONENTIAL:
+        if (mean.count() <= 0)
+            return min;
+        return min + microseconds(static_cast<int64_t>(
+                         std::exponential_distribution<double>(1.0 / static_cast<double>(mean.count()))(rng)));
+    case Kind::LOGNORMAL:
+        if (mean.count() <= 0)
+            return microseconds(0);
+        return microseconds(static_cast<int64_t>(
+            std::lognormal_distribution<double>(std::log(static_cast<double>(mean.count())), sigma)(rng)));
+    }
+    return mean;
+}
+
+namespace {
+
+class FakeResultSet : public ResultSet
+{
+public:
+    explicit FakeResultSet(FakeRows rows) : _rows(std::move(rows)) {}
+    bool next() override { return ++_index < _rows.size(); }
+    unsigned int fieldCount() const override
+    {
+        return _rows.empty() ? 0 : static_cast<unsigned int>(_rows.front().size());
+    }
+    const char *field(unsigned int index) const override { return _rows[_index][index].c_str(); }
+    unsigned long fieldLength(unsigned int index) const override { return _rows[_index][index].size(); }
+    uint64_t rowCount() const override { return _rows.size(); }
+    // Like a buffered mysql result
+    uint64_t memoryBytes() const override
+    {
+        uint64_t bytes = 0;
+        for (const auto &row : _rows)
+        {
+            for (const auto &field : row)
+                bytes += field.size() + 1;
+            bytes += (row.size() + 1) * sizeof(char *);
+        }
+        return bytes;
+    }
+
+private:
+    FakeRows _rows;
+    size_t _index = static_cast<size_t>(-1);
+};
+
+} // namespace
+
+class FakeConnection : public DriverConnection
+{
+public:
+    explicit FakeConnection(std::shared_ptr<FakeDriver> driver) : _driver(std::move(driver)) {}
+    ~FakeConnection() override { close(); }
+
+    void setConnectTimeout(unsigned int) override {}
+
+    bool connect(const std::string &, unsigned short, const std::string &, const std::string &,
+                 const std::string &) override
+    {
+        close();
+        _driver->delay(_driver->_options.connectLatency);
+        if (_driver->fail(_driver->_options.connectFailureRate))
+        {
+            _error = "injected connect failure";
+            return false;
+        }
+        // Reserve a server slot, refuse like "Too many connections" at the limit
+        int open = _driver->_open.load();
+        do
+        {
+            if (open >= _driver->_options.maxConnections)
+            {
+                _error = "Too many connections";
+                return false;
+            }
+        } while (!_driver->_open.compare_exchange_weak(open, open + 1));
+        _connected = true;
+        _epoch = _driver->_epoch.load();
+        return true;
+    }
+
+    void close() override
+    {
+        if (_connected)
+            _driver->_open--;
+        _connected = false;
+    }
+
+    bool ping() override
+    {
+        _driver->delay(_driver->_options.pingLatency);
+        return alive() && !_driver->fail(_driver->_options.pingFailureRate);
+    }
+
+    bool execute(const std::string &sql, uint64_t &affectedRows) override
+    {
+        if (!statement())
+            return false;
+        affectedRows = _driver->_options.handler ? _driver->_options.handler(sql).size() : 1;
+        return true;
+    }
+
+    std::unique_ptr<ResultSet> query(const std::string &sql, bool) override
+    {
+        if (!statement())
+            return nullptr;
+        if (_driver->_options.handler)
+            return std::make_unique<FakeResultSet>(_driver->_options.handler(sql));
+        FakeRows rows(_driver->_options.rowsPerQuery);
+        for (size_t i = 0; i < rows.size(); i++)
+            rows[i].push_back(std::to_string(i + 1));
+        return std::make_unique<FakeResultSet>(std::move(rows));
+    }
+
+    std::string error() const override { return _error; }
+
+private:
+    // A killed session stays dead until reconnected
+    bool alive()
+    {
+        if (_connected && _epoch != _driver->_epoch.load())
+        {
+            close();
+            _error = "Lost connection to server";
+        }
+        return _connected;
+    }
+
+    bool statement()
+    {
+        _driver->_statements++;
+        _driver->delay(_driver->_options.queryLatency);
+        if (!alive())
+            return false;
+        if (_driver->fail(_driver->_options.queryFailureRate))
+        {
+            _error = "injected query failure";
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<FakeDriver> _driver;
+    bool _connected = false;
+    uint64_t _epoch = 0;
+    std::string _error;
+};
+
+FakeDriver::FakeDriver(FakeDriverOptions options) : _options(std::move(options)) {}
+
+std::unique_ptr<DriverConnection> FakeDriver::open()
+{
+    return std::make_unique<FakeConnection>(shared_from_this());
+}
+
+namespace {
+// One stream per thread and driver instance, so sampling never takes a lock
+std::mt19937_64 &threadRng(uint64_t seed, std::atomic<uint64_t> &streams, const void *owner)
+{
+    thread_local const void *rngOwner = nullptr;
+    thread_local std::mt19937_64 rng;
+    if (rngOwner != owner)
+    {
+        rngOwner = owner;
+        rng.seed(seed + 0x9e3779b97f4a7c15ull * (streams.fetch_add(1) + 1));
+    }
+    return rng;
+}
+} // namespace
+
+bool FakeDriver::fail(double rate)
+{
+    if (rate <= 0)
+        return false;
+    return std::uniform_real_distribution<double>(0, 1)(threadRng(_options.seed, _streams, this)) < rate;
+}
+
+void FakeDriver::delay(const LatencyDistribution &latency)
+{
+    auto d = latency.sample(threadRng(_options.seed, _streams, this));
+    if (d.count() > 0)
+        std::this_thread::sleep_for(d);
+}
@@ -0,0 +1,175 @@
+#include "KeysetScan.h"
+#include "ConnectionPool.h"
+#include "SteadyClock.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+std::string quoteIdentifier(const std::string &name)
+{
+    std::string out = "`";
+    for (char c : name)
+    {
+        if (c == '`')
+            out += '`';
+        out += c;
+    }
+    return out + "`";
+}
+
+// "a", "b" -> `a`,`b` and (`a`,`b`); one column stays bare so MySQL sees a plain range
+std::string join(const std::vector<std::string> &items, bool tuple)
+{
+    std::string out;
+    for (size_t i = 0; i < items.size(); i++)
+        out += (i > 0 ? "," : "") + items[i];
+    return tuple && items.size() > 1 ? "(" + out + ")" : out;
+}
+
+} // namespace
+
+KeysetScan::KeysetScan(std::shared_ptr<connection_pool> pool, KeysetScanOptions options)
+    : _pool(std::move(pool)), _options(std::move(options)), _chunkSize(_options.chunkSize)
+{
+    if (_options.table.empty() || _options.keyColumns.empty())
+        throw std::invalid_argument("keyset scan needs a table and key columns");
+    if (_options.chunkSize == 0 || _options.minChunkSize == 0 || _options.minChunkSize > _options.maxChunkSize)
+        throw std::invalid_argument("keyset scan chunk sizes must be positive and minChunkSize <= maxChunkSize");
+
+    std::vector<std::string> keys;
+    for (const auto &key : _options.keyColumns)
+        keys.push_back(quoteIdentifier(key));
+    std::string table;
+    for (size_t start = 0, dot; start <= _options.table.size(); start = dot + 1)
+    {
+        dot = std::min(_options.table.find('.', start), _options.table.size());
+        table += (start > 0 ? "." : "") + quoteIdentifier(_options.table.substr(start, dot - start));
+    }
+    _select = "SELECT " + join(keys, false) + (_options.columns.empty() ? "" : "," + _options.columns) +
+              " FROM " + table;
+}
+
+KeysetScan::~KeysetScan()
+{
+    if (_prefetcher.joinable())
+        _prefetcher.join();
+}
+
+std::string KeysetScan::chunkSql(const std::vector<std::string> &after, size_t limit) const
+{
+    std::vector<std::string> keys;
+    for (const auto &key : _options.keyColumns)
+        keys.push_back(quoteIdentifier(key));
+
+    std::string sql = _select;
+    if (!_options.where.empty())
+        sql += " WHERE (" + _options.where + ")";
+    if (!after.empty())
+        sql += (_options.where.empty() ? " WHERE " : " AND ") + join(keys, true) + " > " + join(after, true);
+    return sql + " ORDER BY " + join(keys, false) + " LIMIT " + std::to_string(limit);
+}
+
+bool KeysetScan::next()
+{
+    if (_failed || _end)
+    {
+        _current.rows.clear();
+        return false;
+    }
+    if (_prefetcher.joinable())
+    {
+        _prefetcher.join();
+        std::swap(_current, _ahead); // both keep their buffers
+    }
+    else
+    {
+        fetch(_current, _chunks == 0 ? std::vector<std::string>() : lastKey(_current), _chunkSize);
+    }
+    if (!_current.ok)
+    {
+        _failed = true;
+        _current.rows.clear();
+        if (_current.error)
+            std::rethrow_exception(std::exchange(_current.error, nullptr));
+        return false;
+    }
+    adapt(_current);
+    // A short chunk is the last one, no need to ask for an empty one after it
+    _end = _current.rows.rows < _current.limit;
+    if (_current.rows.rows == 0)
+        return false;
+    _chunks++;
+    _rowsRead += _current.rows.rows;
+    if (_options.prefetch && !_end)
+        _prefetcher = std::thread(&KeysetScan::fetch, this, std::ref(_ahead), lastKey(_current), _chunkSize);
+    return true;
+}
+
+void KeysetScan::fetch(Chunk &chunk, std::vector<std::string> after, size_t limit)
+{
+    chunk.rows.clear();
+    chunk.fields = 0;
+    chunk.limit = limit;
+    chunk.latencyUs = 0;
+    chunk.ok = false;
+    chunk.error = nullptr;
+    // Borrowed for this chunk only. Thrown on the prefetch thread it would
+    // terminate the process, next() rethrows it on the caller's
+    decltype(_pool->getconnection()) conn;
+    try
+    {
+        conn = _pool->getconnection();
+    }
+    catch (...)
+    {
+        chunk.error = std::current_exception();
+        return;
+    }
+    // Quoted by the session, which knows its sql_mode
+    for (auto &value : after)
+        value = conn->quote(value);
+    std::string sql = chunkSql(after, limit);
+    int64_t start = steadyUs();
+    // Streamed straight into the chunk, not buffered twice
+    auto rows = conn->select(sql, true);
+    if (!rows)
+        return;
+    chunk.fields = rows->fieldCount();
+    size_t keys = _options.keyColumns.size();
+    bool nullKey = false;
+    while (rows->next())
+    {
+        for (size_t i = 0; i < keys && i < chunk.fields; i++)
+            nullKey = nullKey || rows->field(static_cast<unsigned int>(i)) == nullptr;
+        chunk.rows.append(*rows, chunk.fields);
+    }
+    if (nullKey)
+        WARN_LOG("Keyset scan of {} stopped, NULL in a key column", _options.table);
+    chunk.ok = !rows->failed() && !nullKey && (chunk.rows.rows == 0 || chunk.fields >= keys);
+    rows.reset();
+    chunk.latencyUs = steadyUs() - start;
+}
+
+std::vector<std::string> KeysetScan::lastKey(const Chunk &chunk) const
+{
+    std::vector<std::string> key;
+    StreamRow last(chunk.rows, chunk.rows.rows - 1, chunk.fields);
+    for (unsigned int i = 0; i < _options.keyColumns.size(); i++)
+        key.emplace_back(last.field(i), last.fieldLength(i)); // never NULL, see fetch()
+    return key;
+}
+
+void KeysetScan::adapt(const Chunk &chunk)
+{
+    int64_t targetUs = std::chrono::duration_cast<std::chrono::microseconds>(_options.targetChunkLatency).count();
+    // The short last chunk says little about the next ones
+    if (targetUs <= 0 || chunk.latencyUs <= 0 || chunk.rows.rows < chunk.limit)
+        return;
+    // At most twice or half the size per chunk, one slow statement doesn't collapse it
+    double scale = std::clamp(static_cast<double>(targetUs) / static_cast<double>(chunk.latencyUs), 0.5, 2.0);
+    _chunkSize = std::clamp(static_cast<size_t>(static_cast<double>(chunk.limit) * scale), _options.minChunkSize,
+                            _options.maxChunkSize);
+}
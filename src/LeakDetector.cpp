@@ -0,0 +1,69 @@
+#include "LeakDetector.h"
+
+#include <cstdlib>
+
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kMaxFrames = 32;
+
+} // namespace
+
+uint32_t currentThreadId()
+{
+    thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+bool sampleBorrow(int everyN)
+{
+    if (everyN <= 0)
+        return false;
+    thread_local unsigned borrows = 0;
+    return ++borrows % static_cast<unsigned>(everyN) == 0;
+}
+
+std::shared_ptr<const BorrowSite> captureBorrowSite(uint64_t lease, int skip)
+{
+    void *frames[kMaxFrames];
+    int depth = backtrace(frames, kMaxFrames);
+    auto site = std::make_shared<BorrowSite>();
+    site->lease = lease;
+    // +1 for this function
+    for (int i = skip + 1; i < depth; i++)
+        site->frames.push_back(frames[i]);
+    return site;
+}
+
+namespace {
+
+std::string symbolize(const BorrowSite &site)
+{
+    std::string out;
+    if (site.frames.empty())
+        return out;
+    char **symbols = backtrace_symbols(site.frames.data(), static_cast<int>(site.frames.size()));
+    if (symbols == nullptr)
+        return out;
+    for (size_t i = 0; i < site.frames.size(); i++)
+    {
+        out += "  #";
+        out += std::to_string(i);
+        out += ' ';
+        out += symbols[i];
+        out += '\n';
+    }
+    std::free(symbols);
+    return out;
+}
+
+} // namespace
+
+const std::string &formatBorrowSite(const BorrowSite &site)
+{
+    std::call_once(site.symbolizeOnce, [&site] { site.symbolized = symbolize(site); });
+    return site.symbolized;
+}
@@ -0,0 +1,146 @@
+#include "MysqlDriver.h"
+#include "SteadyClock.hpp"
+
+MysqlResultSet::MysqlResultSet(MYSQL_RES *res, MYSQL *stream)
+    : _res(res), _stream(stream), _fields(mysql_num_fields(res))
+{
+}
+
+uint64_t MysqlResultSet::memoryBytes() const
+{
+    if (_stream != nullptr || _sized)
+        return _bytes;
+    _sized = true;
+    // One pass over rows already in memory, then back to the row next() is on
+    mysql_data_seek(_res, 0);
+    while (MYSQL_ROW row = mysql_fetch_row(_res))
+    {
+        unsigned long *lengths = mysql_fetch_lengths(_res);
+        for (unsigned int i = 0; i < _fields; i++)
+            _bytes += lengths[i] + 1;
+        _bytes += (_fields + 1) * sizeof(row);
+    }
+    mysql_data_seek(_res, _position == 0 ? 0 : _position - 1);
+    if (_position > 0)
+    {
+        // The lengths of the current row were overwritten by the pass
+        mysql_fetch_row(_res);
+        _lengths = mysql_fetch_lengths(_res);
+    }
+    return _bytes;
+}
+
+MysqlResultSet::~MysqlResultSet()
+{
+    // Streamed results must be read to the end before the session is usable again,
+    // mysql_free_result does that
+    mysql_free_result(_res);
+}
+
+bool MysqlResultSet::next()
+{
+    _row = mysql_fetch_row(_res);
+    if (_row == nullptr)
+    {
+        // End of a streamed result, or a read error
+        _failed = _stream != nullptr && mysql_errno(_stream) != 0;
+        return false;
+    }
+    _lengths = mysql_fetch_lengths(_res);
+    _position++;
+    return true;
+}
+
+MysqlConnection::MysqlConnection()
+{
+    _conn = mysql_init(nullptr);
+}
+
+MysqlConnection::~MysqlConnection()
+{
+    close();
+}
+
+void MysqlConnection::setConnectTimeout(unsigned int seconds)
+{
+    _connectTimeout = seconds;
+    if (_conn != nullptr && seconds > 0)
+        mysql_options(_conn, MYSQL_OPT_CONNECT_TIMEOUT, &_connectTimeout);
+}
+
+bool MysqlConnection::connect(const std::string &ip, unsigned short port, const std::string &user,
+                              const std::string &password, const std::string &dbname)
+{
+    // A handle that has been connected once cannot be connected again
+    close();
+    _conn = mysql_init(nullptr);
+    if (_conn == nullptr)
+        return false;
+    setConnectTimeout(_connectTimeout);
+    MYSQL *p = mysql_real_connect(_conn, ip.c_str(), user.c_str(),
+                                  password.c_str(), dbname.c_str(), port, nullptr, 0);
+    return p != nullptr;
+}
+
+void MysqlConnection::close()
+{
+    if (_conn != nullptr)
+        mysql_close(_conn);
+    _conn = nullptr;
+}
+
+bool MysqlConnection::ping()
+{
+    // USE COM_PING with low cost
+    return _conn != nullptr && mysql_ping(_conn) == 0;
+}
+
+bool MysqlConnection::execute(const std::string &sql, uint64_t &affectedRows)
+{
+    if (_conn == nullptr || mysql_real_query(_conn, sql.data(), sql.size()) != 0)
+        return false;
+    _fetchUs = 0;
+    // Discard a result set the statement may have produced anyway
+    if (MYSQL_RES *res = storeResult())
+        mysql_free_result(res);
+    affectedRows = mysql_affected_rows(_conn);
+    return true;
+}
+
+std::unique_ptr<ResultSet> MysqlConnection::query(const std::string &sql, bool stream)
+{
+    if (_conn == nullptr || mysql_real_query(_conn, sql.data(), sql.size()) != 0)
+        return nullptr;
+    _fetchUs = 0;
+    MYSQL_RES *res = stream ? mysql_use_result(_conn) : storeResult();
+    if (res == nullptr)
+        return nullptr;
+    return std::make_unique<MysqlResultSet>(res, stream ? _conn : nullptr);
+}
+
+MYSQL_RES *MysqlConnection::storeResult()
+{
+    int64_t start = steadyUs();
+    MYSQL_RES *res = mysql_store_result(_conn);
+    _fetchUs = steadyUs() - start;
+    return res;
+}
+
+std::string MysqlConnection::quote(const std::string &value)
+{
+    if (_conn == nullptr)
+        return DriverConnection::quote(value);
+    // Worst case every byte escaped, plus the terminator
+    std::string out(value.size() * 2 + 1, '\0');
+    unsigned long length = mysql_real_escape_string_quote(_conn, &out[0], value.data(),
+                                                          static_cast<unsigned long>(value.size()), '\'');
+    if (length == static_cast<unsigned long>(-1))
+        return DriverConnection::quote(value);
+    out.resize(length);
+    return "'" + out + "'";
+}
+
+std::string MysqlConnection::error() const
+{
+    return _conn != nullptr ? mysql_error(_conn) : "not connected";
+}
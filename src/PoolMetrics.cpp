@@ -0,0 +1,371 @@
+#include "PoolMetrics.h"
+
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace {
+
+// Histogram bucket bounds in us, exported as seconds
+const uint64_t kBucketBoundsUs[] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+
+std::string escapeLabel(const std::string &value)
+{
+    std::string out;
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+            out += '\\';
+        if (c == '\n')
+        {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string escapeJson(const std::string &value)
+{
+    std::string out;
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                fmt::format_to(std::back_inserter(out), "\\u{:04x}", c);
+            else
+                out += c;
+        }
+    }
+    return out;
+}
+
+using CounterField = uint64_t PoolMetricsSnapshot::*;
+
+struct CounterMetric
+{
+    const char *name;
+    const char *help;
+    CounterField field;
+};
+
+const CounterMetric kCounters[] = {
+    {"connection_pool_acquires_total", "Connections handed out by getconnection", &PoolMetricsSnapshot::acquires},
+    {"connection_pool_acquire_timeouts_total", "getconnection calls that timed out", &PoolMetricsSnapshot::timeouts},
+    {"connection_pool_connections_created_total", "Connections opened", &PoolMetricsSnapshot::creations},
+    {"connection_pool_connection_failures_total", "Connection attempts that failed", &PoolMetricsSnapshot::creationFailures},
+    {"connection_pool_connections_destroyed_total", "Connections closed by the pool", &PoolMetricsSnapshot::destructions},
+    {"connection_pool_validations_total", "Connection pings", &PoolMetricsSnapshot::validations},
+    {"connection_pool_validation_failures_total", "Connection pings that failed", &PoolMetricsSnapshot::validationFailures},
+    {"connection_pool_reconnects_total", "Reconnect attempts", &PoolMetricsSnapshot::reconnects},
+    {"connection_pool_reconnect_failures_total", "Reconnect attempts that failed", &PoolMetricsSnapshot::reconnectFailures},
+    {"connection_pool_queries_total", "Statements sent through pooled connections", &PoolMetricsSnapshot::queries},
+    {"connection_pool_leaks_detected_total", "Leases held longer than leakDetectionThreshold", &PoolMetricsSnapshot::leaksDetected},
+    {"connection_pool_leaks_reclaimed_total", "Leaked leases whose slot was given back", &PoolMetricsSnapshot::leaksReclaimed},
+    {"connection_pool_slow_queries_total", "Statements written to the slow query log", &PoolMetricsSnapshot::slowQueries},
+    {"connection_pool_slow_query_plans_total", "Slow query log entries with an EXPLAIN plan", &PoolMetricsSnapshot::slowQueryPlans},
+    {"connection_pool_result_memory_waits_total", "Buffered selects that waited for the result memory budget", &PoolMetricsSnapshot::resultMemoryWaits},
+    {"connection_pool_result_memory_streamed_total", "Buffered selects run streamed over the result memory budget", &PoolMetricsSnapshot::resultMemoryStreamed},
+    {"connection_pool_result_memory_rejected_total", "Buffered selects failed over the result memory budget", &PoolMetricsSnapshot::resultMemoryRejected},
+};
+
+void renderHistogram(std::string &out, const char *name, const char *help,
+                     const std::vector<PoolMetricsSnapshot> &pools, HistogramSnapshot PoolMetricsSnapshot::*field)
+{
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+    for (const auto &pool : pools)
+    {
+        const HistogramSnapshot &h = pool.*field;
+        std::string label = escapeLabel(pool.pool);
+        for (uint64_t bound : kBucketBoundsUs)
+            fmt::format_to(it, "{}_bucket{{pool=\"{}\",le=\"{}\"}} {}\n", name, label, bound / 1e6, h.countAtOrBelow(bound));
+        fmt::format_to(it, "{}_bucket{{pool=\"{}\",le=\"+Inf\"}} {}\n", name, label, h.count());
+        fmt::format_to(it, "{}_sum{{pool=\"{}\"}} {}\n", name, label, h.sum() / 1e6);
+        fmt::format_to(it, "{}_count{{pool=\"{}\"}} {}\n", name, label, h.count());
+    }
+}
+
+// Lock wait and hold buckets in ns, exported as seconds
+const uint64_t kLockBucketBoundsNs[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+                                        250000, 500000, 1000000, 2500000, 10000000, 100000000};
+
+void renderLockHistogram(std::string &out, const char *name, const char *help,
+                         const std::vector<PoolMetricsSnapshot> &pools, HistogramSnapshot LockProfileSnapshot::*field)
+{
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+    for (const auto &pool : pools)
+    {
+        for (const auto &lock : pool.locks)
+        {
+            const HistogramSnapshot &h = lock.*field;
+            std::string labels = fmt::format("pool=\"{}\",lock=\"{}\"", escapeLabel(pool.pool), escapeLabel(lock.name));
+            for (uint64_t bound : kLockBucketBoundsNs)
+                fmt::format_to(it, "{}_bucket{{{},le=\"{}\"}} {}\n", name, labels, bound / 1e9, h.countAtOrBelow(bound));
+            fmt::format_to(it, "{}_bucket{{{},le=\"+Inf\"}} {}\n", name, labels, h.count());
+            fmt::format_to(it, "{}_sum{{{}}} {}\n", name, labels, h.sum() / 1e9);
+            fmt::format_to(it, "{}_count{{{}}} {}\n", name, labels, h.count());
+        }
+    }
+}
+
+void renderLocks(std::string &out, const std::vector<PoolMetricsSnapshot> &pools)
+{
+    bool any = false;
+    for (const auto &pool : pools)
+        any = any || !pool.locks.empty();
+    if (!any)
+        return;
+    auto it = std::back_inserter(out);
+    struct LockCounter
+    {
+        const char *name;
+        const char *help;
+        uint64_t LockProfileSnapshot::*field;
+    };
+    const LockCounter counters[] = {
+        {"connection_pool_lock_acquisitions_total", "Profiled lock acquisitions", &LockProfileSnapshot::acquisitions},
+        {"connection_pool_lock_contended_total", "Profiled lock acquisitions that had to wait", &LockProfileSnapshot::contended},
+    };
+    for (const auto &counter : counters)
+    {
+        fmt::format_to(it, "# HELP {} {}\n# TYPE {} counter\n", counter.name, counter.help, counter.name);
+        for (const auto &pool : pools)
+        {
+            for (const auto &lock : pool.locks)
+                fmt::format_to(it, "{}{{pool=\"{}\",lock=\"{}\"}} {}\n", counter.name, escapeLabel(pool.pool),
+                               escapeLabel(lock.name), lock.*counter.field);
+        }
+    }
+    renderLockHistogram(out, "connection_pool_lock_wait_seconds", "Wait for a contended profiled lock", pools,
+                        &LockProfileSnapshot::waitNs);
+    renderLockHistogram(out, "connection_pool_lock_hold_seconds", "Profiled lock hold time", pools,
+                        &LockProfileSnapshot::holdNs);
+    // Bounded by ProfiledMutex::kMaxSites per lock
+    fmt::format_to(it, "# HELP connection_pool_lock_max_hold_seconds Longest single hold per call site\n"
+                       "# TYPE connection_pool_lock_max_hold_seconds gauge\n");
+    for (const auto &pool : pools)
+    {
+        for (const auto &lock : pool.locks)
+        {
+            for (const auto &site : lock.sites)
+                fmt::format_to(it, "connection_pool_lock_max_hold_seconds{{pool=\"{}\",lock=\"{}\",site=\"{}\"}} {}\n",
+                               escapeLabel(pool.pool), escapeLabel(lock.name), escapeLabel(site.site),
+                               site.maxHoldNs / 1e9);
+        }
+    }
+}
+
+void renderHistogramJson(std::string &out, const HistogramSnapshot &h)
+{
+    fmt::format_to(std::back_inserter(out),
+                   "{{\"count\":{},\"mean\":{:.1f},\"p50\":{},\"p90\":{},\"p99\":{},\"p999\":{},\"max\":{}}}",
+                   h.count(), h.mean(), h.percentile(0.5), h.percentile(0.9), h.percentile(0.99),
+                   h.percentile(0.999), h.max());
+}
+
+} // namespace
+
+std::string renderPrometheus(const std::vector<PoolMetricsSnapshot> &pools)
+{
+    std::string out;
+    auto it = std::back_inserter(out);
+    for (const auto &metric : kCounters)
+    {
+        fmt::format_to(it, "# HELP {} {}\n# TYPE {} counter\n", metric.name, metric.help, metric.name);
+        for (const auto &pool : pools)
+            fmt::format_to(it, "{}{{pool=\"{}\"}} {}\n", metric.name, escapeLabel(pool.pool), pool.*metric.field);
+    }
+
+    struct Gauge
+    {
+        const char *name;
+        const char *help;
+        int64_t (*value)(const PoolMetricsSnapshot &);
+    };
+    const Gauge gauges[] = {
+        {"connection_pool_idle_connections", "Connections in the idle queue",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.gauges.idle); }},
+        {"connection_pool_active_connections", "Connections lent to borrowers",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.gauges.inUse); }},
+        {"connection_pool_creating_connections", "Connections being opened",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.gauges.creating); }},
+        {"connection_pool_waiting_borrowers", "Borrowers blocked in getconnection",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.gauges.waiters); }},
+        {"connection_pool_max_connections", "Configured maxSize",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.maxSize); }},
+        {"connection_pool_result_memory_bytes", "Bytes held by buffered results, counted while a budget is set",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.resultMemoryBytes); }},
+        {"connection_pool_result_memory_budget_bytes", "Configured resultMemoryBudget, 0 = no limit",
+         [](const PoolMetricsSnapshot &p) { return static_cast<int64_t>(p.resultMemoryBudget); }},
+    };
+    for (const auto &gauge : gauges)
+    {
+        fmt::format_to(it, "# HELP {} {}\n# TYPE {} gauge\n", gauge.name, gauge.help, gauge.name);
+        for (const auto &pool : pools)
+            fmt::format_to(it, "{}{{pool=\"{}\"}} {}\n", gauge.name, escapeLabel(pool.pool), gauge.value(pool));
+    }
+
+    renderHistogram(out, "connection_pool_acquire_wait_seconds", "Time spent in getconnection",
+                    pools, &PoolMetricsSnapshot::acquireWait);
+    renderHistogram(out, "connection_pool_hold_seconds", "Time between borrow and return",
+                    pools, &PoolMetricsSnapshot::holdTime);
+
+    // Bounded by maxSize per pool
+    fmt::format_to(it, "# HELP connection_pool_connection_queries_total Statements sent per live connection\n"
+                       "# TYPE connection_pool_connection_queries_total counter\n");
+    for (const auto &pool : pools)
+    {
+        for (const auto &conn : pool.connections)
+            fmt::format_to(it, "connection_pool_connection_queries_total{{pool=\"{}\",connection=\"{:#x}\"}} {}\n",
+                           escapeLabel(pool.pool), conn.id, conn.queries);
+    }
+    renderLocks(out, pools);
+
+    // Bounded by connection_pool::kTopFingerprints per pool
+    fmt::format_to(it, "# HELP connection_pool_query_phase_seconds_total Sampled statement time per phase\n"
+                       "# TYPE connection_pool_query_phase_seconds_total counter\n");
+    for (const auto &pool : pools)
+    {
+        for (const auto &t : pool.queryTimings)
+        {
+            const std::pair<const char *, uint64_t> phases[] = {
+                {"wait", t.waitUs}, {"network", t.networkUs}, {"server", t.serverUs}, {"decode", t.decodeUs}};
+            for (const auto &phase : phases)
+                fmt::format_to(it, "connection_pool_query_phase_seconds_total{{pool=\"{}\",fingerprint=\"{:016x}\",phase=\"{}\"}} {}\n",
+                               escapeLabel(pool.pool), t.fingerprint, phase.first, phase.second / 1e6);
+        }
+    }
+    fmt::format_to(it, "# HELP connection_pool_query_samples_total Statements timed per fingerprint\n"
+                       "# TYPE connection_pool_query_samples_total counter\n");
+    for (const auto &pool : pools)
+    {
+        for (const auto &t : pool.queryTimings)
+            fmt::format_to(it, "connection_pool_query_samples_total{{pool=\"{}\",fingerprint=\"{:016x}\"}} {}\n",
+                           escapeLabel(pool.pool), t.fingerprint, t.samples);
+    }
+
+    // Statement table, bounded by connection_pool::kTopStatements per pool
+    struct StatementFamily
+    {
+        const char *name;
+        const char *help;
+        const char *type;
+        double (*value)(const StatementStat &);
+    };
+    const StatementFamily families[] = {
+        {"connection_pool_statement_calls_total", "Statements run per fingerprint", "counter",
+         [](const StatementStat &s) { return double(s.calls); }},
+        {"connection_pool_statement_errors_total", "Statements failed per fingerprint", "counter",
+         [](const StatementStat &s) { return double(s.errors); }},
+        {"connection_pool_statement_rows_total", "Rows read or affected per fingerprint", "counter",
+         [](const StatementStat &s) { return double(s.rows); }},
+        {"connection_pool_statement_bytes_total", "Statement text sent and field bytes read per fingerprint", "counter",
+         [](const StatementStat &s) { return double(s.bytes); }},
+        {"connection_pool_statement_seconds_total", "Statement time per fingerprint", "counter",
+         [](const StatementStat &s) { return s.totalUs / 1e6; }},
+        {"connection_pool_statement_max_seconds", "Slowest statement per fingerprint", "gauge",
+         [](const StatementStat &s) { return s.maxUs / 1e6; }},
+    };
+    bool anyStatements = false;
+    for (const auto &pool : pools)
+        anyStatements = anyStatements || !pool.statements.empty();
+    for (const auto &family : families)
+    {
+        if (!anyStatements) // statementStats off everywhere
+            break;
+        fmt::format_to(it, "# HELP {} {}\n# TYPE {} {}\n", family.name, family.help, family.name, family.type);
+        for (const auto &pool : pools)
+        {
+            for (const auto &st : pool.statements)
+                fmt::format_to(it, "{}{{pool=\"{}\",fingerprint=\"{:016x}\"}} {}\n", family.name,
+                               escapeLabel(pool.pool), st.fingerprint, family.value(st));
+        }
+    }
+    return out;
+}
+
+std::string renderJson(const std::vector<PoolMetricsSnapshot> &pools)
+{
+    std::string out = "{\"pools\":[";
+    auto it = std::back_inserter(out);
+    for (size_t i = 0; i < pools.size(); i++)
+    {
+        const auto &pool = pools[i];
+        if (i > 0)
+            out += ',';
+        fmt::format_to(it, "{{\"pool\":\"{}\"", escapeJson(pool.pool));
+        for (const auto &metric : kCounters)
+        {
+            // connection_pool_acquires_total -> acquires_total
+            fmt::format_to(it, ",\"{}\":{}", metric.name + sizeof("connection_pool_") - 1, pool.*metric.field);
+        }
+        fmt::format_to(it, ",\"idle\":{},\"active\":{},\"creating\":{},\"waiting\":{},\"total\":{},\"maxSize\":{}",
+                       pool.gauges.idle, pool.gauges.inUse, pool.gauges.creating, pool.gauges.waiters,
+                       pool.gauges.total, pool.maxSize);
+        fmt::format_to(it, ",\"resultMemoryBytes\":{},\"resultMemoryBudget\":{}", pool.resultMemoryBytes,
+                       pool.resultMemoryBudget);
+        out += ",\"acquireWaitUs\":";
+        renderHistogramJson(out, pool.acquireWait);
+        out += ",\"holdTimeUs\":";
+        renderHistogramJson(out, pool.holdTime);
+        out += ",\"connections\":[";
+        for (size_t j = 0; j < pool.connections.size(); j++)
+        {
+            const auto &conn = pool.connections[j];
+            if (j > 0)
+                out += ',';
+            fmt::format_to(it, "{{\"id\":\"{:#x}\",\"inUse\":{},\"ageMs\":{},\"stateMs\":{},\"generation\":{},\"queries\":{}}}",
+                           conn.id, conn.inUse, conn.ageMs, conn.stateMs, conn.generation, conn.queries);
+        }
+        out += "],\"locks\":[";
+        for (size_t j = 0; j < pool.locks.size(); j++)
+        {
+            const auto &lock = pool.locks[j];
+            if (j > 0)
+                out += ',';
+            fmt::format_to(it, "{{\"name\":\"{}\",\"enabled\":{},\"acquisitions\":{},\"contended\":{},\"waitNs\":",
+                           escapeJson(lock.name), lock.enabled, lock.acquisitions, lock.contended);
+            renderHistogramJson(out, lock.waitNs);
+            out += ",\"holdNs\":";
+            renderHistogramJson(out, lock.holdNs);
+            out += ",\"sites\":[";
+            for (size_t k = 0; k < lock.sites.size(); k++)
+            {
+                const auto &site = lock.sites[k];
+                fmt::format_to(it, "{}{{\"site\":\"{}\",\"acquisitions\":{},\"holdNs\":{},\"maxHoldNs\":{}}}",
+                               k > 0 ? "," : "", escapeJson(site.site), site.acquisitions, site.holdNs, site.maxHoldNs);
+            }
+            out += "]}";
+        }
+        out += "],\"queryTimings\":[";
+        for (size_t j = 0; j < pool.queryTimings.size(); j++)
+        {
+            const auto &t = pool.queryTimings[j];
+            fmt::format_to(it, "{}{{\"fingerprint\":\"{:016x}\",\"statement\":\"{}\",\"samples\":{},\"waitUs\":{},"
+                               "\"networkUs\":{},\"serverUs\":{},\"decodeUs\":{},\"totalUs\":{},\"maxTotalUs\":{}}}",
+                           j > 0 ? "," : "", t.fingerprint, escapeJson(t.normalized), t.samples, t.waitUs, t.networkUs,
+                           t.serverUs, t.decodeUs, t.totalUs, t.maxTotalUs);
+        }
+        out += "],\"statements\":[";
+        for (size_t j = 0; j < pool.statements.size(); j++)
+        {
+            const auto &st = pool.statements[j];
+            fmt::format_to(it, "{}{{\"fingerprint\":\"{:016x}\",\"statement\":\"{}\",\"calls\":{},\"errors\":{},"
+                               "\"rows\":{},\"bytes\":{},\"totalUs\":{},\"meanUs\":{},\"maxUs\":{}}}",
+                           j > 0 ? "," : "", st.fingerprint, escapeJson(st.normalized), st.calls, st.errors, st.rows,
+                           st.bytes, st.totalUs, st.meanUs(), st.maxUs);
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out;
+}
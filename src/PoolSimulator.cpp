@@ -0,0 +1,314 @@
+#include "PoolSimulator.h"
+#include "BasicPool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+struct SimConnection
+{
+    bool healthy = true;
+};
+
+// Backend model shared by factory and observer, all on the simulation thread
+struct SimBackend
+{
+    const FakeDriverOptions *options;
+    std::mt19937_64 rng;
+    int64_t chargedUs = 0; // ping and reconnect time spent inside the last acquire
+    SimResult *result;
+
+    bool fail(double rate) { return rate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < rate; }
+    int64_t sample(const LatencyDistribution &latency) { return latency.sample(rng).count(); }
+};
+
+struct SimFactory
+{
+    SimBackend *backend;
+
+    std::unique_ptr<SimConnection> create()
+    {
+        backend->result->connects++;
+        auto conn = std::make_unique<SimConnection>();
+        // Kept when the connect failed, like connection_pool: repaired on borrow
+        conn->healthy = !backend->fail(backend->options->connectFailureRate);
+        return conn;
+    }
+    bool validate(SimConnection &conn)
+    {
+        backend->chargedUs += backend->sample(backend->options->pingLatency);
+        return conn.healthy && !backend->fail(backend->options->pingFailureRate);
+    }
+    bool repair(SimConnection &conn)
+    {
+        backend->chargedUs += backend->sample(backend->options->connectLatency);
+        backend->result->connects++;
+        conn.healthy = !backend->fail(backend->options->connectFailureRate);
+        return conn.healthy;
+    }
+    bool reusable(const SimConnection &) const { return true; }
+};
+
+struct SimObserver : pool_policy::no_observer
+{
+    SimResult *result;
+    void validated(SimConnection &, bool ok)
+    {
+        result->validations++;
+        if (!ok)
+            result->validationFailures++;
+    }
+    void repaired(SimConnection &, bool) { result->reconnects++; }
+    void destroyed(SimConnection &, pool_policy::destroy_reason reason)
+    {
+        if (reason == pool_policy::destroy_reason::idle)
+            result->evictions++;
+    }
+};
+
+struct SimClockPolicy
+{
+    using role = pool_policy::clock_role;
+    using clock = SimClock;
+    static SimClock::time_point now() { return SimClock::now(); }
+};
+
+// Same policies as connection_pool, except the waiter strategy: the event loop
+// keeps the waiting borrowers instead of blocking threads
+using SimPool = basic_pool<SimConnection, SimFactory,
+                           pool_policy::selectable_order,
+                           pool_policy::configurable_validation,
+                           pool_policy::bounded_sizing,
+                           pool_policy::fail_fast,
+                           SimObserver,
+                           SimClockPolicy>;
+
+enum class EventKind
+{
+    ARRIVAL,
+    FINISH,
+    CONNECTED,
+    TIMEOUT,
+    EVICT,
+};
+
+struct Event
+{
+    int64_t at;
+    uint64_t seq; // ties broken by scheduling order, keeps runs reproducible
+    EventKind kind;
+    size_t request;
+    bool operator>(const Event &other) const
+    {
+        return at != other.at ? at > other.at : seq > other.seq;
+    }
+};
+
+// Log-linear counts without the atomics of Histogram, single threaded
+class LocalHistogram
+{
+public:
+    LocalHistogram() : _counts(Histogram::kCountsLength, 0) {}
+    void record(int64_t value)
+    {
+        uint64_t v = std::min<uint64_t>(static_cast<uint64_t>(std::max<int64_t>(value, 0)), Histogram::kMaxValue);
+        _counts[Histogram::indexOf(v)]++;
+        _sum += v;
+    }
+    HistogramSnapshot snapshot() const { return HistogramSnapshot(_counts, _sum); }
+
+private:
+    std::vector<uint64_t> _counts;
+    uint64_t _sum = 0;
+};
+
+} // namespace
+
+std::vector<SimRequest> poissonArrivals(double rate, int64_t durationUs, uint64_t seed)
+{
+    std::vector<SimRequest> requests;
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap(rate / 1e6);
+    for (double t = gap(rng); t < static_cast<double>(durationUs); t += gap(rng))
+    {
+        SimRequest request;
+        request.arrivalUs = static_cast<int64_t>(t);
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+std::vector<SimRequest> loadArrivals(const std::string &filename)
+{
+    std::ifstream in(filename);
+    if (!in)
+        throw std::runtime_error("cannot open " + filename);
+    std::vector<SimRequest> requests;
+    std::string line;
+    int number = 0;
+    while (std::getline(in, line))
+    {
+        number++;
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        SimRequest request;
+        int high = 0;
+        if (!(fields >> request.arrivalUs >> request.serviceUs))
+            throw std::runtime_error(filename + ":" + std::to_string(number) + ": expected arrival_us,service_us[,high]");
+        fields >> high;
+        request.high = high != 0;
+        requests.push_back(request);
+    }
+    std::stable_sort(requests.begin(), requests.end(),
+                     [](const SimRequest &a, const SimRequest &b) { return a.arrivalUs < b.arrivalUs; });
+    return requests;
+}
+
+SimResult simulate(const SimConfig &config, const std::vector<SimRequest> &requests)
+{
+    auto errors = config.pool.validate();
+    if (!errors.empty())
+        throw ConfigError(std::move(errors));
+    auto wallStart = std::chrono::steady_clock::now();
+    SimResult result;
+    SimBackend backend{&config.backend, std::mt19937_64(config.backend.seed), 0, &result};
+    SimClock::set(SimClock::time_point());
+
+    SimObserver observer;
+    observer.result = &result;
+    SimPool pool(SimFactory{&backend}, observer);
+    const PoolConfig &pc = config.pool;
+    pool.sizing().set(pc.initSize, pc.maxSize, pc.reservedSize, pc.maxIdleTime);
+    pool.validation().set(pc.validateOnBorrow, pc.validationInterval, pc.validateOnReturn);
+    bool lifo = pc.idleOrder == PoolConfig::IdleOrder::LIFO;
+    pool.configure_queue([lifo](auto &queue) { queue.set_lifo(lifo); });
+    // Like start(): initSize connections before the first borrower
+    while (pool.reserve_growth())
+        pool.add(pool.factory().create());
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t seq = 0;
+    size_t pending = 0; // events other than EVICT, the run ends when none are left
+    auto schedule = [&](int64_t at, EventKind kind, size_t request = 0) {
+        events.push({at, seq++, kind, request});
+        if (kind != EventKind::EVICT)
+            pending++;
+    };
+    for (size_t i = 0; i < requests.size(); i++)
+        schedule(requests[i].arrivalUs, EventKind::ARRIVAL, i);
+    const int64_t idleTimeoutUs = std::chrono::duration_cast<std::chrono::microseconds>(pc.maxIdleTime).count();
+    const int64_t timeoutUs = std::chrono::duration_cast<std::chrono::microseconds>(pc.connectionTimeout).count();
+    schedule(idleTimeoutUs, EventKind::EVICT);
+
+    LocalHistogram acquireWait;
+    LocalHistogram response;
+    std::unordered_map<size_t, SimPool::lease> leases;
+    std::deque<size_t> waiters;
+    std::vector<bool> waiting(requests.size(), false);
+    bool creating = false; // one creation in flight, like the grower thread
+    int64_t now = 0;
+    double sizeArea = 0;
+    int size = pool.counters().total;
+    result.peakSize = size;
+
+    auto tryServe = [&](size_t i) {
+        backend.chargedUs = 0;
+        auto lease = pool.try_acquire(requests[i].high ? SimPool::priority::high : SimPool::priority::normal);
+        if (!lease)
+            return false;
+        int64_t ready = now + backend.chargedUs;
+        acquireWait.record(ready - requests[i].arrivalUs);
+        int64_t service = requests[i].serviceUs >= 0 ? requests[i].serviceUs
+                                                     : backend.sample(config.backend.queryLatency);
+        schedule(ready + service, EventKind::FINISH, i);
+        leases.emplace(i, std::move(lease));
+        result.served++;
+        return true;
+    };
+    // Waiting borrowers in arrival order; a normal one held back by the
+    // reservation does not block a high priority one behind it
+    auto serveWaiters = [&] {
+        std::deque<size_t> still;
+        for (size_t i : waiters)
+        {
+            if (!waiting[i])
+                continue;
+            if (pool.counters().idle > 0 && tryServe(i))
+                waiting[i] = false;
+            else
+                still.push_back(i);
+        }
+        waiters.swap(still);
+    };
+
+    while (!events.empty() && pending > 0)
+    {
+        Event event = events.top();
+        events.pop();
+        sizeArea += static_cast<double>(size) * static_cast<double>(event.at - now);
+        now = event.at;
+        SimClock::set(SimClock::time_point(SimClock::duration(now)));
+        if (event.kind != EventKind::EVICT)
+            pending--;
+
+        switch (event.kind)
+        {
+        case EventKind::ARRIVAL:
+            result.requests++;
+            if (!waiters.empty() || !tryServe(event.request))
+            {
+                waiting[event.request] = true;
+                waiters.push_back(event.request);
+                schedule(now + timeoutUs, EventKind::TIMEOUT, event.request);
+            }
+            break;
+        case EventKind::FINISH:
+            leases.erase(event.request); // returned to the pool
+            response.record(now - requests[event.request].arrivalUs);
+            serveWaiters();
+            break;
+        case EventKind::CONNECTED:
+            creating = false;
+            pool.add(pool.factory().create());
+            serveWaiters();
+            break;
+        case EventKind::TIMEOUT:
+            if (waiting[event.request])
+            {
+                waiting[event.request] = false;
+                result.timeouts++;
+            }
+            break;
+        case EventKind::EVICT:
+            pool.evict_idle();
+            schedule(now + idleTimeoutUs, EventKind::EVICT);
+            break;
+        }
+        if (!creating && pool.reserve_growth())
+        {
+            creating = true;
+            schedule(now + backend.sample(config.backend.connectLatency), EventKind::CONNECTED);
+        }
+        size = pool.counters().total;
+        result.peakSize = std::max(result.peakSize, size);
+    }
+
+    result.acquireWait = acquireWait.snapshot();
+    result.response = response.snapshot();
+    result.finalSize = size;
+    result.simulatedUs = now;
+    result.meanSize = now > 0 ? sizeArea / static_cast<double>(now) : size;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return result;
+}
@@ -0,0 +1,114 @@
+#include "QueryProfiler.h"
+#include "SqlFingerprint.h"
+#include "SteadyClock.hpp"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t clampU32(int64_t value)
+{
+    if (value < 0)
+        return 0;
+    return value > 0xffffffffLL ? 0xffffffffu : static_cast<uint32_t>(value);
+}
+
+// Times each next()
+class TimedResultSet : public ForwardingResultSet
+{
+public:
+    TimedResultSet(std::unique_ptr<ResultSet> rows, std::shared_ptr<QueryProfiler> profiler, QuerySpan span,
+                   bool streamed)
+        : ForwardingResultSet(std::move(rows)), _profiler(std::move(profiler)), _span(std::move(span)),
+          _streamed(streamed)
+    {
+    }
+
+    ~TimedResultSet() override
+    {
+        // Draining a streamed result is network time too
+        int64_t start = _streamed ? steadyUs() : 0;
+        _span.ok = !_rows->failed();
+        _rows.reset();
+        if (_streamed)
+            _readUs += steadyUs() - start;
+        uint32_t read = clampU32(_readUs);
+        if (_streamed)
+            _span.phases.networkUs += read;
+        else
+            _span.phases.decodeUs += read;
+        _span.rows = _read;
+        _profiler->record(_span);
+    }
+
+    bool next() override
+    {
+        int64_t start = steadyUs();
+        bool more = _rows->next();
+        _readUs += steadyUs() - start;
+        _read += more ? 1 : 0;
+        return more;
+    }
+
+private:
+    std::shared_ptr<QueryProfiler> _profiler;
+    QuerySpan _span;
+    bool _streamed;
+    int64_t _readUs = 0;
+    uint64_t _read = 0;
+};
+
+} // namespace
+
+bool QueryProfiler::sample() const
+{
+    int everyN = sampling();
+    if (everyN <= 0)
+        return false;
+    thread_local unsigned statements = 0;
+    return ++statements % static_cast<unsigned>(everyN) == 0;
+}
+
+void QueryProfiler::setCallback(Callback callback)
+{
+    std::atomic_store(&_callback, callback ? std::make_shared<const Callback>(std::move(callback))
+                                           : std::shared_ptr<const Callback>());
+}
+
+QueryPhases QueryProfiler::split(int64_t waitUs, int64_t roundTripUs, int64_t fetchUs, int64_t pingUs)
+{
+    QueryPhases phases;
+    fetchUs = std::min(std::max<int64_t>(fetchUs, 0), roundTripUs);
+    // The request and the first response packet cost one round trip
+    int64_t network = std::min(pingUs, roundTripUs - fetchUs) + fetchUs;
+    phases.waitUs = clampU32(waitUs);
+    phases.networkUs = clampU32(network);
+    phases.serverUs = clampU32(roundTripUs - network);
+    return phases;
+}
+
+void QueryProfiler::record(QuerySpan &span)
+{
+    QueryPhases &p = span.phases;
+    p.totalUs = clampU32(int64_t(p.waitUs) + p.networkUs + p.serverUs + p.decodeUs);
+    SqlFingerprint fp = fingerprintSql(span.sql);
+    span.fingerprint = fp.hash;
+    span.normalized = std::move(fp.normalized);
+
+    _table.update(span.fingerprint, span.normalized, [&p](FingerprintTiming &t) {
+        t.samples++;
+        t.waitUs += p.waitUs;
+        t.networkUs += p.networkUs;
+        t.serverUs += p.serverUs;
+        t.decodeUs += p.decodeUs;
+        t.totalUs += p.totalUs;
+        t.maxTotalUs = std::max<uint64_t>(t.maxTotalUs, p.totalUs);
+    });
+    if (auto callback = std::atomic_load(&_callback))
+        (*callback)(span);
+}
+
+std::unique_ptr<ResultSet> QueryProfiler::timeRows(std::unique_ptr<ResultSet> rows, QuerySpan span, bool streamed)
+{
+    return std::make_unique<TimedResultSet>(std::move(rows), shared_from_this(), std::move(span), streamed);
+}
@@ -0,0 +1,378 @@
+#include "QueryTrace.h"
+#include "Logger.hpp"
+#include "SqlFingerprint.h"
+#include "SteadyClock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr size_t kWindow = 4 << 20; // bytes mapped at a time, a multiple of the page size
+
+uint32_t clampU32(int64_t value)
+{
+    if (value < 0)
+        return 0;
+    return value > 0xffffffffLL ? 0xffffffffu : static_cast<uint32_t>(value);
+}
+
+uint32_t threadNumber()
+{
+    static std::atomic<uint32_t> next{0};
+    thread_local uint32_t number = ++next;
+    return number;
+}
+
+} // namespace
+
+QueryTrace::Ring::Ring(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1)
+{
+    for (size_t i = 0; i < capacity; i++)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+QueryTrace &QueryTrace::instance()
+{
+    static QueryTrace trace;
+    return trace;
+}
+
+// The logger is constructed first so it is still alive when stop() runs at exit
+QueryTrace::QueryTrace()
+{
+    AsyncLogger::instance();
+}
+
+QueryTrace::~QueryTrace()
+{
+    stop();
+}
+
+bool QueryTrace::start(const std::string &path, size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd >= 0)
+        return false;
+    size_t rounded = 1024;
+    while (rounded < capacity)
+        rounded <<= 1;
+    int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        WARN_LOG("Cannot create query trace {}: {}", path, std::strerror(errno));
+        return false;
+    }
+    _fd = fd;
+    _path = path;
+    _size = 0;
+    _window = nullptr;
+    _windowOffset = 0;
+    if (!remap(0))
+    {
+        ::close(_fd);
+        _fd = -1;
+        return false;
+    }
+
+    Ring *ring = _ring.load(std::memory_order_relaxed);
+    if (ring == nullptr || ring->mask + 1 != rounded)
+    {
+        _rings.push_back(std::make_unique<Ring>(rounded));
+        ring = _rings.back().get();
+    }
+    // Late records of a previous trace are discarded
+    TraceRecord stale;
+    while (pop(*ring, stale))
+    {
+    }
+    {
+        std::lock_guard<std::mutex> dictLock(_dictMutex);
+        _known.clear();
+        _pendingText.clear();
+    }
+    _epoch.fetch_add(1, std::memory_order_relaxed);
+    _recorded = 0;
+    _dropped = 0;
+
+    TraceHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.recordSize = sizeof(TraceRecord);
+    header.startEpochUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                    std::chrono::system_clock::now().time_since_epoch())
+                                                    .count());
+    write(&header, sizeof(header));
+    _startUs.store(steadyUs(), std::memory_order_relaxed);
+    _ring.store(ring, std::memory_order_release);
+    _stop = false;
+    _writer = std::thread(&QueryTrace::writerTask, this);
+    _enabled.store(true, std::memory_order_release);
+    INFO_LOG("Query trace started: {}", path);
+    return true;
+}
+
+void QueryTrace::stop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_fd < 0)
+        return;
+    _enabled.store(false, std::memory_order_relaxed);
+    _stop = true;
+    _cv.notify_all();
+    std::thread writer = std::move(_writer);
+    lock.unlock();
+    writer.join();
+    lock.lock();
+    // The writer drained once more after seeing _stop
+    if (_window != nullptr)
+        munmap(_window, kWindow);
+    _window = nullptr;
+    if (ftruncate(_fd, static_cast<off_t>(_size)) != 0)
+        WARN_LOG("Query trace {}: truncate failed: {}", _path, std::strerror(errno));
+    ::close(_fd);
+    _fd = -1;
+    INFO_LOG("Query trace stopped: {} ({} records, {} dropped)", _path, recorded(), dropped());
+}
+
+std::string QueryTrace::path() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _path;
+}
+
+uint64_t QueryTrace::sinceStart(int64_t at) const
+{
+    return static_cast<uint64_t>(std::max<int64_t>(0, at - _startUs.load(std::memory_order_relaxed)));
+}
+
+void QueryTrace::borrow(const void *conn, int64_t waitUs)
+{
+    if (!enabled())
+        return;
+    TraceRecord r{};
+    // Stamped with the time the borrower asked, that is the arrival to replay
+    r.timeUs = sinceStart(steadyUs() - waitUs);
+    r.connection = reinterpret_cast<uintptr_t>(conn);
+    r.durationUs = clampU32(waitUs);
+    r.kind = static_cast<uint8_t>(TraceKind::BORROW);
+    r.ok = 1;
+    push(r);
+}
+
+void QueryTrace::release(const void *conn, int64_t holdUs)
+{
+    if (!enabled())
+        return;
+    TraceRecord r{};
+    r.timeUs = sinceStart(steadyUs());
+    r.connection = reinterpret_cast<uintptr_t>(conn);
+    r.durationUs = clampU32(holdUs);
+    r.kind = static_cast<uint8_t>(TraceKind::RETURN);
+    r.ok = 1;
+    push(r);
+}
+
+void QueryTrace::statement(TraceKind kind, const void *conn, std::string_view sql, int64_t durationUs,
+                           uint64_t resultSize, bool ok)
+{
+    if (!enabled())
+        return;
+    SqlFingerprint fp = fingerprintSql(sql);
+    // The text of a fingerprint is written once per trace. Each thread remembers
+    // what it has already handed over so the shared set is only locked for new ones
+    thread_local uint64_t seenEpoch = 0;
+    thread_local std::unordered_set<uint64_t> seen;
+    uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+    if (seenEpoch != epoch)
+    {
+        seen.clear();
+        seenEpoch = epoch;
+    }
+    if (seen.insert(fp.hash).second)
+    {
+        std::lock_guard<std::mutex> lock(_dictMutex);
+        if (_known.insert(fp.hash).second)
+            _pendingText.emplace_back(fp.hash, std::move(fp.normalized));
+    }
+    TraceRecord r{};
+    r.timeUs = sinceStart(steadyUs() - durationUs);
+    r.connection = reinterpret_cast<uintptr_t>(conn);
+    r.fingerprint = fp.hash;
+    r.paramsHash = fp.paramsHash;
+    r.durationUs = clampU32(durationUs);
+    r.resultSize = static_cast<uint32_t>(std::min<uint64_t>(resultSize, 0xffffffffu));
+    r.kind = static_cast<uint8_t>(kind);
+    r.ok = ok ? 1 : 0;
+    push(r);
+}
+
+void QueryTrace::push(const TraceRecord &record)
+{
+    Ring *ring = _ring.load(std::memory_order_acquire);
+    size_t pos = ring->enqueue.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (ring->enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Full: the writer is behind, drop rather than block the caller
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = ring->enqueue.load(std::memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->record.thread = threadNumber();
+    cell->seq.store(pos + 1, std::memory_order_release);
+    _recorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool QueryTrace::pop(Ring &ring, TraceRecord &record)
+{
+    Cell &cell = ring.cells[ring.dequeue & ring.mask];
+    if (cell.seq.load(std::memory_order_acquire) != ring.dequeue + 1)
+        return false;
+    record = cell.record;
+    cell.seq.store(ring.dequeue + ring.mask + 1, std::memory_order_release);
+    ring.dequeue++;
+    return true;
+}
+
+void QueryTrace::writerTask()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop)
+    {
+        _cv.wait_for(lock, std::chrono::milliseconds(20), [this] { return _stop; });
+        drain();
+    }
+    drain();
+}
+
+// Under _mutex. Records are taken before the pending texts: a record is pushed
+// after its text was queued, so every text a drained record needs is written first
+void QueryTrace::drain()
+{
+    Ring *ring = _ring.load(std::memory_order_acquire);
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (records.size() <= ring->mask && pop(*ring, record))
+        records.push_back(record);
+    std::vector<std::pair<uint64_t, std::string>> texts;
+    {
+        std::lock_guard<std::mutex> dictLock(_dictMutex);
+        texts.swap(_pendingText);
+    }
+    for (const auto &text : texts)
+    {
+        TraceRecord dict{};
+        dict.fingerprint = text.first;
+        dict.resultSize = static_cast<uint32_t>(text.second.size());
+        dict.kind = static_cast<uint8_t>(TraceKind::DICT);
+        dict.ok = 1;
+        static const char padding[8] = {};
+        write(&dict, sizeof(dict));
+        write(text.second.data(), text.second.size());
+        write(padding, (8 - text.second.size() % 8) % 8);
+    }
+    if (!records.empty())
+        write(records.data(), records.size() * sizeof(TraceRecord));
+}
+
+// Appends through the mapped window, growing the file one window at a time.
+// After a crash the file ends in zeroed records, loadTrace stops at the first
+bool QueryTrace::write(const void *data, size_t size)
+{
+    const char *p = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        if (_size == _windowOffset + kWindow && !remap(_windowOffset + kWindow))
+            return false;
+        if (_window == nullptr)
+            return false;
+        size_t n = std::min(size, _windowOffset + kWindow - _size);
+        std::memcpy(_window + (_size - _windowOffset), p, n);
+        _size += n;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool QueryTrace::remap(size_t offset)
+{
+    if (_window != nullptr)
+        munmap(_window, kWindow);
+    _window = nullptr;
+    if (ftruncate(_fd, static_cast<off_t>(offset + kWindow)) != 0)
+    {
+        WARN_LOG("Query trace {}: cannot grow file: {}", _path, std::strerror(errno));
+        return false;
+    }
+    void *mem = mmap(nullptr, kWindow, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+    if (mem == MAP_FAILED)
+    {
+        WARN_LOG("Query trace {}: mmap failed: {}", _path, std::strerror(errno));
+        return false;
+    }
+    _window = static_cast<char *>(mem);
+    _windowOffset = offset;
+    return true;
+}
+
+TraceFile loadTrace(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("cannot open trace " + path);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    TraceFile file;
+    if (data.size() < sizeof(TraceHeader))
+        throw std::runtime_error(path + " is not a query trace");
+    std::memcpy(&file.header, data.data(), sizeof(TraceHeader));
+    if (std::memcmp(file.header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        file.header.recordSize != sizeof(TraceRecord))
+        throw std::runtime_error(path + " is not a query trace");
+    if (file.header.version != QueryTrace::kVersion)
+        throw std::runtime_error(path + ": unsupported trace version " + std::to_string(file.header.version));
+    size_t offset = sizeof(TraceHeader);
+    while (offset + sizeof(TraceRecord) <= data.size())
+    {
+        TraceRecord r;
+        std::memcpy(&r, data.data() + offset, sizeof(r));
+        offset += sizeof(r);
+        if (r.kind == 0)
+            break; // zeroed tail of a trace that was not stopped
+        if (r.kind == static_cast<uint8_t>(TraceKind::DICT))
+        {
+            if (offset + r.resultSize > data.size())
+                break;
+            file.text[r.fingerprint] = data.substr(offset, r.resultSize);
+            offset += (r.resultSize + 7) / 8 * 8;
+            continue;
+        }
+        file.records.push_back(r);
+    }
+    return file;
+}
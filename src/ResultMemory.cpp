@@ -0,0 +1,99 @@
+#include "ResultMemory.h"
+
+namespace {
+
+// Gives the memory back when destroyed
+class ChargedResultSet : public ForwardingResultSet
+{
+public:
+    ChargedResultSet(std::unique_ptr<ResultSet> rows, std::shared_ptr<ResultMemory> memory, uint64_t bytes)
+        : ForwardingResultSet(std::move(rows)), _memory(std::move(memory)), _bytes(bytes)
+    {
+    }
+
+    ~ChargedResultSet() override
+    {
+        _rows.reset();
+        _memory->release(_bytes);
+    }
+
+private:
+    std::shared_ptr<ResultMemory> _memory;
+    uint64_t _bytes;
+};
+
+} // namespace
+
+void ResultMemory::configure(uint64_t budget, Policy policy, std::chrono::milliseconds waitTimeout)
+{
+    _budget.store(budget, std::memory_order_relaxed);
+    _policy.store(policy, std::memory_order_relaxed);
+    _waitMs.store(waitTimeout.count(), std::memory_order_relaxed);
+    // A larger budget or another policy may let waiters go
+    std::lock_guard<std::mutex> lock(_mutex);
+    _released.notify_all();
+}
+
+ResultMemory::Admission ResultMemory::admit()
+{
+    bool waited = false;
+    std::chrono::steady_clock::time_point deadline;
+    for (;;)
+    {
+        if (available())
+            return Admission::BUFFERED;
+        switch (_policy.load(std::memory_order_relaxed))
+        {
+        case Policy::STREAM:
+            _streamed.fetch_add(1, std::memory_order_relaxed);
+            return Admission::STREAMED;
+        case Policy::FAIL:
+            _rejected.fetch_add(1, std::memory_order_relaxed);
+            return Admission::REJECTED;
+        case Policy::WAIT:
+            break;
+        }
+        // One wait per select, however often another one takes the memory first
+        if (!waited)
+        {
+            waited = true;
+            _waits.fetch_add(1, std::memory_order_relaxed);
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_waitMs.load(std::memory_order_relaxed));
+        }
+        bool ready;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _waiters.fetch_add(1);
+            ready = _released.wait_until(lock, deadline,
+                                         [this] { return available() || _policy.load() != Policy::WAIT; });
+            _waiters.fetch_sub(1);
+        }
+        if (!ready)
+        {
+            _rejected.fetch_add(1, std::memory_order_relaxed);
+            return Admission::REJECTED;
+        }
+        // Memory was released, or the policy changed and applies now
+    }
+}
+
+std::unique_ptr<ResultSet> ResultMemory::charge(std::unique_ptr<ResultSet> rows)
+{
+    // Sizing walks the rows, not worth it without a budget to hold them to
+    if (budget() == 0)
+        return rows;
+    uint64_t bytes = rows->memoryBytes();
+    _used.fetch_add(bytes, std::memory_order_relaxed);
+    return std::make_unique<ChargedResultSet>(std::move(rows), shared_from_this(), bytes);
+}
+
+void ResultMemory::release(uint64_t bytes)
+{
+    // Sequentially consistent with the waiter's count and check, see admit()
+    _used.fetch_sub(bytes);
+    if (_waiters.load() == 0)
+        return;
+    // Under the lock, so a waiter between its check and its sleep is not missed
+    std::lock_guard<std::mutex> lock(_mutex);
+    _released.notify_all();
+}
@@ -0,0 +1,100 @@
+#include "RowStream.h"
+
+#include <thread>
+
+RowStream::RowStream(std::unique_ptr<ResultSet> rows) : _rows(std::move(rows)), _fields(_rows->fieldCount())
+{
+}
+
+RowStream::Status RowStream::run(const Callback &onRow)
+{
+    std::thread reader(&RowStream::readTask, this);
+    auto stop = [&] {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled.store(true);
+        }
+        _freed.notify_one();
+        reader.join();
+    };
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _filled.wait(lock, [this] { return _written > _consumed || _done; });
+        if (_written == _consumed)
+            break;
+        // Published and not yet consumed: the reader leaves it alone
+        RowBatch &batch = _ring[_consumed % kBatches];
+        lock.unlock();
+        bool more = true;
+        try
+        {
+            for (size_t i = 0; i < batch.rows && more; i++)
+            {
+                more = onRow(StreamRow(batch, i, _fields));
+                _delivered++;
+            }
+        }
+        catch (...)
+        {
+            stop();
+            throw;
+        }
+        if (!more)
+        {
+            stop();
+            return Status::CANCELLED;
+        }
+        if (batch.data.capacity() > kBatchBytes * 2)
+            std::string().swap(batch.data); // an outsized row, don't keep its memory
+        lock.lock();
+        _consumed++;
+        _freed.notify_one();
+    }
+    bool failed = _failed;
+    lock.unlock();
+    reader.join();
+    return failed ? Status::FAILED : Status::FINISHED;
+}
+
+void RowStream::readTask()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _freed.wait(lock, [this] { return _written - _consumed < kBatches || _cancelled.load(); });
+        if (_cancelled.load())
+            break;
+        RowBatch &batch = _ring[_written % kBatches];
+        lock.unlock();
+        bool more = fill(batch);
+        lock.lock();
+        if (batch.rows > 0 && !_cancelled.load())
+        {
+            _written++;
+            _filled.notify_one();
+        }
+        if (!more)
+            break;
+    }
+    // A cancelled stream is drained here, before the caller gets the connection back
+    bool failed = !_cancelled.load() && _rows->failed();
+    _rows.reset();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _failed = failed;
+    _done = true;
+    _filled.notify_one();
+}
+
+bool RowStream::fill(RowBatch &batch)
+{
+    batch.clear();
+    while (batch.rows < kBatchRows && batch.data.size() < kBatchBytes)
+    {
+        if (_cancelled.load(std::memory_order_relaxed) || !_rows->next())
+            return false;
+        batch.append(*_rows, _fields);
+    }
+    return true;
+}
@@ -0,0 +1,210 @@
+#include "SlowQueryLog.h"
+#include "Connection.h"
+#include "SqlFingerprint.h"
+
+#include <fmt/format.h>
+
+SlowQueryLog::SlowQueryLog(std::string pool, Opener opener) : _pool(std::move(pool)), _opener(std::move(opener))
+{
+}
+
+SlowQueryLog::~SlowQueryLog()
+{
+    stop();
+}
+
+void SlowQueryLog::configure(std::chrono::microseconds threshold, int explainSampling, const std::string &path)
+{
+    _thresholdUs.store(threshold.count(), std::memory_order_relaxed);
+    _explainSampling.store(explainSampling, std::memory_order_relaxed);
+    std::shared_ptr<LogSink> previous;
+    {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        bool reopen = path != _path || (!_sink && threshold.count() > 0);
+        _path = path;
+        if (_customSink || !reopen)
+            return;
+        previous = std::move(_sink);
+        // The file is only created once the log is turned on
+        if (threshold.count() > 0 && !path.empty())
+        {
+            _sink = std::make_shared<RotatingFileSink>(path, kMaxFileSize);
+            _sink->start();
+        }
+    }
+    // Drained and closed outside the lock
+    previous.reset();
+}
+
+void SlowQueryLog::setSink(std::shared_ptr<LogSink> sink)
+{
+    std::shared_ptr<LogSink> previous;
+    {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        previous = std::move(_sink);
+        _customSink = sink != nullptr;
+        if (!sink && enabled() && !_path.empty())
+            sink = std::make_shared<RotatingFileSink>(_path, kMaxFileSize);
+        if (sink)
+            sink->start();
+        _sink = std::move(sink);
+    }
+    if (previous)
+        previous->stop();
+}
+
+void SlowQueryLog::record(SlowQuery query)
+{
+    Entry entry;
+    SqlFingerprint fp = fingerprintSql(query.sql);
+    entry.normalized = std::move(fp.normalized);
+    entry.fingerprint = fp.hash;
+    entry.query = std::move(query);
+
+    int everyN = _explainSampling.load(std::memory_order_relaxed);
+    bool sampled = everyN > 0 && _slowCount.fetch_add(1, std::memory_order_relaxed) % static_cast<uint64_t>(everyN) == 0;
+    if (sampled && _opener && explainable(entry.normalized))
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_stopping && _pending.size() < kMaxPendingExplains)
+        {
+            _pending.push_back(std::move(entry));
+            if (!_explainer.joinable())
+                _explainer = std::thread(&SlowQueryLog::explainTask, this);
+            _wake.notify_one();
+            return;
+        }
+    }
+    write(entry, "");
+}
+
+void SlowQueryLog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_explainer.joinable())
+        _explainer.join();
+}
+
+void SlowQueryLog::write(const Entry &entry, const std::string &plan)
+{
+    std::shared_ptr<LogSink> sink;
+    {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        sink = _sink;
+    }
+    if (!sink)
+        return;
+    const SlowQuery &q = entry.query;
+    const QueryPhases &p = q.phases;
+    std::string text = fmt::format("Slow query on pool {}, {:.3f}ms: wait {}us network {}us server {}us, {} rows{}, "
+                                   "connection {:#x}, fingerprint {:016x}",
+                                   _pool, (int64_t(p.waitUs) + p.networkUs + p.serverUs) / 1e3, p.waitUs,
+                                   p.networkUs, p.serverUs, q.rows, q.ok ? "" : ", failed", q.connection,
+                                   entry.fingerprint);
+    // Past LogChunkPool::kChunkSize the entry is cut short: the plan goes before
+    // the SQL text, so a long statement cuts off its own tail and the stack
+    if (!plan.empty())
+        text += "\n  plan: " + plan;
+    text += "\n  sql: " + q.sql;
+    if (q.site)
+    {
+        std::string stack = formatBorrowSite(*q.site);
+        if (!stack.empty() && stack.back() == '\n')
+            stack.pop_back();
+        text += "\n  at:\n" + stack;
+    }
+    LogEntry log{LogLevel::WARN, LogMessage(text.data(), text.size()), __FILE__, __LINE__,
+                 std::chrono::system_clock::time_point(std::chrono::microseconds(q.startEpochUs))};
+    if (sink->offer(log))
+        _logged.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SlowQueryLog::explainTask()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _wake.wait(lock, [this] { return !_pending.empty() || _stopping; });
+        if (_pending.empty())
+            break;
+        Entry entry = std::move(_pending.front());
+        _pending.pop_front();
+        bool stopping = _stopping;
+        lock.unlock();
+        // Stopping: log what is left without plans
+        std::string plan = stopping ? std::string() : explain(entry.query.sql);
+        if (!plan.empty())
+            _explained.fetch_add(1, std::memory_order_relaxed);
+        write(entry, plan);
+        lock.lock();
+    }
+    lock.unlock();
+    _explainConn.reset();
+}
+
+std::string SlowQueryLog::explain(const std::string &sql)
+{
+    if (!_explainConn)
+        _explainConn = _opener();
+    if (!_explainConn)
+        return "";
+    auto rows = _explainConn->select("EXPLAIN FORMAT=JSON " + sql);
+    if (!rows)
+    {
+        // Maybe the connection broke, open a new one next time
+        _explainConn.reset();
+        return "";
+    }
+    std::string plan;
+    if (rows->next() && rows->fieldCount() > 0 && rows->field(0) != nullptr)
+        plan = compactJson(std::string_view(rows->field(0), rows->fieldLength(0)));
+    while (rows->next())
+    {
+    }
+    return plan;
+}
+
+bool SlowQueryLog::explainable(std::string_view normalized)
+{
+    size_t start = normalized.find_first_not_of("( ");
+    if (start == std::string_view::npos)
+        return false;
+    std::string_view rest = normalized.substr(start);
+    size_t end = rest.find_first_of(" (");
+    std::string_view word = rest.substr(0, end);
+    for (const char *verb : {"select", "with", "table", "insert", "replace", "update", "delete"})
+    {
+        if (word == verb)
+            return true;
+    }
+    return false;
+}
+
+std::string SlowQueryLog::compactJson(std::string_view json)
+{
+    std::string out;
+    out.reserve(json.size());
+    bool quoted = false;
+    for (size_t i = 0; i < json.size(); i++)
+    {
+        char c = json[i];
+        if (quoted)
+        {
+            out.push_back(c);
+            if (c == '\\' && i + 1 < json.size())
+                out.push_back(json[++i]);
+            else if (c == '"')
+                quoted = false;
+            continue;
+        }
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            continue;
+        quoted = c == '"';
+        out.push_back(c);
+    }
+    return out;
+}
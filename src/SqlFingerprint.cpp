@@ -0,0 +1,157 @@
+#include "SqlFingerprint.h"
+
+namespace {
+
+bool isWordChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$' ||
+           static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Tokens that need a separating space: words, placeholders, quoted identifiers, '*'
+bool spaced(char c) { return isWordChar(c) || c == '?' || c == '`' || c == '*'; }
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+// Emit a placeholder, folding "?,?" into the previous one
+void placeholder(std::string &out)
+{
+    size_t n = out.size();
+    if (n >= 2 && out[n - 1] == ',' && out[n - 2] == '?')
+    {
+        out.pop_back();
+        return;
+    }
+    out.push_back('?');
+}
+
+} // namespace
+
+SqlFingerprint fingerprintSql(std::string_view sql)
+{
+    SqlFingerprint fp;
+    fingerprintSql(sql, fp);
+    return fp;
+}
+
+void fingerprintSql(std::string_view sql, SqlFingerprint &fp)
+{
+    std::string &out = fp.normalized;
+    out.clear();
+    out.reserve(sql.size());
+    uint64_t params = 0xcbf29ce484222325ull;
+    bool pendingSpace = false;
+    size_t i = 0;
+    const size_t n = sql.size();
+    // Whitespace only survives between two spaced tokens, so "a = 1" and "a=1" agree
+    auto emitSpace = [&](char next) {
+        if (pendingSpace && !out.empty() && (spaced(out.back()) || out.back() == ')') && spaced(next))
+            out.push_back(' ');
+        pendingSpace = false;
+    };
+    while (i < n)
+    {
+        char c = sql[i];
+        if (isSpace(c))
+        {
+            pendingSpace = true;
+            i++;
+            continue;
+        }
+        // Comments: -- to end of line, # to end of line, /* */
+        if ((c == '-' && i + 1 < n && sql[i + 1] == '-') || c == '#')
+        {
+            while (i < n && sql[i] != '\n')
+                i++;
+            pendingSpace = true;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && sql[i + 1] == '*')
+        {
+            i += 2;
+            while (i + 1 < n && !(sql[i] == '*' && sql[i + 1] == '/'))
+                i++;
+            i = i + 2 <= n ? i + 2 : n;
+            pendingSpace = true;
+            continue;
+        }
+        // String literal, backslash escapes and doubled quotes
+        if (c == '\'' || c == '"')
+        {
+            size_t start = ++i;
+            while (i < n)
+            {
+                if (sql[i] == '\\' && i + 1 < n)
+                    i += 2;
+                else if (sql[i] == c && i + 1 < n && sql[i + 1] == c)
+                    i += 2;
+                else if (sql[i] == c)
+                    break;
+                else
+                    i++;
+            }
+            params = fnv1a(sql.substr(start, i - start), params ^ 0x27);
+            i = i < n ? i + 1 : n;
+            emitSpace('?');
+            placeholder(out);
+            continue;
+        }
+        // Quoted identifier, copied as is
+        if (c == '`')
+        {
+            size_t start = i++;
+            while (i < n && sql[i] != '`')
+                i++;
+            i = i < n ? i + 1 : n;
+            emitSpace('`');
+            out.append(sql.substr(start, i - start));
+            continue;
+        }
+        // Number: not part of a word (t1, x2y), optional sign when it follows an operator
+        bool afterWord = !out.empty() && isWordChar(out.back()) && !pendingSpace;
+        bool sign = (c == '-' || c == '+') && i + 1 < n && (isDigit(sql[i + 1]) || sql[i + 1] == '.') &&
+                    (out.empty() || (!isWordChar(out.back()) && out.back() != ')' && out.back() != '?' && out.back() != '`'));
+        if (!afterWord && (isDigit(c) || sign || (c == '.' && i + 1 < n && isDigit(sql[i + 1]))))
+        {
+            size_t start = i;
+            if (sign)
+                i++;
+            if (i + 1 < n && sql[i] == '0' && (sql[i + 1] == 'x' || sql[i + 1] == 'X'))
+                i += 2;
+            while (i < n && (isWordChar(sql[i]) || sql[i] == '.' ||
+                             ((sql[i] == '-' || sql[i] == '+') && (sql[i - 1] == 'e' || sql[i - 1] == 'E'))))
+                i++;
+            params = fnv1a(sql.substr(start, i - start), params ^ 0x23);
+            emitSpace('?');
+            placeholder(out);
+            continue;
+        }
+        if (isWordChar(c))
+        {
+            emitSpace(c);
+            while (i < n && isWordChar(sql[i]))
+            {
+                char w = sql[i++];
+                out.push_back(w >= 'A' && w <= 'Z' ? static_cast<char>(w - 'A' + 'a') : w);
+            }
+            continue;
+        }
+        // Punctuation and operators
+        emitSpace(c);
+        i++;
+        // Multi-row VALUES: "(?),(?)" -> "(?)", the ')' is already there
+        size_t m = out.size();
+        if (c == ')' && m >= 5 && out.compare(m - 5, 5, "?),(?") == 0)
+        {
+            out.resize(m - 3);
+            continue;
+        }
+        out.push_back(c);
+    }
+    while (!out.empty() && (out.back() == ' ' || out.back() == ';'))
+        out.pop_back();
+    fp.hash = fnv1a(out);
+    fp.paramsHash = params;
+}
@@ -0,0 +1,78 @@
+#include "StatementStats.h"
+#include "SqlFingerprint.h"
+#include "SteadyClock.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Counts what the caller reads
+class CountedResultSet : public ForwardingResultSet
+{
+public:
+    CountedResultSet(std::unique_ptr<ResultSet> rows, std::shared_ptr<StatementStats> stats, std::string sql,
+                     int64_t latencyUs, bool streamed)
+        : ForwardingResultSet(std::move(rows)), _stats(std::move(stats)), _sql(std::move(sql)),
+          _latencyUs(latencyUs), _streamed(streamed)
+    {
+    }
+
+    ~CountedResultSet() override
+    {
+        // Draining a streamed result is part of the statement
+        int64_t start = _streamed ? steadyUs() : 0;
+        bool ok = !_rows->failed();
+        _rows.reset();
+        if (_streamed)
+            _latencyUs += steadyUs() - start;
+        _stats->record(_sql, _latencyUs, _read, _bytes + _sql.size(), ok);
+    }
+
+    bool next() override
+    {
+        int64_t start = _streamed ? steadyUs() : 0;
+        bool more = _rows->next();
+        if (_streamed)
+            _latencyUs += steadyUs() - start;
+        if (more)
+        {
+            _read++;
+            for (unsigned int i = 0, n = _rows->fieldCount(); i < n; i++)
+                _bytes += _rows->fieldLength(i);
+        }
+        return more;
+    }
+
+private:
+    std::shared_ptr<StatementStats> _stats;
+    std::string _sql;
+    int64_t _latencyUs;
+    bool _streamed;
+    uint64_t _read = 0;
+    uint64_t _bytes = 0;
+};
+
+} // namespace
+
+void StatementStats::record(std::string_view sql, int64_t latencyUs, uint64_t rows, uint64_t bytes, bool ok)
+{
+    // Reused per thread, the normalized text is only copied for a new shape
+    thread_local SqlFingerprint fp;
+    fingerprintSql(sql, fp);
+    uint64_t us = latencyUs > 0 ? static_cast<uint64_t>(latencyUs) : 0;
+    _table.update(fp.hash, fp.normalized, [&](StatementStat &s) {
+        s.calls++;
+        s.errors += ok ? 0 : 1;
+        s.rows += rows;
+        s.bytes += bytes;
+        s.totalUs += us;
+        s.maxUs = std::max(s.maxUs, us);
+    });
+}
+
+std::unique_ptr<ResultSet> StatementStats::countRows(std::unique_ptr<ResultSet> rows, std::string sql,
+                                                     int64_t latencyUs, bool streamed)
+{
+    return std::make_unique<CountedResultSet>(std::move(rows), shared_from_this(), std::move(sql), latencyUs,
+                                               streamed);
+}
@@ -0,0 +1,92 @@
+/*
+* @Description: Admin endpoint routing and HTTP handling, no database needed
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "AdminServer.h"
+
+using namespace std::chrono;
+
+namespace {
+int connectTo(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+std::string request(const std::string& path, const std::string& raw) {
+    int fd = connectTo(path);
+    if (fd < 0) return "";
+    send(fd, raw.data(), raw.size(), 0);
+    std::string out;
+    char buffer[512];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) out.append(buffer, static_cast<size_t>(n));
+    close(fd);
+    return out;
+}
+}
+
+TEST(AdminServerTest, Routing) {
+    AdminServer server("unix:admin_test.sock");
+    EXPECT_EQ(server.handle("GET", "/metrics").status, 200);
+    EXPECT_EQ(server.handle("GET", "/pool").body, "{\"pools\":[]}\n");
+    EXPECT_EQ(server.handle("POST", "/metrics").status, 405);
+    EXPECT_EQ(server.handle("GET", "/pool/drain").status, 405);
+    EXPECT_EQ(server.handle("POST", "/pool/drain?pool=missing").status, 404);
+    EXPECT_EQ(server.handle("GET", "/unknown").status, 404);
+}
+
+TEST(AdminServerTest, ServesOverUnixSocket) {
+    AdminServer server("unix:admin_test.sock");
+    ASSERT_TRUE(server.start());
+    struct stat st;
+    ASSERT_EQ(stat("admin_test.sock", &st), 0);
+    EXPECT_EQ(st.st_mode & 0777, 0660u);
+    std::string reply = request("admin_test.sock", "GET /pool HTTP/1.1\r\nHost: x\r\n\r\n");
+    EXPECT_EQ(reply.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << reply;
+    EXPECT_NE(reply.find("Content-Length: 13\r\n"), std::string::npos) << reply;
+    reply = request("admin_test.sock", "garbage\r\n\r\n");
+    EXPECT_EQ(reply.rfind("HTTP/1.1 400", 0), 0u) << reply;
+    server.stop();
+    EXPECT_NE(access("admin_test.sock", F_OK), 0);
+}
+
+TEST(AdminServerTest, SlowClientIsCutOffAtTheDeadline) {
+    AdminServer server("unix:admin_test.sock");
+    ASSERT_TRUE(server.start());
+    int fd = connectTo("admin_test.sock");
+    ASSERT_GE(fd, 0);
+    // One byte every 200ms keeps each read short, the request as a whole is not
+    auto start = steady_clock::now();
+    char c = 'G';
+    while (send(fd, &c, 1, MSG_NOSIGNAL) == 1 && steady_clock::now() - start < seconds(5))
+        std::this_thread::sleep_for(milliseconds(200));
+    EXPECT_LT(steady_clock::now() - start, seconds(3));
+    close(fd);
+    server.stop();
+}
+
+TEST(AdminServerTest, RejectsNonLoopbackAddress) {
+    AdminServer server("0.0.0.0:19100");
+    EXPECT_FALSE(server.start());
+}
@@ -0,0 +1,199 @@
+/*
+* @Description: AsyncLogger producer latency and throughput benchmarks
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Run with JSON output to keep a history:
+*   ./async_logger_bench --benchmark_out=async_logger_bench.json --benchmark_out_format=json
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Logger.hpp"
+
+namespace {
+
+enum SinkKind { kFileSink, kRotatingSink, kConsoleSink, kSyslogSink, kRingSink };
+enum OverflowPolicy { kDrop, kBlock };
+
+const char* kBenchLog = "bench_logger.log";
+
+const char* sinkName(int kind) {
+    switch (kind) {
+        case kFileSink: return "file";
+        case kRotatingSink: return "rotating";
+        case kConsoleSink: return "console";
+        case kSyslogSink: return "syslog";
+        case kRingSink: return "ring";
+        default: return "unknown";
+    }
+}
+
+// Console output goes to /dev/null so the benchmark report stays readable
+std::ofstream g_devnull("/dev/null");
+std::streambuf* g_stdout = nullptr;
+
+// One sink per run, no default sinks, so each number isolates one sink
+void setupLogger(int sink, int policy, size_t rotateSize) {
+    AsyncLogger& logger = AsyncLogger::instance();
+    logger.init(kBenchLog, rotateSize, 4096, policy == kDrop, false);
+    logger.clear_sinks();
+    switch (sink) {
+        case kFileSink:
+            logger.add_sink(std::make_shared<FileSink>(kBenchLog, LogLevel::DEBUG, 4096));
+            break;
+        case kRotatingSink:
+            logger.add_sink(std::make_shared<RotatingFileSink>(kBenchLog, rotateSize, LogLevel::DEBUG, 4096));
+            break;
+        case kConsoleSink:
+            g_stdout = std::cout.rdbuf(g_devnull.rdbuf());
+            logger.add_sink(std::make_shared<ConsoleSink>(LogLevel::DEBUG, 4096));
+            break;
+        case kSyslogSink:
+            logger.add_sink(std::make_shared<SyslogSink>("async_logger_bench", "/dev/log", LogLevel::DEBUG, 4096));
+            break;
+        case kRingSink:
+            logger.add_sink(std::make_shared<RingSink>(4096, LogLevel::DEBUG, 4096));
+            break;
+    }
+}
+
+void teardownLogger() {
+    AsyncLogger::instance().shutdown();
+    if (g_stdout != nullptr) {
+        std::cout.rdbuf(g_stdout);
+        g_stdout = nullptr;
+    }
+    std::remove(kBenchLog);
+}
+
+// Producer latency samples of every thread of one run, see BM_ProducerLatency
+struct MergedSamples {
+    std::mutex mutex;
+    std::vector<int64_t> samples;
+    int threadsDone = 0;
+};
+MergedSamples g_latency;
+
+void SetupMatrix(const benchmark::State& state) {
+    {
+        std::lock_guard<std::mutex> lock(g_latency.mutex);
+        g_latency.samples.clear();
+        g_latency.threadsDone = 0;
+    }
+    setupLogger(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), 1024 * 1024 * 1024);
+}
+
+void TeardownMatrix(const benchmark::State&) { teardownLogger(); }
+
+double percentile(std::vector<int64_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return static_cast<double>(samples[idx]);
+}
+
+}  // namespace
+
+/**
+ * Producer side cost of one INFO_LOG call, per sink and overflow policy.
+ * p50/p99/p999 are over the samples of all threads merged, the last thread
+ * to finish reports them
+ */
+static void BM_ProducerLatency(benchmark::State& state) {
+    std::vector<int64_t> samples;
+    // About 4M samples per run whatever the thread count
+    samples.reserve((1 << 22) / state.threads());
+    int64_t i = 0;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        INFO_LOG("benchmark message {} from thread {}", i++, state.thread_index());
+        auto end = std::chrono::steady_clock::now();
+        if (samples.size() < samples.capacity()) {
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(sinkName(static_cast<int>(state.range(0)))) +
+                   (state.range(1) == kDrop ? "/drop" : "/block"));
+
+    std::lock_guard<std::mutex> lock(g_latency.mutex);
+    g_latency.samples.insert(g_latency.samples.end(), samples.begin(), samples.end());
+    if (++g_latency.threadsDone < state.threads()) return;
+    // Per thread counters are summed, only this thread sets these
+    state.counters["p50_ns"] = percentile(g_latency.samples, 0.50);
+    state.counters["p99_ns"] = percentile(g_latency.samples, 0.99);
+    state.counters["p999_ns"] = percentile(g_latency.samples, 0.999);
+}
+
+/**
+ * Sustained rate: the run includes draining every sink, so with the block
+ * policy this is what the sink can really absorb. With drop, dropped counts
+ * the producer queue losses
+ */
+static void BM_SustainedThroughput(benchmark::State& state) {
+    uint64_t droppedBefore = AsyncLogger::instance().dropped();
+    int64_t i = 0;
+    for (auto _ : state) {
+        INFO_LOG("benchmark message {} from thread {}", i++, state.thread_index());
+    }
+    if (state.thread_index() == 0) {
+        AsyncLogger::instance().flush();
+        state.counters["dropped"] = static_cast<double>(AsyncLogger::instance().dropped() - droppedBefore);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(sinkName(static_cast<int>(state.range(0)))) +
+                   (state.range(1) == kDrop ? "/drop" : "/block"));
+}
+
+static void MatrixArgs(benchmark::internal::Benchmark* b) {
+    for (int sink : {kFileSink, kRotatingSink, kConsoleSink, kSyslogSink, kRingSink}) {
+        for (int policy : {kDrop, kBlock}) {
+            b->Args({sink, policy});
+        }
+    }
+}
+
+BENCHMARK(BM_ProducerLatency)->Apply(MatrixArgs)->ThreadRange(1, 64)->UseRealTime()
+    ->Setup(SetupMatrix)->Teardown(TeardownMatrix);
+BENCHMARK(BM_SustainedThroughput)->Apply(MatrixArgs)->ThreadRange(1, 64)->UseRealTime()
+    ->Setup(SetupMatrix)->Teardown(TeardownMatrix);
+
+/**
+ * Cost of rotation: same blocking file workload with rotate size as argument,
+ * compare against the 1GB (never rotates) run
+ */
+static void BM_RotationCost(benchmark::State& state) {
+    int64_t i = 0;
+    for (auto _ : state) {
+        INFO_LOG("rotation benchmark message {} with some padding to fill the file faster", i++);
+    }
+    AsyncLogger::instance().flush();
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void SetupRotation(const benchmark::State& state) {
+    setupLogger(kRotatingSink, kBlock, static_cast<size_t>(state.range(0)));
+}
+
+static void TeardownRotation(const benchmark::State&) {
+    teardownLogger();
+    // Rotated files are named <log>.<unix time>
+    std::system((std::string("rm -f ") + kBenchLog + ".*").c_str());
+}
+
+BENCHMARK(BM_RotationCost)->Arg(64 * 1024)->Arg(1024 * 1024)->Arg(1024 * 1024 * 1024)
+    ->UseRealTime()->Setup(SetupRotation)->Teardown(TeardownRotation);
+
+BENCHMARK_MAIN();
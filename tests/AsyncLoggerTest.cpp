@@ -2,183 +2,230 @@
 * @Description: Test Logger Base Implement
 * @Author: abellli
 * @Date: 2025-09-15
-* @LastEditTime: 2025-09-15
+* @LastEditTime: 2026-10-17
 */
 
 
-#include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
 #include <chrono>
 #include <atomic>
-#include <fmt/core.h>
+#include <memory>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
 #include "Logger.hpp"
 
 /**
- * @class AsyncLoggerTest
- * Test class for verifying AsyncLogger functionality
+ * Every test writes its log files and the flight recorder dump that FATAL_LOG
+ * triggers under the gtest temp dir, and removes them again. The logger
+ * singleton is shut down after each test, init() starts it again
  */
-class AsyncLoggerTest {
-public:
-    /**
-     * Run all test cases
-     */
-    static void runAllTests() {
-        std::cout << "Starting AsyncLogger tests...\n";
-        
-        testBasicLogging();
-        testLogLevelFiltering();
-        testMultiThreadedLogging();
-        testQueueFullBehavior();
-        testFileRotation();
-        testConsoleOutputToggle();
-        
-        std::cout << "All tests completed successfully!\n";
+class AsyncLoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _dumpPath = ::testing::TempDir() + "async_logger_test_flight_recorder.bin";
+        FlightRecorder::instance().set_dump_path(_dumpPath);
     }
 
-private:
-    /**
-     * Test basic logging functionality with different levels
-     */
-    static void testBasicLogging() {
-        std::cout << "Testing basic logging...\n";
-        
-        // Initialize logger with specific test file
-        AsyncLogger::instance().init("test_basic.log", 1 * 1024 * 1024, 100, true, false);
-        
-        // Log messages at different levels
-        DEBUG_LOG("This is a DEBUG message - should be visible if LOG_LEVEL is DEBUG");
-        INFO_LOG("This is an INFO message");
-        WARN_LOG("This is a WARN message");
-        ERROR_LOG("This is an ERROR message");
-        FATAL_LOG("This is a FATAL message");
-        
-        // Allow time for logs to be processed
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        
-        std::cout << "Basic logging test completed.\n";
+    void TearDown() override {
+        AsyncLogger::instance().shutdown();
+        FlightRecorder::instance().set_dump_path("flight_recorder.bin");
+        std::remove(_dumpPath.c_str());
+        // Rotated files are named <log>.<unix time>
+        for (const auto& log : _logs) {
+            std::filesystem::path path(log);
+            std::error_code ec;
+            for (const auto& file : std::filesystem::directory_iterator(path.parent_path(), ec)) {
+                std::string name = file.path().filename().string();
+                if (name.rfind(path.filename().string(), 0) == 0) std::filesystem::remove(file.path(), ec);
+            }
+        }
     }
 
-    /**
-     * @brief Test log level filtering functionality
-     */
-    static void testLogLevelFiltering() {
-        std::cout << "Testing log level filtering...\n";
-        
-        // Note: This test assumes LOG_LEVEL is set to INFO by default
-        // Messages below INFO level should be filtered out
-        DEBUG_LOG("This DEBUG message should be filtered out (not appear in log)");
-        INFO_LOG("This INFO message should appear");
-        WARN_LOG("This WARN message should appear");
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        std::cout << "Log level filtering test completed.\n";
+    // Path of a log file under the temp dir, removed by TearDown
+    std::string logFile(const std::string& name) {
+        _logs.push_back(::testing::TempDir() + name);
+        return _logs.back();
     }
 
-    /**
-     * @brief Test logging from multiple concurrent threads
-     */
-    static void testMultiThreadedLogging() {
-        std::cout << "Testing multi-threaded logging...\n";
-        
-        constexpr int num_threads = 5;
-        constexpr int messages_per_thread = 10;
-        std::vector<std::thread> threads;
-        std::atomic<int> messages_logged{0};
-        
-        AsyncLogger::instance().init("test_threaded.log", 2 * 1024 * 1024, 500, true, false);
-        
-        for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([i, &messages_logged]() {
-                for (int j = 0; j < messages_per_thread; ++j) {
-                    INFO_LOG("Thread " << i << " message " << j);
-                    messages_logged++;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
-            });
-        }
-        
-        for (auto& thread : threads) {
-            thread.join();
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Allow final logs to process
-        std::cout << "Multi-threaded test completed. Logged " << messages_logged << " messages.\n";
+    std::string _dumpPath;
+    std::vector<std::string> _logs;
+};
+
+/**
+ * Test basic logging functionality with different levels
+ */
+TEST_F(AsyncLoggerTest, BasicLogging) {
+    // Initialize logger with specific test file
+    AsyncLogger::instance().init(logFile("test_basic.log"), 1 * 1024 * 1024, 100, true, false);
+
+    // Log messages at different levels
+    DEBUG_LOG("This is a DEBUG message - should be visible if LOG_LEVEL is DEBUG");
+    INFO_LOG("This is an INFO message");
+    WARN_LOG("This is a WARN message");
+    ERROR_LOG("This is an ERROR message");
+    FATAL_LOG("This is a FATAL message");
+
+    // Allow time for logs to be processed
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+/**
+ * @brief Test log level filtering functionality
+ */
+TEST_F(AsyncLoggerTest, LogLevelFiltering) {
+    AsyncLogger::instance().init(logFile("test_filtering.log"), 1 * 1024 * 1024, 100, true, false);
+
+    // Note: This test assumes LOG_LEVEL is set to INFO by default
+    // Messages below INFO level should be filtered out
+    DEBUG_LOG("This DEBUG message should be filtered out (not appear in log)");
+    INFO_LOG("This INFO message should appear");
+    WARN_LOG("This WARN message should appear");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+/**
+ * @brief Test logging from multiple concurrent threads
+ */
+TEST_F(AsyncLoggerTest, MultiThreadedLogging) {
+    constexpr int num_threads = 5;
+    constexpr int messages_per_thread = 10;
+    std::vector<std::thread> threads;
+    std::atomic<int> messages_logged{0};
+
+    AsyncLogger::instance().init(logFile("test_threaded.log"), 2 * 1024 * 1024, 500, true, false);
+
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([i, &messages_logged]() {
+            for (int j = 0; j < messages_per_thread; ++j) {
+                INFO_LOG("Thread {} message {}", i, j);
+                messages_logged++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
     }
 
-    /**
-     * @brief Test behavior when log queue becomes full
-     */
-    static void testQueueFullBehavior() {
-        std::cout << "Testing queue full behavior...\n";
-        
-        // Initialize with very small queue to trigger full condition quickly
-        AsyncLogger::instance().init("test_queue_full.log", 1 * 1024 * 1024, 10, true, false);
-        
-        // Rapidly log many messages to fill the queue
-        for (int i = 0; i < 20; ++i) {
-            INFO_LOG("Filling queue with message " << i);
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        std::cout << "Queue full test completed. Check for drop warnings in console.\n";
+    for (auto& thread : threads) {
+        thread.join();
     }
 
-    /**
-     * @brief Test file rotation functionality
-     */
-    static void testFileRotation() {
-        std::cout << "Testing file rotation...\n";
-        
-        // Initialize with very small size to trigger rotation quickly
-        AsyncLogger::instance().init("test_rotation.log", 100, 50, true, false);
-        
-        // Log enough messages to trigger file rotation
-        for (int i = 0; i < 30; ++i) {
-            INFO_LOG("This is message " << i << " designed to trigger file rotation when accumulated");
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        std::cout << "File rotation test completed.\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Allow final logs to process
+    EXPECT_EQ(messages_logged, num_threads * messages_per_thread);
+}
+
+/**
+ * @brief Test behavior when log queue becomes full
+ */
+TEST_F(AsyncLoggerTest, QueueFullBehavior) {
+    // Initialize with very small queue to trigger full condition quickly
+    AsyncLogger::instance().init(logFile("test_queue_full.log"), 1 * 1024 * 1024, 10, true, false);
+
+    // Rapidly log many messages to fill the queue
+    for (int i = 0; i < 20; ++i) {
+        INFO_LOG("Filling queue with message {}", i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
-    /**
-     * @brief Test console output enable/disable functionality
-     */
-    static void testConsoleOutputToggle() {
-        std::cout << "Testing console output toggle...\n";
-        
-        AsyncLogger::instance().init("test_console.log", 1 * 1024 * 1024, 50, true, true);
-        
-        INFO_LOG("This message should appear in console (console output enabled)");
-        
-        AsyncLogger::instance().enable_console_output(false);
-        INFO_LOG("This message should NOT appear in console (console output disabled)");
-        
-        AsyncLogger::instance().enable_console_output(true);
-        INFO_LOG("This message should appear again in console (console output re-enabled)");
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        std::cout << "Console output toggle test completed.\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
+
+/**
+ * @brief A FATAL dropped by a full queue still dumps the flight recorder
+ */
+TEST_F(AsyncLoggerTest, FatalDumpsRecorderWhenQueueIsFull) {
+    AsyncLogger::instance().init(logFile("test_fatal_full.log"), 1 * 1024 * 1024, 2, true, false);
+    // Without the dispatch thread nothing leaves the queue
+    AsyncLogger::instance().shutdown();
+    INFO_LOG("Filling queue with message {}", 0);
+    INFO_LOG("Filling queue with message {}", 1);
+    uint64_t dropped = AsyncLogger::instance().dropped();
+    std::remove(_dumpPath.c_str());
+
+    FATAL_LOG("Fatal message logged into a full queue");
+    EXPECT_EQ(AsyncLogger::instance().dropped(), dropped + 1);
+    std::ifstream dump(_dumpPath, std::ios::binary | std::ios::ate);
+    ASSERT_TRUE(dump.is_open());
+    EXPECT_EQ(static_cast<size_t>(dump.tellg()), FlightRecorder::kRegionSize);
+}
+
+/**
+ * @brief Test file rotation functionality
+ */
+TEST_F(AsyncLoggerTest, FileRotation) {
+    // Initialize with very small size to trigger rotation quickly
+    AsyncLogger::instance().init(logFile("test_rotation.log"), 100, 50, true, false);
+
+    // Log enough messages to trigger file rotation
+    for (int i = 0; i < 30; ++i) {
+        INFO_LOG("This is message {} designed to trigger file rotation when accumulated", i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
-};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
 
 /**
- * Main function to run all tests
+ * @brief Test console output enable/disable functionality
  */
-int main() {
-    try {
-        AsyncLoggerTest::runAllTests();
-        
-        // Properly shutdown the logger after all tests
-        AsyncLogger::instance().shutdown();
-    } catch (const std::exception& e) {
-        std::cerr << "Test failed with exception: " << e.what() << std::endl;
-        return 1;
+TEST_F(AsyncLoggerTest, ConsoleOutputToggle) {
+    AsyncLogger::instance().init(logFile("test_console.log"), 1 * 1024 * 1024, 50, true, true);
+
+    INFO_LOG("This message should appear in console (console output enabled)");
+
+    AsyncLogger::instance().enable_console_output(false);
+    INFO_LOG("This message should NOT appear in console (console output disabled)");
+
+    AsyncLogger::instance().enable_console_output(true);
+    INFO_LOG("This message should appear again in console (console output re-enabled)");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+/**
+ * @brief A sink stuck on io must only drop its own output
+ */
+TEST_F(AsyncLoggerTest, SlowSinkIsolation) {
+    class SlowSink : public LogSink {
+    public:
+        SlowSink() : LogSink(LogLevel::DEBUG, 8, 1) {}
+        ~SlowSink() override { stop(); }
+    protected:
+        void write_batch(const std::vector<LogEntry>&) override {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    };
+
+    AsyncLogger::instance().init(logFile("test_sinks.log"), 1 * 1024 * 1024, 200, false, false);
+    auto slow = std::make_shared<SlowSink>();
+    auto ring = std::make_shared<RingSink>(100);
+    AsyncLogger::instance().add_sink(slow);
+    AsyncLogger::instance().add_sink(ring);
+
+    for (int i = 0; i < 100; ++i) {
+        INFO_LOG("Sink isolation message {}", i);
     }
-    
-    return 0;
-}
\ No newline at end of file
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(ring->snapshot().size(), 100u);
+    EXPECT_GT(slow->dropped(), 0u);
+}
+
+/**
+ * @brief A ring asked for no lines keeps the last one
+ */
+TEST_F(AsyncLoggerTest, EmptyRingKeepsOneLine) {
+    AsyncLogger::instance().init(logFile("test_ring.log"), 1 * 1024 * 1024, 100, true, false);
+    auto ring = std::make_shared<RingSink>(0);
+    EXPECT_TRUE(ring->snapshot().empty());
+    AsyncLogger::instance().add_sink(ring);
+    INFO_LOG("Ring message {}", 1);
+    INFO_LOG("Ring message {}", 2);
+    AsyncLogger::instance().flush();
+    auto lines = ring->snapshot();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("Ring message 2"), std::string::npos);
+}
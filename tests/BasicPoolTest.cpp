@@ -0,0 +1,259 @@
+/*
+* @Description: Policy based basic_pool with a trivial resource
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BasicPool.hpp"
+
+using namespace std::chrono;
+
+namespace {
+struct Widget {
+    int id;
+    bool healthy = true;
+    int generation = 0;
+};
+
+struct WidgetFactory {
+    std::shared_ptr<std::atomic<int>> created = std::make_shared<std::atomic<int>>(0);
+    std::shared_ptr<std::atomic<int>> generation = std::make_shared<std::atomic<int>>(0);
+    std::shared_ptr<std::atomic<bool>> throws = std::make_shared<std::atomic<bool>>(false);
+    std::function<void()> validating; // called from validate()
+    bool repairs = true;
+
+    std::unique_ptr<Widget> create() {
+        if (*throws) throw std::runtime_error("create failed");
+        return std::make_unique<Widget>(Widget{(*created)++, true, generation->load()});
+    }
+    bool validate(Widget& w) {
+        if (validating) validating();
+        return w.healthy;
+    }
+    bool repair(Widget& w) {
+        w.healthy = repairs;
+        return repairs;
+    }
+    bool reusable(const Widget& w) const { return w.generation == generation->load(); }
+};
+
+struct CountingObserver : pool_policy::no_observer {
+    std::shared_ptr<std::atomic<int>> destructions = std::make_shared<std::atomic<int>>(0);
+    void destroyed(Widget&, pool_policy::destroy_reason) { (*destructions)++; }
+};
+
+template <typename Pool>
+void size(Pool& pool, int minSize, int maxSize, int reserved = 0) {
+    pool.sizing().set(minSize, maxSize, reserved, seconds(60));
+}
+}
+
+TEST(BasicPoolTest, FifoHandsOutLongestIdle) {
+    basic_pool<Widget, WidgetFactory, pool_policy::fifo> pool;
+    size(pool, 3, 3);
+    pool.start();
+    auto a = pool.acquire(decltype(pool)::priority::normal, milliseconds(100));
+    EXPECT_EQ(a->id, 0);
+    int first = a->id;
+    a.reset();
+    auto b = pool.acquire(decltype(pool)::priority::normal, milliseconds(100));
+    EXPECT_NE(b->id, first);
+}
+
+TEST(BasicPoolTest, LifoHandsOutMostRecentlyReturned) {
+    basic_pool<Widget, WidgetFactory, pool_policy::lifo> pool;
+    size(pool, 3, 3);
+    pool.start();
+    auto a = pool.acquire(decltype(pool)::priority::normal, milliseconds(100));
+    int first = a->id;
+    a.reset();
+    for (int i = 0; i < 5; i++) {
+        auto b = pool.acquire(decltype(pool)::priority::normal, milliseconds(100));
+        EXPECT_EQ(b->id, first);
+    }
+}
+
+TEST(BasicPoolTest, SelectableOrderSwitchesAtRuntime) {
+    using Pool = basic_pool<Widget, WidgetFactory, pool_policy::selectable_order>;
+    Pool pool;
+    size(pool, 3, 3);
+    pool.start();
+    auto a = pool.acquire(Pool::priority::normal, milliseconds(100));
+    int first = a->id;
+    a.reset();
+    EXPECT_NE(pool.acquire(Pool::priority::normal, milliseconds(100))->id, first);
+    pool.configure_queue([](auto& queue) { queue.set_lifo(true); });
+    a = pool.acquire(Pool::priority::normal, milliseconds(100));
+    first = a->id;
+    a.reset();
+    EXPECT_EQ(pool.acquire(Pool::priority::normal, milliseconds(100))->id, first);
+}
+
+TEST(BasicPoolTest, TimesOutAndFailFastNeverWaits) {
+    basic_pool<Widget, WidgetFactory, pool_policy::static_sizing<1, 1>> blocking;
+    blocking.start();
+    auto held = blocking.acquire(decltype(blocking)::priority::normal, milliseconds(100));
+    auto start = steady_clock::now();
+    EXPECT_THROW(blocking.acquire(decltype(blocking)::priority::normal, milliseconds(50)), std::runtime_error);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(50));
+    EXPECT_FALSE(blocking.try_acquire());
+
+    basic_pool<Widget, WidgetFactory, pool_policy::static_sizing<1, 1>, pool_policy::fail_fast> failFast;
+    failFast.start();
+    auto lease = failFast.acquire(decltype(failFast)::priority::normal, seconds(10));
+    start = steady_clock::now();
+    EXPECT_THROW(failFast.acquire(decltype(failFast)::priority::normal, seconds(10)), std::runtime_error);
+    EXPECT_LT(steady_clock::now() - start, seconds(1));
+}
+
+TEST(BasicPoolTest, ReservedForHighPriority) {
+    using Pool = basic_pool<Widget, WidgetFactory>;
+    Pool pool;
+    size(pool, 2, 2, 1);
+    pool.start();
+    auto a = pool.acquire(Pool::priority::normal, milliseconds(100));
+    EXPECT_THROW(pool.acquire(Pool::priority::normal, milliseconds(20)), std::runtime_error);
+    auto b = pool.acquire(Pool::priority::high, milliseconds(100));
+    EXPECT_EQ(pool.counters().inUse, 2);
+}
+
+TEST(BasicPoolTest, BrokenResourcesAreRepairedOrReplaced) {
+    using Pool = basic_pool<Widget, WidgetFactory, pool_policy::validate_on_borrow, CountingObserver>;
+    Pool pool;
+    size(pool, 1, 1);
+    pool.start();
+    {
+        auto a = pool.acquire(Pool::priority::normal, milliseconds(100));
+        a->healthy = false;
+    }
+    auto b = pool.acquire(Pool::priority::normal, milliseconds(100));
+    EXPECT_TRUE(b->healthy);
+    EXPECT_EQ(*pool.observer().destructions, 0);
+    b->healthy = false;
+    b.reset();
+
+    // Repair fails: destroyed, the grower opens a replacement
+    pool.factory().repairs = false;
+    auto c = pool.acquire(Pool::priority::normal, milliseconds(500));
+    EXPECT_TRUE(c->healthy);
+    EXPECT_EQ(*pool.observer().destructions, 1);
+    EXPECT_EQ(*pool.factory().created, 2);
+}
+
+TEST(BasicPoolTest, StaleResourcesAreDrainedOnReturn) {
+    using Pool = basic_pool<Widget, WidgetFactory, CountingObserver>;
+    Pool pool;
+    size(pool, 2, 2);
+    pool.start();
+    auto a = pool.acquire(Pool::priority::normal, milliseconds(100));
+    (*pool.factory().generation)++;
+    a.reset();
+    EXPECT_EQ(*pool.observer().destructions, 1);
+    pool.evict_idle();
+    EXPECT_EQ(*pool.observer().destructions, 2);
+    pool.grow_one();
+    pool.grow_one();
+    auto b = pool.acquire(Pool::priority::normal, milliseconds(500));
+    EXPECT_EQ(b->generation, 1);
+}
+
+TEST(BasicPoolTest, ThrowingCreateGivesTheSlotBack) {
+    using Pool = basic_pool<Widget, WidgetFactory>;
+    Pool pool;
+    size(pool, 1, 1);
+    *pool.factory().throws = true;
+    pool.start();
+    EXPECT_THROW(pool.acquire(Pool::priority::normal, milliseconds(50)), std::runtime_error);
+    // A slot kept by a failed create would leave no room for this one
+    *pool.factory().throws = false;
+    auto lease = pool.acquire(Pool::priority::normal, milliseconds(500));
+    EXPECT_EQ(pool.counters().total, 1);
+}
+
+TEST(BasicPoolTest, ThrowingValidateCountsAsBroken) {
+    using Pool = basic_pool<Widget, WidgetFactory, pool_policy::validate_on_borrow, CountingObserver>;
+    Pool pool;
+    size(pool, 1, 1);
+    pool.start();
+    pool.factory().repairs = false;
+    bool thrown = false;
+    pool.factory().validating = [&] {
+        if (thrown) return;
+        thrown = true;
+        throw std::runtime_error("validate failed");
+    };
+    // Destroyed and replaced; a slot kept by the thrown check would leave no room
+    auto lease = pool.acquire(Pool::priority::normal, milliseconds(500));
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(*pool.observer().destructions, 1);
+    EXPECT_EQ(pool.counters().total, 1);
+    EXPECT_EQ(pool.counters().inUse, 1);
+}
+
+TEST(BasicPoolTest, ScanValidationRunsOutsideThePoolLock) {
+    using Pool = basic_pool<Widget, WidgetFactory, pool_policy::validate_on_borrow>;
+    Pool pool;
+    size(pool, 2, 2);
+    pool.start();
+    std::atomic<bool> borrowed{false};
+    bool borrowedWhileChecking = false;
+    std::thread borrower;
+    pool.factory().validating = [&] {
+        if (borrower.joinable()) return;
+        borrower = std::thread([&] {
+            pool.try_acquire(); // both are being checked, nothing to take
+            borrowed = true;
+        });
+        for (int i = 0; i < 1000 && !borrowed; i++) std::this_thread::sleep_for(milliseconds(1));
+        borrowedWhileChecking = borrowed;
+    };
+    pool.evict_idle();
+    borrower.join();
+    EXPECT_TRUE(borrowedWhileChecking);
+    EXPECT_EQ(pool.counters().idle, 2);
+}
+
+TEST(BasicPoolTest, LeaseOutlivesPool) {
+    using Pool = basic_pool<Widget, WidgetFactory>;
+    auto pool = std::make_unique<Pool>();
+    size(*pool, 1, 1);
+    pool->start();
+    auto lease = pool->acquire(Pool::priority::normal, milliseconds(100));
+    pool.reset();
+    lease.reset(); // deleted, not returned
+}
+
+TEST(BasicPoolTest, ConcurrentBorrowersNeverExceedMax) {
+    using Pool = basic_pool<Widget, WidgetFactory>;
+    Pool pool;
+    size(pool, 0, 4);
+    pool.start();
+    std::atomic<int> inUse{0};
+    std::atomic<int> peak{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 200; i++) {
+                auto lease = pool.acquire(Pool::priority::normal, seconds(5));
+                int now = ++inUse;
+                int seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+                --inUse;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_LE(peak.load(), 4);
+    EXPECT_LE(*pool.factory().created, 4);
+    EXPECT_EQ(pool.counters().inUse, 0);
+}
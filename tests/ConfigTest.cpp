@@ -0,0 +1,117 @@
+/*
+* @Description: PoolConfig parsing, environment overrides and validation
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Config.h"
+
+namespace {
+std::string writeConfig(const std::string& name, const std::string& content) {
+    std::ofstream(name) << content;
+    return name;
+}
+}
+
+TEST(PoolConfigTest, ParsesUnitsAndDefaults) {
+    auto file = writeConfig("test_units.ini",
+        "ip=10.0.0.1\nport=3307\ninitSize=2\nmaxSize=8\n"
+        "maxIdleTime=2m\nconnectionTimeOut=3s\nvalidationInterval=250ms\nidleOrder=lifo\n"
+        "resultMemoryBudget=64M\nresultMemoryPolicy=Stream\n");
+    PoolConfig config = PoolConfig::load(file);
+    EXPECT_EQ(config.ip, "10.0.0.1");
+    EXPECT_EQ(config.port, 3307);
+    EXPECT_EQ(config.maxIdleTime, std::chrono::seconds(120));
+    EXPECT_EQ(config.connectionTimeout, std::chrono::milliseconds(3000));
+    EXPECT_EQ(config.validationInterval, std::chrono::milliseconds(250));
+    EXPECT_EQ(config.idleOrder, PoolConfig::IdleOrder::LIFO);
+    EXPECT_EQ(config.resultMemoryBudget, 64u * 1024 * 1024);
+    EXPECT_EQ(config.resultMemoryPolicy, PoolConfig::ResultMemoryPolicy::STREAM);
+    EXPECT_EQ(config.dbname, "test");
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, BareNumbersUseFieldUnit) {
+    auto file = writeConfig("test_bare.ini", "maxIdleTime=30\nconnectionTimeOut=100\n");
+    PoolConfig config = PoolConfig::load(file);
+    EXPECT_EQ(config.maxIdleTime, std::chrono::seconds(30));
+    EXPECT_EQ(config.connectionTimeout, std::chrono::milliseconds(100));
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, EnvironmentOverridesFile) {
+    auto file = writeConfig("test_env.ini", "maxSize=8\npassword=fromfile\n");
+    setenv("CONNECTION_POOL_MAX_SIZE", "32", 1);
+    setenv("CONNECTION_POOL_PASSWORD", "fromenv", 1);
+    PoolConfig config = PoolConfig::load(file);
+    unsetenv("CONNECTION_POOL_MAX_SIZE");
+    unsetenv("CONNECTION_POOL_PASSWORD");
+    EXPECT_EQ(config.maxSize, 32);
+    EXPECT_EQ(config.password, "fromenv");
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, ReportsEveryError) {
+    auto file = writeConfig("test_bad.ini",
+        "maxSize=abc\nconnectionTimeOutt=100\nmaxIdleTime=5parsecs\nport=70000\n");
+    try {
+        PoolConfig::load(file);
+        FAIL() << "expected ConfigError";
+    } catch (const ConfigError& e) {
+        EXPECT_EQ(e.errors().size(), 4u) << e.what();
+    }
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, RejectsImplausibleTimeouts) {
+    // 100us wait: the old microsecond interpretation of connectionTimeOut=100
+    auto file = writeConfig("test_range.ini",
+        "connectionTimeOut=100us\ninitSize=20\nmaxSize=10\nreservedSize=10\n");
+    try {
+        PoolConfig::load(file);
+        FAIL() << "expected ConfigError";
+    } catch (const ConfigError& e) {
+        EXPECT_EQ(e.errors().size(), 3u) << e.what();
+    }
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, RejectsRepeatedKeysAndNegativeDurations) {
+    auto file = writeConfig("test_repeat.ini",
+        "maxSize=8\nmaxSize=16\nconnectionTimeOut=1s\nmaxConnectionTimeOut=2s\nleakDetectionThreshold=-5s\n");
+    try {
+        PoolConfig::load(file);
+        FAIL() << "expected ConfigError";
+    } catch (const ConfigError& e) {
+        // maxSize twice, connectionTimeOut through its old name, the negative threshold
+        EXPECT_EQ(e.errors().size(), 3u) << e.what();
+    }
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, RejectsIntegersThatWouldWrap) {
+    // 2^32 + 1 wraps to a valid maxSize of 1 when narrowed to int
+    auto file = writeConfig("test_wrap.ini", "maxSize=4294967297\nleakStackSampling=-9999999999\n");
+    try {
+        PoolConfig::load(file);
+        FAIL() << "expected ConfigError";
+    } catch (const ConfigError& e) {
+        ASSERT_EQ(e.errors().size(), 2u) << e.what();
+        EXPECT_NE(std::string(e.what()).find("maxSize: out of range"), std::string::npos) << e.what();
+    }
+    std::remove(file.c_str());
+}
+
+TEST(PoolConfigTest, AcceptsLegacyKeyAndShippedConfig) {
+    auto file = writeConfig("test_legacy.ini", "maxConnectionTimeOut=2s\n");
+    EXPECT_EQ(PoolConfig::load(file).connectionTimeout, std::chrono::milliseconds(2000));
+    std::remove(file.c_str());
+    EXPECT_NO_THROW(PoolConfig::load(CONFIG_SAMPLE));
+}
@@ -0,0 +1,149 @@
+/*
+* @Description: Pool running against the in-process fake driver
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+
+using namespace std::chrono;
+
+namespace {
+PoolConfig fakeConfig(int initSize, int maxSize) {
+    PoolConfig config;
+    config.name = "fake";
+    config.driver = "fake";
+    config.initSize = initSize;
+    config.maxSize = maxSize;
+    config.connectionTimeout = milliseconds(200);
+    config.validationInterval = milliseconds(0); // ping on every borrow
+    return config;
+}
+
+FakeDriverOptions fastOptions() {
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    options.pingLatency = LatencyDistribution::fixed(microseconds(0));
+    return options;
+}
+}
+
+TEST(LatencyDistributionTest, SamplesMatchParameters) {
+    std::mt19937_64 rng(1);
+    auto uniform = LatencyDistribution::uniform(microseconds(100), microseconds(200));
+    auto exponential = LatencyDistribution::exponential(microseconds(500));
+    double sum = 0;
+    for (int i = 0; i < 20000; i++) {
+        auto u = uniform.sample(rng);
+        ASSERT_GE(u.count(), 100);
+        ASSERT_LE(u.count(), 200);
+        sum += static_cast<double>(exponential.sample(rng).count());
+    }
+    EXPECT_NEAR(sum / 20000, 500, 25);
+    EXPECT_EQ(LatencyDistribution::fixed(microseconds(7)).sample(rng).count(), 7);
+}
+
+TEST(FakeDriverTest, PoolRunsQueries) {
+    auto driver = std::make_shared<FakeDriver>(fastOptions());
+    auto pool = connection_pool::create(fakeConfig(2, 4), driver);
+    {
+        auto conn = pool->getconnection();
+        EXPECT_STREQ(conn->driverName(), "fake");
+        EXPECT_TRUE(conn->update("UPDATE t SET a = 1"));
+        auto rows = conn->select("SELECT 1");
+        ASSERT_TRUE(rows);
+        ASSERT_TRUE(rows->next());
+        EXPECT_STREQ(rows->field(0), "1");
+        EXPECT_FALSE(rows->next());
+        EXPECT_EQ(conn->query("SELECT 1"), nullptr); // MYSQL_RES only exists for mysql
+    }
+    EXPECT_EQ(driver->statements(), 2u);
+    EXPECT_EQ(driver->openConnections(), pool->counters().total);
+}
+
+TEST(FakeDriverTest, SuppliedDriverWinsOverConfigDriver) {
+    PoolConfig config = fakeConfig(1, 2);
+    config.driver = PoolConfig().driver; // left at "mysql"
+    auto driver = std::make_shared<FakeDriver>(fastOptions());
+    auto pool = connection_pool::create(config, driver);
+    auto conn = pool->getconnection();
+    EXPECT_STREQ(conn->driverName(), "fake");
+    EXPECT_EQ(driver->openConnections(), pool->counters().total);
+}
+
+TEST(FakeDriverTest, ServerLimitRejectsConnections) {
+    auto options = fastOptions();
+    options.maxConnections = 2;
+    auto driver = std::make_shared<FakeDriver>(options);
+    auto pool = connection_pool::create(fakeConfig(4, 4), driver);
+    EXPECT_EQ(driver->openConnections(), 2);
+    EXPECT_EQ(pool->metrics().creationFailures, 2u);
+}
+
+TEST(FakeDriverTest, KilledSessionsAreReconnectedOnBorrow) {
+    auto driver = std::make_shared<FakeDriver>(fastOptions());
+    auto pool = connection_pool::create(fakeConfig(2, 2), driver);
+    driver->killConnections();
+    EXPECT_EQ(driver->openConnections(), 2); // noticed lazily, like a real client
+    {
+        auto conn = pool->getconnection();
+        EXPECT_TRUE(conn->update("SELECT 1"));
+    }
+    auto m = pool->metrics();
+    EXPECT_EQ(m.validationFailures, 1u);
+    EXPECT_EQ(m.reconnects, 1u);
+    EXPECT_EQ(m.reconnectFailures, 0u);
+}
+
+TEST(FakeDriverTest, InjectedQueryFailures) {
+    auto options = fastOptions();
+    options.queryFailureRate = 0.25;
+    auto driver = std::make_shared<FakeDriver>(options);
+    auto pool = connection_pool::create(fakeConfig(1, 1), driver);
+    auto conn = pool->getconnection();
+    int failed = 0;
+    for (int i = 0; i < 4000; i++) failed += conn->update("UPDATE t SET a = 1") ? 0 : 1;
+    EXPECT_NEAR(failed, 1000, 150);
+}
+
+TEST(FakeDriverTest, FailedStatementWithBracesIsLogged) {
+    auto options = fastOptions();
+    options.queryFailureRate = 1;
+    auto pool = connection_pool::create(fakeConfig(1, 1), std::make_shared<FakeDriver>(options));
+    auto conn = pool->getconnection();
+    // The SQL is a log argument, not part of the format string
+    const std::string sql = "SELECT id FROM t WHERE doc = '{\"a\": {}}'";
+    EXPECT_NO_THROW(EXPECT_EQ(conn->select(sql), nullptr));
+    EXPECT_NO_THROW(EXPECT_FALSE(conn->update("UPDATE t SET doc = '{}'")));
+}
+
+TEST(FakeDriverTest, ConcurrentBorrowersShareTheLimit) {
+    auto options = fastOptions();
+    options.queryLatency = LatencyDistribution::fixed(microseconds(200));
+    auto driver = std::make_shared<FakeDriver>(options);
+    auto config = fakeConfig(2, 4);
+    config.connectionTimeout = seconds(5);
+    auto pool = connection_pool::create(config, driver);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50; i++) {
+                auto conn = pool->getconnection();
+                conn->update("UPDATE t SET a = 1");
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(driver->statements(), 400u);
+    EXPECT_LE(driver->openConnections(), 4);
+    EXPECT_EQ(pool->metrics().acquires, 400u);
+}
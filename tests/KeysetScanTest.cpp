@@ -0,0 +1,215 @@
+/*
+* @Description: Keyset pagination scan: chunk statements, leases between chunks, prefetch and adaptive chunk size
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "KeysetScan.h"
+
+using namespace std::chrono;
+
+namespace {
+
+// Table of ids 1..rows answered from the statement, usPerRow of server time per row
+FakeRows serveChunk(const std::string& sql, int rows, int usPerRow) {
+    int after = 0;
+    size_t gt = sql.find("> '");
+    if (gt != std::string::npos)
+        after = std::stoi(sql.substr(gt + 3));
+    int limit = std::stoi(sql.substr(sql.find("LIMIT ") + 6));
+    FakeRows out;
+    for (int id = after + 1; id <= rows && static_cast<int>(out.size()) < limit; id++)
+        out.push_back({std::to_string(id), "v" + std::to_string(id)});
+    std::this_thread::sleep_for(microseconds(usPerRow * static_cast<int>(out.size())));
+    return out;
+}
+
+std::shared_ptr<connection_pool> fakePool(int rows, int usPerRow = 0) {
+    PoolConfig config;
+    config.name = "scan";
+    config.driver = "fake";
+    config.initSize = 2;
+    config.maxSize = 2;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    options.handler = [rows, usPerRow](const std::string& sql) { return serveChunk(sql, rows, usPerRow); };
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+// One row whose key is NULL, which FakeRows cannot express
+class NullKeyRows : public ResultSet {
+public:
+    bool next() override { return _left-- > 0; }
+    unsigned int fieldCount() const override { return 2; }
+    const char* field(unsigned int index) const override { return index == 0 ? nullptr : "v"; }
+    unsigned long fieldLength(unsigned int index) const override { return index == 0 ? 0 : 1; }
+
+private:
+    int _left = 1;
+};
+
+class NullKeySession : public DriverConnection {
+public:
+    void setConnectTimeout(unsigned int) override {}
+    bool connect(const std::string&, unsigned short, const std::string&, const std::string&,
+                 const std::string&) override { return true; }
+    void close() override {}
+    bool ping() override { return true; }
+    bool execute(const std::string&, uint64_t& affectedRows) override {
+        affectedRows = 0;
+        return true;
+    }
+    std::unique_ptr<ResultSet> query(const std::string&, bool) override { return std::make_unique<NullKeyRows>(); }
+    std::string error() const override { return ""; }
+};
+
+class NullKeyDriver : public Driver {
+public:
+    const char* name() const override { return "nullkey"; }
+    std::unique_ptr<DriverConnection> open() override { return std::make_unique<NullKeySession>(); }
+};
+
+KeysetScanOptions scanOptions() {
+    KeysetScanOptions options;
+    options.table = "shop.orders";
+    options.keyColumns = {"id"};
+    options.columns = "note";
+    options.chunkSize = 100;
+    return options;
+}
+
+// Every id from first to rows once and in order
+void expectScan(KeysetScan& scan, int first, int rows) {
+    int expected = first;
+    while (scan.next()) {
+        for (size_t i = 0; i < scan.size(); i++, expected++) {
+            ASSERT_EQ(std::string(scan.row(i).field(0)), std::to_string(expected));
+            ASSERT_EQ(std::string(scan.row(i).field(1)), "v" + std::to_string(expected));
+        }
+    }
+    EXPECT_FALSE(scan.failed());
+    EXPECT_EQ(expected, rows + 1);
+    EXPECT_EQ(scan.rowsRead(), static_cast<uint64_t>(rows));
+}
+
+} // namespace
+
+TEST(KeysetScanTest, BuildsKeysetStatements) {
+    auto pool = fakePool(0);
+    KeysetScanOptions options = scanOptions();
+    KeysetScan single(pool, options);
+    EXPECT_EQ(single.chunkSql({}, 100), "SELECT `id`,note FROM `shop`.`orders` ORDER BY `id` LIMIT 100");
+    EXPECT_EQ(single.chunkSql({"'42'"}, 100),
+              "SELECT `id`,note FROM `shop`.`orders` WHERE `id` > '42' ORDER BY `id` LIMIT 100");
+
+    options.keyColumns = {"tenant", "id"};
+    options.where = "status = 'open'";
+    KeysetScan composite(pool, options);
+    auto conn = pool->getconnection();
+    EXPECT_EQ(composite.chunkSql({conn->quote("o'neil\\"), conn->quote("7")}, 50),
+              "SELECT `tenant`,`id`,note FROM `shop`.`orders` WHERE (status = 'open') AND (`tenant`,`id`) > "
+              "('o''neil\\\\','7') ORDER BY `tenant`,`id` LIMIT 50");
+
+    options.keyColumns.clear();
+    EXPECT_THROW(KeysetScan(pool, options), std::invalid_argument);
+}
+
+TEST(KeysetScanTest, ReturnsTheConnectionBetweenChunks) {
+    auto pool = fakePool(1050);
+    KeysetScan scan(pool, scanOptions());
+    int expected = 1;
+    while (scan.next()) {
+        EXPECT_EQ(pool->counters().inUse, 0);
+        for (size_t i = 0; i < scan.size(); i++, expected++)
+            ASSERT_EQ(std::string(scan.row(i).field(0)), std::to_string(expected));
+    }
+    EXPECT_EQ(expected, 1051);
+    EXPECT_EQ(scan.chunks(), 11u); // the short last chunk ends the scan, no empty one after it
+    EXPECT_FALSE(scan.next());
+}
+
+TEST(KeysetScanTest, PrefetchesOnASecondConnection) {
+    auto pool = fakePool(1000, 100); // 10ms a chunk
+    KeysetScanOptions options = scanOptions();
+    options.prefetch = true;
+    KeysetScan scan(pool, options);
+    ASSERT_TRUE(scan.next());
+    std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(pool->counters().inUse, 1); // the next chunk is on its way
+    expectScan(scan, 101, 1000);
+}
+
+TEST(KeysetScanTest, PrefetchTimeoutReachesTheCaller) {
+    PoolConfig config;
+    config.name = "scan";
+    config.driver = "fake";
+    config.initSize = 2;
+    config.maxSize = 2;
+    config.connectionTimeout = milliseconds(100);
+    connection_pool* raw = nullptr;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    options.handler = [&raw](const std::string& sql) {
+        // Once the first chunk is read, its connection is the last one normal borrowers may take
+        if (sql.find("> ") == std::string::npos) raw->setReservedSize(1);
+        return serveChunk(sql, 1000, 0);
+    };
+    auto pool = connection_pool::create(config, std::make_shared<FakeDriver>(options));
+    raw = pool.get();
+    auto lease = pool->getconnection(); // the caller keeps one connection throughout
+    KeysetScanOptions scanning = scanOptions();
+    scanning.prefetch = true;
+    KeysetScan scan(pool, scanning);
+    ASSERT_TRUE(scan.next());
+    EXPECT_THROW(scan.next(), std::runtime_error); // from the prefetch thread, not terminate()
+    EXPECT_TRUE(scan.failed());
+    EXPECT_FALSE(scan.next());
+}
+
+TEST(KeysetScanTest, StopsOnANullKey) {
+    PoolConfig config;
+    config.name = "scan";
+    config.initSize = 1;
+    config.maxSize = 1;
+    auto pool = connection_pool::create(config, std::make_shared<NullKeyDriver>());
+    KeysetScan scan(pool, scanOptions());
+    EXPECT_FALSE(scan.next());
+    EXPECT_TRUE(scan.failed());
+}
+
+TEST(KeysetScanTest, AdaptsChunkSizeToTargetLatency) {
+    auto pool = fakePool(100000, 10); // 10us a row
+    KeysetScanOptions options = scanOptions();
+    options.targetChunkLatency = milliseconds(20);
+    KeysetScan scan(pool, options);
+    for (int i = 0; i < 10 && scan.next(); i++) {}
+    // About 2000 rows take 20ms, sleeps only run long
+    EXPECT_GT(scan.chunkSize(), 800u);
+    EXPECT_LE(scan.chunkSize(), 2400u);
+}
+
+TEST(KeysetScanTest, StopsOnAFailedChunk) {
+    PoolConfig config;
+    config.name = "scan";
+    config.driver = "fake";
+    config.initSize = 1;
+    config.maxSize = 1;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryFailureRate = 1;
+    auto pool = connection_pool::create(config, std::make_shared<FakeDriver>(options));
+    KeysetScan scan(pool, scanOptions());
+    EXPECT_FALSE(scan.next());
+    EXPECT_TRUE(scan.failed());
+}
@@ -0,0 +1,115 @@
+/*
+* @Description: Connection leak reports, sampled borrow stacks and forced reclaim
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+
+using namespace std::chrono;
+
+namespace {
+
+std::shared_ptr<connection_pool> fakePool(int size, milliseconds threshold, milliseconds reclaim) {
+    PoolConfig config;
+    config.name = "leaks";
+    config.driver = "fake";
+    config.initSize = size;
+    config.maxSize = size;
+    config.connectionTimeout = milliseconds(50);
+    config.leakDetectionThreshold = threshold;
+    config.leakStackSampling = 1;
+    config.leakReclaimTimeout = reclaim;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+template <typename F>
+bool eventually(F done) {
+    for (int i = 0; i < 200 && !done(); i++) std::this_thread::sleep_for(milliseconds(10));
+    return done();
+}
+
+} // namespace
+
+TEST(LeakDetectorTest, ReportsLongLeases) {
+    auto pool = fakePool(2, milliseconds(50), milliseconds(0));
+    { auto shortLease = pool->getconnection(); }
+    auto leaked = pool->getconnection();
+    EXPECT_TRUE(pool->leaks().empty());
+    std::this_thread::sleep_for(milliseconds(80));
+
+    auto leaks = pool->leaks();
+    ASSERT_EQ(leaks.size(), 1u);
+    EXPECT_EQ(leaks[0].connection, reinterpret_cast<uintptr_t>(leaked.get()));
+    EXPECT_EQ(leaks[0].thread, currentThreadId());
+    EXPECT_GE(leaks[0].heldMs, 50);
+    EXPECT_FALSE(leaks[0].stack.empty());
+    // Logged and counted once per lease, not on every scan
+    ASSERT_TRUE(eventually([&] { return pool->metrics().leaksDetected == 1; }));
+    std::this_thread::sleep_for(milliseconds(500));
+    EXPECT_EQ(pool->metrics().leaksDetected, 1u);
+    EXPECT_EQ(pool->metrics().leaksReclaimed, 0u);
+
+    leaked.reset();
+    EXPECT_TRUE(pool->leaks().empty());
+}
+
+TEST(LeakDetectorTest, BorrowSiteIsSymbolizedOnce) {
+    auto site = captureBorrowSite(7, 0);
+    ASSERT_FALSE(site->frames.empty());
+    const std::string& first = formatBorrowSite(*site);
+    EXPECT_FALSE(first.empty());
+    EXPECT_EQ(&formatBorrowSite(*site), &first);
+}
+
+TEST(LeakDetectorTest, UnsampledBorrowHasNoStack) {
+    auto pool = fakePool(1, milliseconds(20), milliseconds(0));
+    pool->updateConfig([](PoolConfig& c) { c.leakStackSampling = 0; });
+    auto leaked = pool->getconnection();
+    std::this_thread::sleep_for(milliseconds(40));
+    auto leaks = pool->leaks();
+    ASSERT_EQ(leaks.size(), 1u);
+    EXPECT_TRUE(leaks[0].stack.empty());
+}
+
+TEST(LeakDetectorTest, ReclaimGivesTheSlotBack) {
+    auto pool = fakePool(1, milliseconds(50), milliseconds(100));
+    auto leaked = pool->getconnection();
+    EXPECT_THROW(pool->getconnection(), std::runtime_error);
+
+    ASSERT_TRUE(eventually([&] { return pool->metrics().leaksReclaimed == 1; }));
+    // A replacement is opened while the leaked lease is still alive and usable
+    auto replacement = pool->getconnection();
+    EXPECT_NE(replacement.get(), leaked.get());
+    EXPECT_TRUE(leaked->update("UPDATE t SET k=1"));
+    EXPECT_EQ(pool->counters().total, 1);
+
+    uint64_t destroyed = pool->metrics().destructions;
+    leaked.reset();
+    EXPECT_EQ(pool->metrics().destructions, destroyed + 1);
+    EXPECT_EQ(pool->counters().total, 1);
+    EXPECT_EQ(pool->counters().inUse, 1);
+    replacement.reset();
+    EXPECT_EQ(pool->counters().idle, 1);
+}
+
+TEST(LeakDetectorTest, ReclaimNeedsDetection) {
+    PoolConfig config;
+    config.driver = "fake";
+    config.leakReclaimTimeout = seconds(10);
+    EXPECT_FALSE(config.validate().empty());
+    config.leakDetectionThreshold = seconds(30);
+    EXPECT_FALSE(config.validate().empty());
+    config.leakDetectionThreshold = seconds(5);
+    EXPECT_TRUE(config.validate().empty());
+}
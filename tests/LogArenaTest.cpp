@@ -0,0 +1,119 @@
+/*
+* @Description: Steady state logging must not touch the heap
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Logger.hpp"
+
+namespace {
+std::atomic<bool> g_counting{false};
+std::atomic<size_t> g_allocations{0};
+}
+
+// Count every allocation made by any thread while counting is on
+void* operator new(std::size_t size) {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+// Out of line: inlined into a delete expression, GCC pairs the free with the
+// new expression and warns -Wmismatched-new-delete
+[[gnu::noinline]] static void releaseCounted(void* p) noexcept { std::free(p); }
+void operator delete(void* p) noexcept { releaseCounted(p); }
+void operator delete(void* p, std::size_t) noexcept { releaseCounted(p); }
+
+class LogArenaTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        AsyncLogger::instance().init("test_arena.log", 64 * 1024 * 1024, 1024, false, false);
+    }
+    void TearDown() override {
+        AsyncLogger::instance().shutdown();
+        std::remove("test_arena.log");
+    }
+
+    static void logBurst(int count, const std::string& longText) {
+        for (int i = 0; i < count; ++i) {
+            INFO_LOG("short message {} value={}", i, 3.14);
+            if (i % 8 == 0) {
+                // Spills into a pooled chunk
+                INFO_LOG("long message {} {}", i, longText);
+            }
+        }
+    }
+};
+
+TEST_F(LogArenaTest, SteadyStateLoggingDoesNotAllocate) {
+    const std::string longText(1000, 'x');
+
+    // Enough chunks for every queue slot on the way to the file sink to hold a
+    // long message, then warm up sink buffers and localtime_r caches
+    LogChunkPool::instance().reserve(1024 + 1024 + 64);
+    logBurst(2000, longText);
+    AsyncLogger::instance().flush();
+    size_t chunks = LogChunkPool::instance().allocated();
+
+    g_allocations = 0;
+    g_counting = true;
+    logBurst(20000, longText);
+    AsyncLogger::instance().flush();
+    g_counting = false;
+
+    EXPECT_EQ(g_allocations.load(), 0u);
+    EXPECT_EQ(LogChunkPool::instance().allocated(), chunks);
+}
+
+TEST(LogMessageTest, InlineAndSpilledPayloads) {
+    LogMessage shortMessage;
+    shortMessage.format("id={} name={}", 42, "pool");
+    EXPECT_EQ(std::string(shortMessage.data(), shortMessage.size()), "id=42 name=pool");
+
+    const std::string longText(LogMessage::kInlineSize * 2, 'y');
+    LogMessage longMessage;
+    longMessage.format("{}", longText);
+    EXPECT_EQ(std::string(longMessage.data(), longMessage.size()), longText);
+
+    // Copies share the chunk, the original stays readable after the copy dies
+    {
+        LogMessage copy = longMessage;
+        EXPECT_EQ(copy.data(), longMessage.data());
+    }
+    EXPECT_EQ(std::string(longMessage.data(), longMessage.size()), longText);
+
+    const std::string hugeText(LogChunkPool::kChunkSize * 2, 'z');
+    LogMessage truncated(hugeText.data(), hugeText.size());
+    EXPECT_EQ(truncated.size(), LogChunkPool::kChunkSize);
+}
+
+TEST(LogMessageTest, TruncationIsMarked) {
+    // The marker counts every byte left out, kept text included
+    auto expectMarked = [](const LogMessage& message, size_t total) {
+        std::string text(message.data(), message.size());
+        ASSERT_EQ(text.size(), LogChunkPool::kChunkSize);
+        size_t kept = text.rfind("...[truncated ");
+        ASSERT_NE(kept, std::string::npos);
+        EXPECT_EQ(text.substr(kept), "...[truncated " + std::to_string(total - kept) + " bytes]");
+        EXPECT_EQ(text.find_first_not_of('z'), kept);
+    };
+    const std::string hugeText(LogChunkPool::kChunkSize * 2, 'z');
+    expectMarked(LogMessage(hugeText.data(), hugeText.size()), hugeText.size());
+    LogMessage formatted;
+    formatted.format("{}", hugeText);
+    expectMarked(formatted, hugeText.size());
+    // Dropping 9 bytes plus a marker of 23 crosses to a two digit count
+    const std::string justOver(LogChunkPool::kChunkSize + 9, 'z');
+    expectMarked(LogMessage(justOver.data(), justOver.size()), justOver.size());
+
+    const std::string exact(LogChunkPool::kChunkSize, 'z');
+    EXPECT_EQ(std::string(LogMessage(exact.data(), exact.size()).view().data(), LogChunkPool::kChunkSize), exact);
+}
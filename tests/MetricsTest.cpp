@@ -0,0 +1,79 @@
+/*
+* @Description: Histogram accuracy, sharded counters and metrics renderers
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "PoolMetrics.h"
+
+TEST(HistogramTest, IndexRoundTrip) {
+    for (uint64_t v : std::vector<uint64_t>{0, 1, 127, 128, 1000, 123456, uint64_t(1) << 39, Histogram::kMaxValue}) {
+        size_t i = Histogram::indexOf(v);
+        ASSERT_LT(i, Histogram::kCountsLength);
+        EXPECT_LE(HistogramSnapshot::lowestEquivalent(i), v);
+        EXPECT_GE(HistogramSnapshot::highestEquivalent(i), v);
+    }
+}
+
+TEST(HistogramTest, PercentilesWithinPrecision) {
+    Histogram h;
+    for (uint64_t v = 1; v <= 100000; v++) h.record(v);
+    HistogramSnapshot s = h.snapshot();
+    EXPECT_EQ(s.count(), 100000u);
+    EXPECT_EQ(s.sum(), 100000ull * 100001 / 2);
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        double expected = q * 100000;
+        EXPECT_NEAR(static_cast<double>(s.percentile(q)), expected, expected / 64 + 1) << q;
+    }
+    EXPECT_NEAR(static_cast<double>(s.max()), 100000, 100000 / 64);
+    EXPECT_EQ(s.countAtOrBelow(100), 100u);
+}
+
+TEST(HistogramTest, ConcurrentRecordingLosesNothing) {
+    Histogram h;
+    ShardedCounter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100000; i++) {
+                h.record(static_cast<uint64_t>(i % 5000));
+                counter.add();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(h.snapshot().count(), 800000u);
+    EXPECT_EQ(counter.load(), 800000u);
+}
+
+TEST(MetricsRenderTest, PrometheusAndJson) {
+    Histogram wait;
+    wait.record(40);     // 40us
+    wait.record(2000);   // 2ms
+    PoolMetricsSnapshot m;
+    m.pool = "orders";
+    m.acquireWait = wait.snapshot();
+    m.acquires = m.acquireWait.count();
+    m.timeouts = 3;
+    m.gauges.idle = 4;
+    m.maxSize = 10;
+    m.connections.push_back({0x10, true, 5, 1, 0, 42});
+
+    std::string text = renderPrometheus({m});
+    EXPECT_NE(text.find("# TYPE connection_pool_acquire_wait_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("connection_pool_acquire_timeouts_total{pool=\"orders\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("connection_pool_acquire_wait_seconds_bucket{pool=\"orders\",le=\"5e-05\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("connection_pool_acquire_wait_seconds_bucket{pool=\"orders\",le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("connection_pool_idle_connections{pool=\"orders\"} 4\n"), std::string::npos);
+    EXPECT_NE(text.find("connection=\"0x10\"} 42\n"), std::string::npos);
+
+    std::string json = renderJson({m});
+    EXPECT_EQ(json.rfind("{\"pools\":[{\"pool\":\"orders\"", 0), 0u);
+    EXPECT_NE(json.find("\"acquire_timeouts_total\":3"), std::string::npos);
+    EXPECT_NE(json.find("\"queries\":42"), std::string::npos);
+}
@@ -0,0 +1,156 @@
+/*
+* @Description: perf_suite, the fixed benchmark set compared against a baseline by `make perf_check`
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Everything runs against the fake driver with zero latency, so the numbers are
+* the CPU cost of pool, connection, driver interface and logger code. Keep the
+* benchmark names stable: scripts/perf_compare.py matches results by name and a
+* renamed benchmark loses its history.
+*   ./perf_suite --benchmark_repetitions=10 --benchmark_out=current.json --benchmark_out_format=json
+*   scripts/perf_compare.py baseline.json current.json
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "Logger.hpp"
+
+using namespace std::chrono;
+
+namespace {
+
+const int kRows = 1000;
+
+// One int, one short and one long string column, like a typical row
+const FakeRows& decodeRows() {
+    static const FakeRows rows = [] {
+        FakeRows r(kRows);
+        for (int i = 0; i < kRows; i++) {
+            r[i] = {std::to_string(i + 1), std::to_string(i * 7 % 1000), "name" + std::to_string(i),
+                    std::string(120, 'c')};
+        }
+        return r;
+    }();
+    return rows;
+}
+
+std::shared_ptr<connection_pool> fakePool(int size) {
+    PoolConfig config;
+    config.name = "perf";
+    config.driver = "fake";
+    config.initSize = size;
+    config.maxSize = size;
+    config.connectionTimeout = seconds(10);
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    options.pingLatency = LatencyDistribution::fixed(microseconds(0));
+    options.handler = [](const std::string& sql) {
+        return sql.compare(0, 6, "SELECT") == 0 ? decodeRows() : FakeRows(1);
+    };
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+std::shared_ptr<connection_pool> g_pool;
+
+void SetupPool(const benchmark::State&) { g_pool = fakePool(8); }
+void TeardownPool(const benchmark::State&) { g_pool.reset(); }
+
+const char* kBenchLog = "perf_suite.log";
+
+void SetupLogger(const benchmark::State&) {
+    AsyncLogger& logger = AsyncLogger::instance();
+    logger.init(kBenchLog, 1024 * 1024 * 1024, 4096, false, false);
+    logger.clear_sinks();
+    logger.add_sink(std::make_shared<RingSink>(4096, LogLevel::DEBUG, 4096));
+}
+
+void TeardownLogger(const benchmark::State&) {
+    AsyncLogger::instance().shutdown();
+    std::remove(kBenchLog);
+}
+
+} // namespace
+
+// Uncontended getconnection + return
+static void BM_AcquireRelease(benchmark::State& state) {
+    for (auto _ : state) {
+        auto conn = g_pool->getconnection();
+        benchmark::DoNotOptimize(conn.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Threads share 8 connections, past 8 threads borrowers queue
+static void BM_ContendedAcquire(benchmark::State& state) {
+    for (auto _ : state) {
+        auto conn = g_pool->getconnection();
+        benchmark::DoNotOptimize(conn.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// INFO_LOG into an in-memory sink, blocking when the queue is full, so the
+// rate includes what the drain thread can absorb
+static void BM_LoggerThroughput(benchmark::State& state) {
+    int64_t i = 0;
+    for (auto _ : state) {
+        INFO_LOG("perf suite message {} from thread {}", i++, state.thread_index());
+    }
+    if (state.thread_index() == 0) AsyncLogger::instance().flush();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 1000 rows x 4 columns read through ResultSet and converted to values
+static void BM_ResultDecode(benchmark::State& state) {
+    auto conn = g_pool->getconnection();
+    for (auto _ : state) {
+        auto rows = conn->select("SELECT id, k, name, c FROM t");
+        int64_t sum = 0;
+        size_t bytes = 0;
+        std::string name;
+        while (rows->next()) {
+            sum += std::strtoll(rows->field(0), nullptr, 10) + std::strtoll(rows->field(1), nullptr, 10);
+            name.assign(rows->field(2), rows->fieldLength(2));
+            bytes += name.size() + rows->fieldLength(3);
+        }
+        benchmark::DoNotOptimize(sum);
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+
+// Multi-row INSERT of 1000 rows built and sent as one statement
+static void BM_BulkInsert(benchmark::State& state) {
+    auto conn = g_pool->getconnection();
+    std::string sql;
+    for (auto _ : state) {
+        sql = "INSERT INTO t (id, k, c) VALUES ";
+        for (int id = 1; id <= kRows; id++) {
+            sql += id == 1 ? "(" : ",(";
+            sql += std::to_string(id);
+            sql += ',';
+            sql += std::to_string(id * 7);
+            sql += ",'row')";
+        }
+        benchmark::DoNotOptimize(conn->update(sql));
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+
+BENCHMARK(BM_AcquireRelease)->Setup(SetupPool)->Teardown(TeardownPool);
+BENCHMARK(BM_ContendedAcquire)->Threads(2)->Threads(8)->Threads(32)->UseRealTime()
+    ->Setup(SetupPool)->Teardown(TeardownPool);
+BENCHMARK(BM_LoggerThroughput)->Threads(1)->Threads(8)->UseRealTime()
+    ->Setup(SetupLogger)->Teardown(TeardownLogger);
+BENCHMARK(BM_ResultDecode)->Setup(SetupPool)->Teardown(TeardownPool);
+BENCHMARK(BM_BulkInsert)->Setup(SetupPool)->Teardown(TeardownPool);
+
+BENCHMARK_MAIN();
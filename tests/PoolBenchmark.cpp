@@ -0,0 +1,103 @@
+/*
+* @Description: connection_pool benchmarks against the fake driver
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Run with JSON output to keep a history:
+*   ./pool_bench --benchmark_out=pool_bench.json --benchmark_out_format=json
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+
+using namespace std::chrono;
+
+namespace {
+
+PoolConfig::IdleOrder idleOrder(int64_t arg) {
+    return arg == 0 ? PoolConfig::IdleOrder::FIFO : PoolConfig::IdleOrder::LIFO;
+}
+
+std::shared_ptr<connection_pool> fakePool(PoolConfig::IdleOrder order, int initSize, int maxSize) {
+    PoolConfig config;
+    config.name = "bench";
+    config.driver = "fake";
+    config.initSize = initSize;
+    config.maxSize = maxSize;
+    config.idleOrder = order;
+    config.maxIdleTime = seconds(1);
+    config.connectionTimeout = seconds(5);
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(500));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(200));
+    options.pingLatency = LatencyDistribution::fixed(microseconds(20));
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+// A burst grows the pool to maxSize, then two clients keep querying for a few
+// maxIdleTime periods. FIFO rotates every connection through the light load so
+// none ever reaches maxIdleTime; LIFO keeps reusing the hot ones and the rest
+// are evicted. steady_size is the pool size at the end
+void BM_SteadyStateAfterBurst(benchmark::State& state) {
+    const int kMaxSize = 32;
+    const int kInitSize = 2;
+    for (auto _ : state) {
+        auto pool = fakePool(idleOrder(state.range(0)), kInitSize, kMaxSize);
+
+        std::vector<std::thread> burst;
+        for (int i = 0; i < kMaxSize; i++) {
+            burst.emplace_back([&pool] {
+                auto conn = pool->getconnection();
+                std::this_thread::sleep_for(milliseconds(20));
+            });
+        }
+        for (auto& t : burst) t.join();
+        int peak = pool->counters().total;
+
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> queries{0};
+        std::vector<std::thread> steady;
+        for (int i = 0; i < 2; i++) {
+            steady.emplace_back([&] {
+                while (!stop) {
+                    auto conn = pool->getconnection();
+                    conn->update("UPDATE t SET v = v + 1");
+                    queries++;
+                }
+            });
+        }
+        std::this_thread::sleep_for(milliseconds(3500));
+        stop = true;
+        for (auto& t : steady) t.join();
+
+        state.counters["peak_size"] = peak;
+        state.counters["steady_size"] = pool->counters().total;
+        state.counters["queries"] = static_cast<double>(queries.load());
+    }
+}
+
+// Uncontended borrow + return cost, the queue order must not slow it down
+void BM_BorrowReturn(benchmark::State& state) {
+    auto pool = fakePool(idleOrder(state.range(0)), 8, 8);
+    for (auto _ : state) {
+        auto conn = pool->getconnection();
+        benchmark::DoNotOptimize(conn.get());
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_SteadyStateAfterBurst)->ArgName("lifo")->Arg(0)->Arg(1)
+    ->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BorrowReturn)->ArgName("lifo")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,366 @@
+/*
+* @Description: pool_loadgen, closed and open loop load generator for connection_pool
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Closed loop: every thread issues the next request as soon as the previous one
+* finished. Open loop: requests arrive at --rate per second (Poisson), spread
+* over the threads, and latency is measured from the scheduled arrival, so time
+* spent queued behind a slow request is counted (no coordinated omission).
+* A closed loop run can be corrected with --expected-interval-us, which
+* back-fills the requests a stalled client would have sent (HdrHistogram's
+* recordValueWithExpectedInterval).
+*
+*   ./pool_loadgen --mode=open --rate=20000 --threads=32 --mix=select=8,write=1,txn=1
+*   ./pool_loadgen --config=db_config.ini --prepare --mix=select=1 --json
+*   ./pool_loadgen --mode=open --rate=2000 --trace=run.trace   (then pool_replay --trace=run.trace)
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "Histogram.hpp"
+#include "QueryTrace.h"
+
+using namespace std::chrono;
+
+namespace {
+
+enum Op { kBorrow, kSelect, kWrite, kTxn, kOpCount };
+const char* kOpNames[kOpCount] = {"borrow", "select", "write", "txn"};
+
+struct Options {
+    std::string mode = "closed";   // closed | open
+    std::string config;            // real backend settings; empty = fake driver
+    int threads = 16;
+    double rate = 10000;           // open loop requests per second, all threads
+    seconds duration{10};
+    seconds warmup{2};
+    int64_t expectedIntervalUs = 0; // closed loop correction, 0 = off
+    double mix[kOpCount] = {0, 1, 0, 0};
+    std::string table = "sbtest1";
+    int rows = 10000;
+    bool prepare = false;
+    int initSize = -1;              // -1: keep the config value
+    int maxSize = -1;
+    int64_t queryLatencyUs = 200;   // fake driver median
+    double latencySigma = 0;        // fake driver: > 0 for a lognormal tail
+    bool json = false;
+    std::string trace;              // capture the measured part for pool_replay
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: pool_loadgen [options]\n"
+        "  --mode=closed|open          arrival process (default closed)\n"
+        "  --rate=N                    open loop requests per second (default 10000)\n"
+        "  --threads=N                 client threads (default 16)\n"
+        "  --duration=S --warmup=S     seconds (default 10, 2)\n"
+        "  --mix=select=8,write=1,...  weights of borrow, select, write, txn\n"
+        "  --expected-interval-us=N    closed loop coordinated omission correction\n"
+        "  --config=FILE               run against the backend in FILE, else the fake driver\n"
+        "  --table=NAME --rows=N       table (id, k, c) used by the requests\n"
+        "  --prepare                   create and fill the table first\n"
+        "  --init-size=N --max-size=N  pool size overrides\n"
+        "  --query-latency-us=N        fake driver median query latency (default 200)\n"
+        "  --latency-sigma=X           fake driver lognormal shape, 0 = fixed\n"
+        "  --json                      print the report as JSON\n"
+        "  --trace=FILE                capture borrows and statements for pool_replay\n");
+}
+
+bool parseMix(const std::string& raw, double* mix) {
+    std::fill(mix, mix + kOpCount, 0.0);
+    std::stringstream in(raw);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        double weight = eq == std::string::npos ? 1 : std::atof(item.c_str() + eq + 1);
+        auto it = std::find_if(kOpNames, kOpNames + kOpCount, [&](const char* n) { return name == n; });
+        if (it == kOpNames + kOpCount || weight < 0) return false;
+        mix[it - kOpNames] = weight;
+    }
+    return std::any_of(mix, mix + kOpCount, [](double w) { return w > 0; });
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--mode" && (value == "closed" || value == "open")) o.mode = value;
+        else if (key == "--rate") o.rate = std::atof(value.c_str());
+        else if (key == "--threads") o.threads = std::atoi(value.c_str());
+        else if (key == "--duration") o.duration = seconds(std::atoi(value.c_str()));
+        else if (key == "--warmup") o.warmup = seconds(std::atoi(value.c_str()));
+        else if (key == "--expected-interval-us") o.expectedIntervalUs = std::atoll(value.c_str());
+        else if (key == "--mix") { if (!parseMix(value, o.mix)) return false; }
+        else if (key == "--config") o.config = value;
+        else if (key == "--table") o.table = value;
+        else if (key == "--rows") o.rows = std::atoi(value.c_str());
+        else if (key == "--prepare") o.prepare = true;
+        else if (key == "--init-size") o.initSize = std::atoi(value.c_str());
+        else if (key == "--max-size") o.maxSize = std::atoi(value.c_str());
+        else if (key == "--query-latency-us") o.queryLatencyUs = std::atoll(value.c_str());
+        else if (key == "--latency-sigma") o.latencySigma = std::atof(value.c_str());
+        else if (key == "--json") o.json = true;
+        else if (key == "--trace") o.trace = value;
+        else return false;
+    }
+    return o.threads > 0 && o.rate > 0 && o.rows > 0 && o.duration.count() > 0;
+}
+
+std::shared_ptr<connection_pool> makePool(const Options& o) {
+    PoolConfig config;
+    std::shared_ptr<Driver> driver;
+    if (!o.config.empty()) {
+        config = PoolConfig::load(o.config);
+    } else {
+        config.driver = "fake";
+        config.initSize = o.threads;
+        config.maxSize = o.threads;
+        FakeDriverOptions fake;
+        auto median = microseconds(o.queryLatencyUs);
+        fake.queryLatency = o.latencySigma > 0 ? LatencyDistribution::lognormal(median, o.latencySigma)
+                                               : LatencyDistribution::fixed(median);
+        driver = std::make_shared<FakeDriver>(fake);
+    }
+    config.name = "loadgen";
+    if (o.maxSize > 0) config.maxSize = o.maxSize;
+    if (o.initSize >= 0) config.initSize = o.initSize;
+    config.initSize = std::min(config.initSize, config.maxSize);
+    return connection_pool::create(config, driver);
+}
+
+// sysbench style table: id, k, c
+bool prepareTable(connection_pool& pool, const Options& o) {
+    auto conn = pool.getconnection();
+    if (!conn->update("CREATE TABLE IF NOT EXISTS " + o.table +
+                      " (id INT PRIMARY KEY, k INT NOT NULL DEFAULT 0, c CHAR(120) NOT NULL DEFAULT '')")) {
+        return false;
+    }
+    const int kBatch = 1000;
+    for (int first = 1; first <= o.rows; first += kBatch) {
+        std::string sql = "INSERT IGNORE INTO " + o.table + " (id, k, c) VALUES ";
+        for (int id = first; id < first + kBatch && id <= o.rows; id++) {
+            sql += (id == first ? "(" : ",(") + std::to_string(id) + "," + std::to_string(id) + ",'row')";
+        }
+        if (!conn->update(sql)) return false;
+    }
+    return true;
+}
+
+struct OpStats {
+    Histogram latency; // us, from intended start
+    std::atomic<uint64_t> errors{0};
+};
+
+struct Results {
+    Histogram response; // us, from intended start (open loop) or corrected (closed loop)
+    Histogram service;  // us, from actual start
+    OpStats ops[kOpCount];
+    std::atomic<uint64_t> timeouts{0};
+};
+
+// One request. false on a failed statement or acquire timeout
+bool runOp(connection_pool& pool, Op op, int id, const std::string& table, Results& results) {
+    decltype(pool.getconnection()) conn;
+    try {
+        conn = pool.getconnection();
+    } catch (const std::runtime_error&) {
+        results.timeouts++;
+        return false;
+    }
+    std::string key = std::to_string(id);
+    switch (op) {
+    case kBorrow:
+        return true;
+    case kSelect: {
+        auto rows = conn->select("SELECT c FROM " + table + " WHERE id=" + key);
+        if (!rows) return false;
+        while (rows->next()) {}
+        return true;
+    }
+    case kWrite:
+        return conn->update("UPDATE " + table + " SET k=k+1 WHERE id=" + key);
+    case kTxn: {
+        bool ok = conn->update("BEGIN");
+        auto rows = ok ? conn->select("SELECT k FROM " + table + " WHERE id=" + key + " FOR UPDATE") : nullptr;
+        ok = rows != nullptr;
+        rows.reset();
+        ok = ok && conn->update("UPDATE " + table + " SET k=k+1 WHERE id=" + key);
+        return conn->update(ok ? "COMMIT" : "ROLLBACK") && ok;
+    }
+    default:
+        return false;
+    }
+}
+
+void record(Results& results, Op op, uint64_t responseUs, uint64_t serviceUs, int64_t expectedIntervalUs) {
+    results.service.record(serviceUs);
+    results.response.record(responseUs);
+    results.ops[op].latency.record(responseUs);
+    // Requests a stalled closed loop client did not send, back-filled as if each
+    // had waited for the stall to end
+    if (expectedIntervalUs > 0) {
+        for (int64_t missing = static_cast<int64_t>(responseUs) - expectedIntervalUs;
+             missing >= expectedIntervalUs; missing -= expectedIntervalUs) {
+            results.response.record(static_cast<uint64_t>(missing));
+            results.ops[op].latency.record(static_cast<uint64_t>(missing));
+        }
+    }
+}
+
+void worker(connection_pool& pool, const Options& o, int index, steady_clock::time_point start,
+            steady_clock::time_point measureFrom, steady_clock::time_point end, Results& results) {
+    std::mt19937_64 rng(1234567 + index);
+    std::discrete_distribution<int> pickOp(o.mix, o.mix + kOpCount);
+    std::uniform_int_distribution<int> pickId(1, o.rows);
+    // Each thread carries rate/threads of the Poisson arrivals
+    std::exponential_distribution<double> gap(o.rate / o.threads);
+    bool open = o.mode == "open";
+    auto intended = start;
+    while (true) {
+        if (open) {
+            intended += duration_cast<steady_clock::duration>(duration<double>(gap(rng)));
+            if (intended >= end) break;
+            // Behind schedule: start at once, the backlog shows up as latency
+            std::this_thread::sleep_until(intended);
+        }
+        auto begin = steady_clock::now();
+        if (begin >= end) break;
+        if (!open) intended = begin;
+        Op op = static_cast<Op>(pickOp(rng));
+        bool ok = runOp(pool, op, pickId(rng), o.table, results);
+        auto done = steady_clock::now();
+        if (intended < measureFrom) continue;
+        if (!ok) results.ops[op].errors++;
+        record(results, op, static_cast<uint64_t>(duration_cast<microseconds>(done - intended).count()),
+               static_cast<uint64_t>(duration_cast<microseconds>(done - begin).count()),
+               open ? 0 : o.expectedIntervalUs);
+    }
+}
+
+std::string percentiles(const HistogramSnapshot& h, bool json) {
+    const std::pair<const char*, double> kQuantiles[] = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}, {"p9999", 0.9999}};
+    char buffer[64];
+    std::string out = json ? "{" : "";
+    for (const auto& q : kQuantiles) {
+        std::snprintf(buffer, sizeof(buffer), json ? "\"%s\":%llu," : "%s=%llu ", q.first,
+                      static_cast<unsigned long long>(h.percentile(q.second)));
+        out += buffer;
+    }
+    std::snprintf(buffer, sizeof(buffer), json ? "\"max\":%llu,\"mean\":%.1f}" : "max=%llu mean=%.1f",
+                  static_cast<unsigned long long>(h.max()), h.mean());
+    return out + buffer;
+}
+
+void report(const Options& o, const Results& results, connection_pool& pool) {
+    HistogramSnapshot response = results.response.snapshot();
+    HistogramSnapshot service = results.service.snapshot();
+    double secs = static_cast<double>(o.duration.count());
+    // Back-filled samples are not requests, count them from the service histogram
+    double throughput = service.count() / secs;
+    uint64_t errors = 0;
+    for (const auto& op : results.ops) errors += op.errors.load();
+    auto metrics = pool.metrics();
+
+    if (o.json) {
+        std::printf("{\"mode\":\"%s\",\"threads\":%d,\"rate\":%.0f,\"duration_s\":%.0f,\"backend\":\"%s\","
+                    "\"requests\":%llu,\"throughput\":%.1f,\"errors\":%llu,\"timeouts\":%llu,",
+                    o.mode.c_str(), o.threads, o.mode == "open" ? o.rate : 0.0, secs,
+                    o.config.empty() ? "fake" : o.config.c_str(),
+                    static_cast<unsigned long long>(service.count()), throughput,
+                    static_cast<unsigned long long>(errors),
+                    static_cast<unsigned long long>(results.timeouts.load()));
+        std::printf("\"response_us\":%s,\"service_us\":%s,\"acquire_wait_us\":%s,\"ops\":{",
+                    percentiles(response, true).c_str(), percentiles(service, true).c_str(),
+                    percentiles(metrics.acquireWait, true).c_str());
+        bool first = true;
+        for (int i = 0; i < kOpCount; i++) {
+            if (o.mix[i] <= 0) continue;
+            std::printf("%s\"%s\":{\"errors\":%llu,\"response_us\":%s}", first ? "" : ",", kOpNames[i],
+                        static_cast<unsigned long long>(results.ops[i].errors.load()),
+                        percentiles(results.ops[i].latency.snapshot(), true).c_str());
+            first = false;
+        }
+        std::printf("},\"pool_size\":%d}\n", metrics.gauges.total);
+        return;
+    }
+    std::printf("%s loop, %d threads%s, %.0fs against %s\n", o.mode.c_str(), o.threads,
+                o.mode == "open" ? (", " + std::to_string(static_cast<long long>(o.rate)) + "/s Poisson").c_str() : "",
+                secs, o.config.empty() ? "the fake driver" : o.config.c_str());
+    std::printf("requests %llu  throughput %.1f/s  errors %llu  acquire timeouts %llu  pool size %d\n",
+                static_cast<unsigned long long>(service.count()), throughput,
+                static_cast<unsigned long long>(errors),
+                static_cast<unsigned long long>(results.timeouts.load()), metrics.gauges.total);
+    const char* responseLabel = o.mode == "open" ? "response (us, from arrival)"
+                                : o.expectedIntervalUs > 0 ? "response (us, corrected)"
+                                                           : "response (us, uncorrected)";
+    std::printf("%-28s %s\n", responseLabel, percentiles(response, false).c_str());
+    std::printf("%-28s %s\n", "service (us)", percentiles(service, false).c_str());
+    std::printf("%-28s %s\n", "acquire wait (us)", percentiles(metrics.acquireWait, false).c_str());
+    for (int i = 0; i < kOpCount; i++) {
+        if (o.mix[i] <= 0) continue;
+        std::printf("  %-26s %s  errors %llu\n", kOpNames[i], percentiles(results.ops[i].latency.snapshot(), false).c_str(),
+                    static_cast<unsigned long long>(results.ops[i].errors.load()));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseArgs(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+    std::shared_ptr<connection_pool> pool;
+    try {
+        pool = makePool(o);
+    } catch (const ConfigError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+    if (o.prepare && !prepareTable(*pool, o)) {
+        std::fprintf(stderr, "preparing table %s failed\n", o.table.c_str());
+        return 1;
+    }
+
+    auto results = std::make_unique<Results>();
+    auto start = steady_clock::now();
+    auto measureFrom = start + o.warmup;
+    auto end = measureFrom + o.duration;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < o.threads; i++) {
+        threads.emplace_back(worker, std::ref(*pool), std::cref(o), i, start, measureFrom, end, std::ref(*results));
+    }
+    if (!o.trace.empty()) {
+        std::this_thread::sleep_until(measureFrom);
+        if (!QueryTrace::instance().start(o.trace)) {
+            std::fprintf(stderr, "cannot write trace %s\n", o.trace.c_str());
+        }
+    }
+    for (auto& t : threads) t.join();
+    if (QueryTrace::instance().enabled()) {
+        QueryTrace::instance().stop();
+        std::fprintf(stderr, "trace %s: %llu records, %llu dropped\n", o.trace.c_str(),
+                     static_cast<unsigned long long>(QueryTrace::instance().recorded()),
+                     static_cast<unsigned long long>(QueryTrace::instance().dropped()));
+    }
+    report(o, *results, *pool);
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+* @Description: pool_replay, re-drive a captured query trace against the fake driver or MySQL
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Every thread of the traced process gets a replay thread which borrows, runs
+* statements and returns connections at the recorded offsets (scaled by
+* --speed), so inter-arrival times and hold times are preserved. Literal values
+* are not in the trace, only their hash: statements are rebuilt from the
+* fingerprint text with a value derived from that hash in place of each ?,
+* the same original parameters always map to the same replayed ones.
+* Against the fake driver a statement takes its recorded duration.
+*
+*   ./pool_replay --trace=incident.trace
+*   ./pool_replay --trace=incident.trace --config=db_config.ini --speed=2 --key-range=10000
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "Histogram.hpp"
+#include "QueryTrace.h"
+
+using namespace std::chrono;
+
+namespace {
+
+struct Options {
+    std::string trace;
+    std::string config;  // real backend settings; empty = fake driver
+    double speed = 1;    // 2 = twice as fast
+    uint64_t keyRange = 1000000;
+    int initSize = -1;   // -1: config value, or for the fake driver the connections seen in the trace
+    int maxSize = -1;
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: pool_replay --trace=FILE [options]\n"
+        "  --config=FILE               replay against the backend in FILE, else the fake driver\n"
+        "  --speed=X                   time scale, 2 replays twice as fast (default 1)\n"
+        "  --key-range=N               replayed values are 1..N (default 1000000)\n"
+        "  --init-size=N --max-size=N  pool size overrides\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--trace") o.trace = value;
+        else if (key == "--config") o.config = value;
+        else if (key == "--speed") o.speed = std::atof(value.c_str());
+        else if (key == "--key-range") o.keyRange = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--init-size") o.initSize = std::atoi(value.c_str());
+        else if (key == "--max-size") o.maxSize = std::atoi(value.c_str());
+        else return false;
+    }
+    return !o.trace.empty() && o.speed > 0 && o.keyRange > 0;
+}
+
+uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Fingerprint text with every ? replaced. LIMIT/OFFSET need a bare number,
+// elsewhere a quoted one works for both string and numeric columns
+std::string rebuild(const std::string& text, uint64_t paramsHash, uint64_t keyRange) {
+    std::string sql;
+    sql.reserve(text.size() + 16);
+    uint64_t position = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '?') {
+            sql.push_back(text[i]);
+            continue;
+        }
+        std::string value = std::to_string(mix64(paramsHash + position++) % keyRange + 1);
+        size_t word = sql.find_last_not_of(" ,");
+        std::string before = word == std::string::npos ? "" : sql.substr(0, word + 1);
+        bool bare = (before.size() >= 5 && before.compare(before.size() - 5, 5, "limit") == 0) ||
+                    (before.size() >= 6 && before.compare(before.size() - 6, 6, "offset") == 0) ||
+                    (!before.empty() && before.back() == '?');
+        sql += bare ? value : "'" + value + "'";
+    }
+    return sql;
+}
+
+struct Stats {
+    Histogram lag;          // us, actual minus scheduled start of each step
+    Histogram originalWait; // us, acquire wait in the trace
+    Histogram replayWait;
+    Histogram originalStatement;
+    Histogram replayStatement;
+    std::atomic<uint64_t> borrows{0};
+    std::atomic<uint64_t> statements{0};
+    std::atomic<uint64_t> errors{0};   // statements that failed in replay but not in the trace
+    std::atomic<uint64_t> timeouts{0};
+};
+
+using Lease = decltype(std::declval<connection_pool&>().getconnection());
+
+void replayThread(connection_pool& pool, const Options& o, const TraceFile& trace,
+                  const std::vector<const TraceRecord*>& steps, steady_clock::time_point start, bool fake,
+                  Stats& stats) {
+    std::unordered_map<uint64_t, Lease> held; // traced connection -> replay lease
+    auto at = [&](const TraceRecord& r) {
+        return start + duration_cast<steady_clock::duration>(duration<double, std::micro>(r.timeUs / o.speed));
+    };
+    auto borrow = [&]() -> Lease {
+        try {
+            return pool.getconnection();
+        } catch (const std::runtime_error&) {
+            stats.timeouts++;
+            return nullptr;
+        }
+    };
+    for (const TraceRecord* step : steps) {
+        const TraceRecord& r = *step;
+        auto scheduled = at(r);
+        std::this_thread::sleep_until(scheduled);
+        auto begin = steady_clock::now();
+        stats.lag.record(static_cast<uint64_t>(std::max<int64_t>(0, duration_cast<microseconds>(begin - scheduled).count())));
+        switch (static_cast<TraceKind>(r.kind)) {
+        case TraceKind::BORROW: {
+            stats.borrows++;
+            stats.originalWait.record(r.durationUs);
+            Lease lease = borrow();
+            stats.replayWait.record(static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - begin).count()));
+            if (lease) held[r.connection] = std::move(lease);
+            break;
+        }
+        case TraceKind::RETURN:
+            held.erase(r.connection);
+            break;
+        case TraceKind::QUERY:
+        case TraceKind::UPDATE: {
+            stats.statements++;
+            stats.originalStatement.record(r.durationUs);
+            // A connection handed over by another thread: borrow one just for this statement
+            Lease temporary;
+            auto it = held.find(r.connection);
+            connection* conn = it != held.end() ? it->second.get() : (temporary = borrow()).get();
+            if (conn == nullptr) break;
+            auto text = trace.text.find(r.fingerprint);
+            std::string sql = text != trace.text.end() ? rebuild(text->second, r.paramsHash, o.keyRange) : "SELECT 1";
+            auto sent = steady_clock::now();
+            bool ok;
+            if (r.kind == static_cast<uint8_t>(TraceKind::UPDATE)) {
+                ok = conn->update(sql);
+            } else {
+                auto rows = conn->select(sql);
+                ok = rows != nullptr;
+                while (ok && rows->next()) {}
+            }
+            if (fake) std::this_thread::sleep_until(sent + microseconds(static_cast<int64_t>(r.durationUs / o.speed)));
+            stats.replayStatement.record(static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - sent).count()));
+            if (!ok && r.ok) stats.errors++;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+void printRow(const char* label, const HistogramSnapshot& h) {
+    std::printf("  %-22s p50=%llu p90=%llu p99=%llu max=%llu\n", label,
+                static_cast<unsigned long long>(h.percentile(0.5)), static_cast<unsigned long long>(h.percentile(0.9)),
+                static_cast<unsigned long long>(h.percentile(0.99)), static_cast<unsigned long long>(h.max()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseArgs(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+    TraceFile trace;
+    try {
+        trace = loadTrace(o.trace);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+    std::map<uint32_t, std::vector<const TraceRecord*>> threads;
+    std::unordered_set<uint64_t> connections;
+    uint64_t lastUs = 0;
+    for (const auto& r : trace.records) {
+        threads[r.thread].push_back(&r);
+        if (r.kind == static_cast<uint8_t>(TraceKind::BORROW)) connections.insert(r.connection);
+        lastUs = std::max(lastUs, r.timeUs);
+    }
+    // Records are drained in batches, a thread's own steps are replayed in time order
+    for (auto& thread : threads) {
+        std::stable_sort(thread.second.begin(), thread.second.end(),
+                         [](const TraceRecord* a, const TraceRecord* b) { return a->timeUs < b->timeUs; });
+    }
+
+    std::shared_ptr<connection_pool> pool;
+    bool fake = o.config.empty();
+    try {
+        PoolConfig config;
+        std::shared_ptr<Driver> driver;
+        if (!fake) {
+            config = PoolConfig::load(o.config);
+        } else {
+            config.driver = "fake";
+            config.maxSize = std::max<int>(1, static_cast<int>(connections.size()));
+            config.initSize = config.maxSize;
+            FakeDriverOptions options;
+            options.queryLatency = LatencyDistribution::fixed(microseconds(0)); // the recorded duration is slept instead
+            driver = std::make_shared<FakeDriver>(options);
+        }
+        config.name = "replay";
+        config.traceFile.clear();
+        if (o.maxSize > 0) config.maxSize = o.maxSize;
+        if (o.initSize >= 0) config.initSize = o.initSize;
+        config.initSize = std::min(config.initSize, config.maxSize);
+        pool = connection_pool::create(config, driver);
+    } catch (const ConfigError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    auto stats = std::make_unique<Stats>();
+    auto start = steady_clock::now();
+    std::vector<std::thread> workers;
+    for (const auto& thread : threads) {
+        workers.emplace_back(replayThread, std::ref(*pool), std::cref(o), std::cref(trace), std::cref(thread.second),
+                             start, fake, std::ref(*stats));
+    }
+    for (auto& t : workers) t.join();
+    double replaySeconds = duration<double>(steady_clock::now() - start).count();
+
+    std::printf("replayed %s: %zu records, %zu threads, %zu connections, %zu fingerprints against %s\n",
+                o.trace.c_str(), trace.records.size(), threads.size(), connections.size(), trace.text.size(),
+                fake ? "the fake driver" : o.config.c_str());
+    std::printf("duration %.3fs (trace %.3fs at speed %.2g)  borrows %llu  statements %llu  timeouts %llu  new errors %llu\n",
+                replaySeconds, lastUs / 1e6, o.speed,
+                static_cast<unsigned long long>(stats->borrows.load()),
+                static_cast<unsigned long long>(stats->statements.load()),
+                static_cast<unsigned long long>(stats->timeouts.load()),
+                static_cast<unsigned long long>(stats->errors.load()));
+    std::printf("us\n");
+    printRow("schedule lag", stats->lag.snapshot());
+    printRow("acquire wait, trace", stats->originalWait.snapshot());
+    printRow("acquire wait, replay", stats->replayWait.snapshot());
+    printRow("statement, trace", stats->originalStatement.snapshot());
+    printRow("statement, replay", stats->replayStatement.snapshot());
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+* @Description: pool_sim, compare pool settings offline on the discrete-event simulator
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*
+* Every combination of the comma separated values is simulated on the same
+* arrivals, --runs times with different seeds:
+*   ./pool_sim --rate=2000 --duration=600 --idle-order=fifo,lifo --max-size=16,32,64
+*   ./pool_sim --trace=arrivals.csv --validation-interval=0,500,5000
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PoolSimulator.h"
+
+using namespace std::chrono;
+
+namespace {
+
+std::vector<std::string> split(const std::string& raw) {
+    std::vector<std::string> out;
+    std::stringstream in(raw);
+    std::string item;
+    while (std::getline(in, item, ',')) out.push_back(item);
+    return out;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: pool_sim [options], comma separated values are swept\n"
+        "  --rate=N --duration=S         Poisson arrivals per second for S seconds (default 1000, 300)\n"
+        "  --trace=FILE                  recorded arrivals: arrival_us,service_us[,high]\n"
+        "  --runs=N                      repetitions with different seeds (default 1)\n"
+        "  --idle-order=fifo,lifo        --init-size=N,..  --max-size=N,..  --reserved-size=N,..\n"
+        "  --max-idle-time=S,..          --validation-interval=MS,..  --connection-timeout=MS\n"
+        "  --query-latency-us=N          median hold time (default 2000)\n"
+        "  --latency-sigma=X             lognormal shape, 0 = fixed (default 0.8)\n"
+        "  --connect-latency-us=N        --ping-latency-us=N\n"
+        "  --connect-failure-rate=X      --ping-failure-rate=X\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double rate = 1000;
+    int durationS = 300;
+    int runs = 1;
+    std::string trace;
+    std::vector<std::string> orders{"fifo"}, initSizes{"5"}, maxSizes{"10"}, reservedSizes{"0"},
+        idleTimes{"60"}, intervals{"500"};
+    int64_t connectionTimeoutMs = 100;
+    FakeDriverOptions backend;
+    int64_t queryUs = 2000;
+    double sigma = 0.8;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--rate") rate = std::atof(value.c_str());
+        else if (key == "--duration") durationS = std::atoi(value.c_str());
+        else if (key == "--trace") trace = value;
+        else if (key == "--runs") runs = std::max(1, std::atoi(value.c_str()));
+        else if (key == "--idle-order") orders = split(value);
+        else if (key == "--init-size") initSizes = split(value);
+        else if (key == "--max-size") maxSizes = split(value);
+        else if (key == "--reserved-size") reservedSizes = split(value);
+        else if (key == "--max-idle-time") idleTimes = split(value);
+        else if (key == "--validation-interval") intervals = split(value);
+        else if (key == "--connection-timeout") connectionTimeoutMs = std::atoll(value.c_str());
+        else if (key == "--query-latency-us") queryUs = std::atoll(value.c_str());
+        else if (key == "--latency-sigma") sigma = std::atof(value.c_str());
+        else if (key == "--connect-latency-us") backend.connectLatency = LatencyDistribution::fixed(microseconds(std::atoll(value.c_str())));
+        else if (key == "--ping-latency-us") backend.pingLatency = LatencyDistribution::fixed(microseconds(std::atoll(value.c_str())));
+        else if (key == "--connect-failure-rate") backend.connectFailureRate = std::atof(value.c_str());
+        else if (key == "--ping-failure-rate") backend.pingFailureRate = std::atof(value.c_str());
+        else {
+            usage();
+            return 2;
+        }
+    }
+    backend.queryLatency = sigma > 0 ? LatencyDistribution::lognormal(microseconds(queryUs), sigma)
+                                     : LatencyDistribution::fixed(microseconds(queryUs));
+
+    std::printf("%-5s %5s %5s %5s %6s %7s | %9s %8s %9s %9s %9s %6s %7s %7s %8s %8s\n",
+                "order", "init", "max", "rsv", "idle_s", "valid_ms", "requests", "timeouts",
+                "wait_p50", "wait_p99", "resp_p99", "peak", "mean", "final", "connects", "speedup");
+    for (int run = 0; run < runs; run++) {
+        std::vector<SimRequest> requests;
+        try {
+            requests = trace.empty() ? poissonArrivals(rate, int64_t(durationS) * 1000000, 1000 + run)
+                                     : loadArrivals(trace);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 2;
+        }
+        for (const auto& order : orders)
+        for (const auto& init : initSizes)
+        for (const auto& max : maxSizes)
+        for (const auto& reserved : reservedSizes)
+        for (const auto& idle : idleTimes)
+        for (const auto& interval : intervals) {
+            SimConfig config;
+            config.backend = backend;
+            config.backend.seed = 42 + run;
+            config.pool.idleOrder = order == "lifo" ? PoolConfig::IdleOrder::LIFO : PoolConfig::IdleOrder::FIFO;
+            config.pool.initSize = std::atoi(init.c_str());
+            config.pool.maxSize = std::atoi(max.c_str());
+            config.pool.reservedSize = std::atoi(reserved.c_str());
+            config.pool.maxIdleTime = seconds(std::atoi(idle.c_str()));
+            config.pool.validationInterval = milliseconds(std::atoll(interval.c_str()));
+            config.pool.connectionTimeout = milliseconds(connectionTimeoutMs);
+            SimResult r;
+            try {
+                r = simulate(config, requests);
+            } catch (const ConfigError& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                continue;
+            }
+            std::printf("%-5s %5s %5s %5s %6s %7s | %9llu %8llu %9llu %9llu %9llu %6d %7.1f %7d %8llu %7.0fx\n",
+                        order.c_str(), init.c_str(), max.c_str(), reserved.c_str(), idle.c_str(), interval.c_str(),
+                        static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.timeouts),
+                        static_cast<unsigned long long>(r.acquireWait.percentile(0.5)),
+                        static_cast<unsigned long long>(r.acquireWait.percentile(0.99)),
+                        static_cast<unsigned long long>(r.response.percentile(0.99)),
+                        r.peakSize, r.meanSize, r.finalSize, static_cast<unsigned long long>(r.connects),
+                        r.wallSeconds > 0 ? r.simulatedUs / 1e6 / r.wallSeconds : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+* @Description: Discrete-event pool simulation: determinism and policy effects
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "PoolSimulator.h"
+
+using namespace std::chrono;
+
+namespace {
+SimConfig baseConfig() {
+    SimConfig config;
+    config.pool.initSize = 2;
+    config.pool.maxSize = 32;
+    config.pool.maxIdleTime = seconds(10);
+    config.pool.connectionTimeout = milliseconds(500);
+    config.pool.validationInterval = milliseconds(500);
+    config.backend.connectLatency = LatencyDistribution::fixed(milliseconds(5));
+    config.backend.queryLatency = LatencyDistribution::lognormal(milliseconds(2), 0.8);
+    config.backend.pingLatency = LatencyDistribution::fixed(microseconds(100));
+    return config;
+}
+
+// A minute at 3000/s, then an hour at 50/s
+std::vector<SimRequest> burstThenQuiet(uint64_t seed) {
+    auto requests = poissonArrivals(3000, 60'000'000, seed);
+    for (SimRequest r : poissonArrivals(50, 3'600'000'000LL, seed + 1)) {
+        r.arrivalUs += 60'000'000;
+        requests.push_back(r);
+    }
+    return requests;
+}
+}
+
+TEST(PoolSimulatorTest, SameInputsSameResult) {
+    SimConfig config = baseConfig();
+    config.pool.validationInterval = milliseconds(0); // ping on every borrow
+    config.backend.pingFailureRate = 0.01;
+    auto requests = poissonArrivals(2000, 30'000'000, 7);
+    SimResult a = simulate(config, requests);
+    SimResult b = simulate(config, requests);
+    EXPECT_EQ(a.served, b.served);
+    EXPECT_EQ(a.timeouts, b.timeouts);
+    EXPECT_EQ(a.connects, b.connects);
+    EXPECT_EQ(a.validationFailures, b.validationFailures);
+    EXPECT_EQ(a.acquireWait.percentile(0.99), b.acquireWait.percentile(0.99));
+    EXPECT_EQ(a.peakSize, b.peakSize);
+    EXPECT_DOUBLE_EQ(a.meanSize, b.meanSize);
+    EXPECT_EQ(a.requests, requests.size());
+    EXPECT_EQ(a.served + a.timeouts, a.requests);
+    EXPECT_GT(a.validationFailures, 0u);
+}
+
+TEST(PoolSimulatorTest, RunsFarFasterThanRealTime) {
+    SimResult r = simulate(baseConfig(), burstThenQuiet(1));
+    EXPECT_GE(r.simulatedUs, 3'600'000'000LL);
+    EXPECT_LT(r.wallSeconds, 36.0); // at least 100x, typically far more
+    EXPECT_EQ(r.timeouts, 0u);
+}
+
+TEST(PoolSimulatorTest, LifoShrinksAfterBurst) {
+    auto requests = burstThenQuiet(3);
+    SimConfig fifo = baseConfig();
+    SimConfig lifo = baseConfig();
+    lifo.pool.idleOrder = PoolConfig::IdleOrder::LIFO;
+    SimResult f = simulate(fifo, requests);
+    SimResult l = simulate(lifo, requests);
+    EXPECT_GT(f.peakSize, 4);
+    EXPECT_LT(l.meanSize, f.meanSize);
+    EXPECT_LE(l.finalSize, f.finalSize);
+    EXPECT_GT(l.evictions, f.evictions);
+}
+
+TEST(PoolSimulatorTest, TooSmallPoolTimesOut) {
+    SimConfig config = baseConfig();
+    config.pool.maxSize = 2;
+    config.pool.connectionTimeout = milliseconds(20);
+    SimResult r = simulate(config, poissonArrivals(3000, 5'000'000, 5));
+    EXPECT_GT(r.timeouts, 0u);
+    EXPECT_LE(r.peakSize, 2);
+}
+
+TEST(PoolSimulatorTest, LoadsRecordedArrivals) {
+    const char* file = "sim_arrivals.csv";
+    std::ofstream(file) << "# arrival_us,service_us,high\n0,1000\n10,1000\n20,1000,1\n";
+    auto requests = loadArrivals(file);
+    std::remove(file);
+    ASSERT_EQ(requests.size(), 3u);
+    EXPECT_TRUE(requests[2].high);
+    SimConfig config = baseConfig();
+    config.pool.initSize = 1;
+    config.pool.maxSize = 1;
+    SimResult r = simulate(config, requests);
+    EXPECT_EQ(r.served, 3u);
+    // Served one after another: the last waits for two services
+    EXPECT_GE(r.response.max(), 2900u);
+}
@@ -0,0 +1,114 @@
+/*
+* @Description: Lock profiling of ProfiledMutex and the pool lock in metrics
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "ProfiledMutex.hpp"
+
+using namespace std::chrono;
+
+TEST(ProfiledMutexTest, OffRecordsNothing) {
+    ProfiledMutex mutex("m");
+    for (int i = 0; i < 100; i++) ProfiledLock lock(mutex, "loop");
+    LockProfileSnapshot s = mutex.snapshot();
+    EXPECT_EQ(s.name, "m");
+    EXPECT_FALSE(s.enabled);
+    EXPECT_EQ(s.acquisitions, 0u);
+    EXPECT_EQ(s.holdNs.count(), 0u);
+}
+
+TEST(ProfiledMutexTest, ContentionAndSites) {
+    ProfiledMutex mutex("m");
+    mutex.set_profiling(true);
+    std::thread holder;
+    {
+        ProfiledLock lock(mutex, "slow");
+        holder = std::thread([&] { ProfiledLock other(mutex, "fast"); });
+        std::this_thread::sleep_for(milliseconds(20));
+    }
+    holder.join();
+    mutex.set_profiling(false);
+    { ProfiledLock lock(mutex, "ignored"); }
+
+    LockProfileSnapshot s = mutex.snapshot();
+    EXPECT_EQ(s.acquisitions, 2u);
+    EXPECT_EQ(s.contended, 1u);
+    ASSERT_EQ(s.waitNs.count(), 1u);
+    EXPECT_GE(s.waitNs.max(), 15000000u);
+    EXPECT_EQ(s.holdNs.count(), 2u);
+    ASSERT_EQ(s.sites.size(), 2u);
+    EXPECT_STREQ(s.sites[0].site, "slow");
+    EXPECT_GE(s.sites[0].maxHoldNs, 20000000u);
+    EXPECT_STREQ(s.sites[1].site, "fast");
+    EXPECT_LT(s.sites[1].maxHoldNs, s.sites[0].maxHoldNs);
+}
+
+TEST(ProfiledMutexTest, ConditionWaitIsNotHoldTime) {
+    ProfiledMutex mutex("m");
+    mutex.set_profiling(true);
+    std::condition_variable cv;
+    bool ready = false;
+    std::thread waiter([&] {
+        ProfiledLock lock(mutex, "waiter");
+        EXPECT_TRUE(lock.wait_for(cv, seconds(5), [&] { return ready; }));
+    });
+    std::this_thread::sleep_for(milliseconds(50));
+    {
+        ProfiledLock lock(mutex, "signal");
+        ready = true;
+    }
+    cv.notify_all();
+    waiter.join();
+    for (const auto& site : mutex.snapshot().sites) {
+        EXPECT_LT(site.maxHoldNs, 40000000u) << site.site;
+    }
+}
+
+TEST(ProfiledMutexTest, PoolReportsLocksWhenEnabled) {
+    PoolConfig config;
+    config.name = "locks";
+    config.driver = "fake";
+    config.initSize = 2;
+    config.maxSize = 2;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    auto pool = connection_pool::create(config, std::make_shared<FakeDriver>(options));
+    pool->getconnection();
+    EXPECT_TRUE(pool->metrics().locks.empty());
+
+    pool->updateConfig([](PoolConfig& c) { c.profileLocks = true; });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 200; i++) pool->getconnection();
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    PoolMetricsSnapshot m = pool->metrics();
+    ASSERT_FALSE(m.locks.empty());
+    const LockProfileSnapshot& lock = m.locks[0];
+    EXPECT_EQ(lock.name, "pool");
+    EXPECT_TRUE(lock.enabled);
+    EXPECT_GE(lock.acquisitions, 1600u); // acquire and release per borrow
+    bool acquireSite = false;
+    for (const auto& site : lock.sites) acquireSite = acquireSite || std::string(site.site) == "acquire";
+    EXPECT_TRUE(acquireSite);
+    std::string text = renderPrometheus({m});
+    EXPECT_NE(text.find("connection_pool_lock_acquisitions_total{pool=\"locks\",lock=\"pool\"}"), std::string::npos);
+    EXPECT_NE(text.find("connection_pool_lock_max_hold_seconds{pool=\"locks\",lock=\"pool\",site=\"acquire\"}"),
+              std::string::npos);
+    EXPECT_NE(renderJson({m}).find("\"locks\":[{\"name\":\"pool\",\"enabled\":true"), std::string::npos);
+    pool->updateConfig([](PoolConfig& c) { c.profileLocks = false; });
+}
@@ -0,0 +1,128 @@
+/*
+* @Description: Sampled latency breakdown per statement and per fingerprint
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "QueryProfiler.h"
+
+using namespace std::chrono;
+
+namespace {
+
+std::shared_ptr<connection_pool> fakePool(int sampling) {
+    PoolConfig config;
+    config.name = "timing";
+    config.driver = "fake";
+    config.initSize = 1;
+    config.maxSize = 1;
+    config.validateOnBorrow = true;
+    config.validationInterval = milliseconds(0); // ping on every borrow, the network estimate
+    config.queryTimingSampling = sampling;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.pingLatency = LatencyDistribution::fixed(microseconds(500));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(3000));
+    options.rowsPerQuery = 100;
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+} // namespace
+
+TEST(QueryProfilerTest, SplitsRoundTrip) {
+    QueryPhases p = QueryProfiler::split(100, 1000, 300, 200);
+    EXPECT_EQ(p.waitUs, 100u);
+    EXPECT_EQ(p.networkUs, 500u); // ping plus result transfer
+    EXPECT_EQ(p.serverUs, 500u);
+    p = QueryProfiler::split(0, 400, 0, 900); // ping slower than the statement
+    EXPECT_EQ(p.networkUs, 400u);
+    EXPECT_EQ(p.serverUs, 0u);
+    p = QueryProfiler::split(0, 400, 0, 0);  // never pinged
+    EXPECT_EQ(p.serverUs, 400u);
+}
+
+TEST(QueryProfilerTest, BreakdownPerFingerprint) {
+    auto pool = fakePool(1);
+    std::mutex mutex;
+    std::vector<QuerySpan> spans;
+    pool->setQuerySpanCallback([&](const QuerySpan& span) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spans.push_back(span);
+    });
+    for (int i = 0; i < 5; i++) {
+        auto conn = pool->getconnection();
+        auto rows = conn->select("SELECT c FROM t WHERE id=" + std::to_string(i));
+        ASSERT_NE(rows, nullptr);
+        while (rows->next()) {}
+        rows.reset();
+        EXPECT_TRUE(conn->update("UPDATE t SET k=k+1 WHERE id=" + std::to_string(i)));
+    }
+    pool->setQuerySpanCallback(nullptr);
+
+    ASSERT_EQ(spans.size(), 10u);
+    const QuerySpan& select = spans[0];
+    EXPECT_EQ(select.normalized, "select c from t where id=?");
+    EXPECT_EQ(select.rows, 100u);
+    EXPECT_TRUE(select.ok);
+    EXPECT_GE(select.phases.networkUs, 400u);
+    EXPECT_GE(select.phases.serverUs, 2000u);
+    EXPECT_EQ(select.phases.totalUs,
+              select.phases.waitUs + select.phases.networkUs + select.phases.serverUs + select.phases.decodeUs);
+    EXPECT_EQ(spans[1].rows, 1u); // affected
+    EXPECT_EQ(spans[1].phases.waitUs, 0u); // charged to the lease's first statement only
+
+    auto timings = pool->metrics().queryTimings;
+    ASSERT_EQ(timings.size(), 2u);
+    for (const auto& t : timings) {
+        EXPECT_EQ(t.samples, 5u);
+        EXPECT_GE(t.totalUs, 5u * 3000);
+        EXPECT_GE(t.maxTotalUs, 3000u);
+    }
+    std::string text = renderPrometheus({pool->metrics()});
+    EXPECT_NE(text.find("connection_pool_query_phase_seconds_total{pool=\"timing\",fingerprint=\""), std::string::npos);
+    EXPECT_NE(renderJson({pool->metrics()}).find("\"statement\":\"select c from t where id=?\""), std::string::npos);
+}
+
+TEST(QueryProfilerTest, SamplesOneInN) {
+    auto pool = fakePool(4);
+    pool->updateConfig([](PoolConfig& c) { c.queryTimingSampling = 0; });
+    auto conn = pool->getconnection();
+    conn->update("UPDATE t SET k=0");
+    EXPECT_TRUE(pool->metrics().queryTimings.empty());
+
+    pool->updateConfig([](PoolConfig& c) { c.queryTimingSampling = 4; });
+    for (int i = 0; i < 40; i++) conn->update("UPDATE t SET k=" + std::to_string(i));
+    auto timings = pool->metrics().queryTimings;
+    ASSERT_EQ(timings.size(), 1u);
+    EXPECT_EQ(timings[0].samples, 10u);
+}
+
+TEST(QueryProfilerTest, BoundedCardinality) {
+    auto profiler = std::make_shared<QueryProfiler>();
+    const size_t extra = 100;
+    for (size_t i = 0; i < QueryProfiler::kMaxFingerprints + extra; i++) {
+        QuerySpan span;
+        span.sql = "SELECT c" + std::to_string(i) + " FROM t";
+        span.phases.serverUs = 10;
+        profiler->record(span);
+    }
+    auto all = profiler->top(QueryProfiler::kMaxFingerprints + extra);
+    // One overflow row for the whole table, not one per shard
+    ASSERT_EQ(all.size(), QueryProfiler::kMaxFingerprints + 1);
+    EXPECT_EQ(all[0].normalized, "(other)");
+    EXPECT_EQ(all[0].fingerprint, 0u);
+    EXPECT_EQ(all[0].samples, extra);
+
+    profiler->reset();
+    EXPECT_TRUE(profiler->top(10).empty());
+}
@@ -0,0 +1,112 @@
+/*
+* @Description: SQL fingerprints and query trace capture round trip
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "QueryTrace.h"
+#include "SqlFingerprint.h"
+
+using namespace std::chrono;
+
+TEST(SqlFingerprintTest, SameShapeSameHash) {
+    auto a = fingerprintSql("SELECT * FROM t WHERE id IN (1,2,3) AND name='x'");
+    auto b = fingerprintSql("select *\n  from t -- comment\n where id in ( 7 , 8 ) and name = 'it''s'");
+    EXPECT_EQ(a.normalized, "select * from t where id in(?) and name=?");
+    EXPECT_EQ(a.normalized, b.normalized);
+    EXPECT_EQ(a.hash, b.hash);
+    EXPECT_NE(a.paramsHash, b.paramsHash);
+    EXPECT_EQ(a.paramsHash, fingerprintSql("SELECT * FROM t WHERE id IN (1,2,3) AND name='x'").paramsHash);
+}
+
+TEST(SqlFingerprintTest, LiteralsAndIdentifiers) {
+    EXPECT_EQ(fingerprintSql("INSERT INTO t1 (a,b) VALUES (1,'a'),(2,'b'), (3,'c');").normalized,
+              "insert into t1(a,b) values(?)");
+    EXPECT_EQ(fingerprintSql("UPDATE `Users` SET v=v+1, f=-2.5e3 /* x */ WHERE k=0x1F").normalized,
+              "update `Users` set v=v+?,f=? where k=?");
+    EXPECT_EQ(fingerprintSql("select c2 from t3 where x=\"a\\\"b\"").normalized, "select c2 from t3 where x=?");
+    EXPECT_NE(fingerprintSql("select a from t").hash, fingerprintSql("select b from t").hash);
+}
+
+TEST(QueryTraceTest, CaptureRoundTrip) {
+    const char* file = "query_trace_test.trace";
+    PoolConfig config;
+    config.driver = "fake";
+    config.initSize = 2;
+    config.maxSize = 2;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(100));
+    options.rowsPerQuery = 3;
+    auto pool = connection_pool::create(config, std::make_shared<FakeDriver>(options));
+
+    auto& trace = QueryTrace::instance();
+    ASSERT_TRUE(trace.start(file));
+    EXPECT_FALSE(trace.start(file)); // already tracing
+    for (int i = 0; i < 10; i++) {
+        auto conn = pool->getconnection();
+        auto rows = conn->select("SELECT c FROM t WHERE id=" + std::to_string(i));
+        ASSERT_NE(rows, nullptr);
+        EXPECT_TRUE(conn->update("UPDATE t SET k=k+1 WHERE id=" + std::to_string(i)));
+    }
+    trace.stop();
+    EXPECT_FALSE(trace.enabled());
+    EXPECT_EQ(trace.dropped(), 0u);
+    // Not traced any more
+    pool->getconnection()->update("UPDATE t SET k=0");
+
+    TraceFile loaded = loadTrace(file);
+    std::remove(file);
+    ASSERT_EQ(loaded.records.size(), 40u);
+    EXPECT_EQ(trace.recorded(), 40u);
+    ASSERT_EQ(loaded.text.size(), 2u);
+    uint64_t select = fingerprintSql("SELECT c FROM t WHERE id=1").hash;
+    EXPECT_EQ(loaded.text[select], "select c from t where id=?");
+    int borrows = 0, returns = 0, queries = 0, updates = 0;
+    uint64_t previousParams = 0;
+    for (const auto& r : loaded.records) {
+        switch (static_cast<TraceKind>(r.kind)) {
+        case TraceKind::BORROW: borrows++; break;
+        case TraceKind::RETURN: returns++; break;
+        case TraceKind::QUERY:
+            queries++;
+            EXPECT_EQ(r.fingerprint, select);
+            EXPECT_EQ(r.resultSize, 3u);
+            EXPECT_GE(r.durationUs, 100u);
+            EXPECT_NE(r.paramsHash, previousParams);
+            previousParams = r.paramsHash;
+            break;
+        case TraceKind::UPDATE: updates++; EXPECT_EQ(r.resultSize, 1u); break;
+        default: ADD_FAILURE() << "unexpected kind " << int(r.kind);
+        }
+        EXPECT_TRUE(r.ok);
+    }
+    EXPECT_EQ(borrows, 10);
+    EXPECT_EQ(returns, 10);
+    EXPECT_EQ(queries, 10);
+    EXPECT_EQ(updates, 10);
+    // One thread, in time order
+    for (size_t i = 1; i < loaded.records.size(); i++) {
+        EXPECT_EQ(loaded.records[i].thread, loaded.records[0].thread);
+        EXPECT_LE(loaded.records[i - 1].timeUs, loaded.records[i].timeUs);
+    }
+}
+
+TEST(QueryTraceTest, RejectsOtherFiles) {
+    const char* file = "not_a_trace.bin";
+    std::FILE* f = std::fopen(file, "wb");
+    std::fputs("definitely not a query trace file", f);
+    std::fclose(f);
+    EXPECT_THROW(loadTrace(file), std::runtime_error);
+    std::remove(file);
+    EXPECT_THROW(loadTrace("missing.trace"), std::runtime_error);
+}
@@ -0,0 +1,122 @@
+/*
+* @Description: Result memory accounting: charging buffered results and the wait, stream and fail policies
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+
+using namespace std::chrono;
+
+namespace {
+
+// Three one byte rows: (1 + 1) + 2 pointers each
+constexpr uint64_t kResultBytes = 3 * (2 + 2 * sizeof(char*));
+
+std::shared_ptr<connection_pool> fakePool(uint64_t budget, PoolConfig::ResultMemoryPolicy policy) {
+    PoolConfig config;
+    config.name = "memory";
+    config.driver = "fake";
+    config.initSize = 2;
+    config.maxSize = 2;
+    config.connectionTimeout = milliseconds(50);
+    config.resultMemoryBudget = budget;
+    config.resultMemoryPolicy = policy;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    options.rowsPerQuery = 3;
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+} // namespace
+
+TEST(ResultMemoryTest, ChargesBufferedResultsUntilDestroyed) {
+    auto pool = fakePool(1 << 20, PoolConfig::ResultMemoryPolicy::WAIT);
+    auto conn = pool->getconnection();
+    auto rows = conn->select("SELECT v FROM t");
+    ASSERT_NE(rows, nullptr);
+    EXPECT_EQ(rows->memoryBytes(), kResultBytes);
+    EXPECT_EQ(pool->metrics().resultMemoryBytes, kResultBytes);
+    {
+        auto streamed = conn->select("SELECT v FROM t", true);
+        ASSERT_NE(streamed, nullptr);
+        EXPECT_EQ(pool->metrics().resultMemoryBytes, kResultBytes); // not buffered, not charged
+        while (streamed->next()) {}
+    }
+    std::string text = renderPrometheus({pool->metrics()});
+    EXPECT_NE(text.find("connection_pool_result_memory_bytes{pool=\"memory\"} " + std::to_string(kResultBytes)),
+              std::string::npos);
+    EXPECT_NE(text.find("connection_pool_result_memory_budget_bytes{pool=\"memory\"} 1048576"), std::string::npos);
+    rows.reset();
+    EXPECT_EQ(pool->metrics().resultMemoryBytes, 0u);
+}
+
+TEST(ResultMemoryTest, NothingChargedWithoutABudget) {
+    auto pool = fakePool(0, PoolConfig::ResultMemoryPolicy::WAIT);
+    auto conn = pool->getconnection();
+    auto rows = conn->select("SELECT v FROM t");
+    ASSERT_NE(rows, nullptr);
+    EXPECT_EQ(pool->metrics().resultMemoryBytes, 0u);
+}
+
+TEST(ResultMemoryTest, StreamsOverBudget) {
+    auto pool = fakePool(1, PoolConfig::ResultMemoryPolicy::STREAM);
+    auto conn = pool->getconnection();
+    auto held = conn->select("SELECT v FROM t");
+    ASSERT_NE(held, nullptr);
+    auto other = pool->getconnection();
+    auto rows = other->select("SELECT v FROM t");
+    ASSERT_NE(rows, nullptr);
+    int read = 0;
+    while (rows->next()) read++;
+    EXPECT_EQ(read, 3);
+    auto m = pool->metrics();
+    EXPECT_EQ(m.resultMemoryBytes, kResultBytes);
+    EXPECT_EQ(m.resultMemoryStreamed, 1u);
+    EXPECT_EQ(m.resultMemoryRejected, 0u);
+}
+
+TEST(ResultMemoryTest, FailsOverBudget) {
+    auto pool = fakePool(1, PoolConfig::ResultMemoryPolicy::FAIL);
+    auto conn = pool->getconnection();
+    auto held = conn->select("SELECT v FROM t");
+    ASSERT_NE(held, nullptr);
+    EXPECT_EQ(conn->select("SELECT v FROM t"), nullptr);
+    EXPECT_NE(conn->select("SELECT v FROM t", true), nullptr); // streamed selects are never held back
+    EXPECT_EQ(pool->metrics().resultMemoryRejected, 1u);
+    held.reset();
+    EXPECT_NE(conn->select("SELECT v FROM t"), nullptr);
+}
+
+TEST(ResultMemoryTest, WaitsForRelease) {
+    auto pool = fakePool(1, PoolConfig::ResultMemoryPolicy::WAIT);
+    auto conn = pool->getconnection();
+    auto held = conn->select("SELECT v FROM t");
+    ASSERT_NE(held, nullptr);
+
+    // Nothing released within connectionTimeout
+    auto other = pool->getconnection();
+    EXPECT_EQ(other->select("SELECT v FROM t"), nullptr);
+    EXPECT_EQ(pool->metrics().resultMemoryRejected, 1u);
+
+    std::thread releaser([&held] {
+        std::this_thread::sleep_for(milliseconds(10));
+        held.reset();
+    });
+    auto rows = other->select("SELECT v FROM t");
+    releaser.join();
+    ASSERT_NE(rows, nullptr);
+    auto m = pool->metrics();
+    EXPECT_EQ(m.resultMemoryWaits, 2u);
+    EXPECT_EQ(m.resultMemoryRejected, 1u);
+    EXPECT_EQ(m.resultMemoryBytes, kResultBytes);
+    EXPECT_NE(renderJson({m}).find("\"result_memory_waits_total\":2"), std::string::npos);
+}
@@ -0,0 +1,149 @@
+/*
+* @Description: Streamed rows through a bounded ring of batches: order, read ahead bound, cancel and errors
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "RowStream.h"
+
+using namespace std::chrono;
+
+namespace {
+
+// Numbered rows made up on the fly, "i" and a NULL; counts how many the reader fetched
+class CountingResultSet : public ResultSet {
+public:
+    CountingResultSet(uint64_t rows, std::atomic<uint64_t>& fetched, bool breaks = false)
+        : _rows(rows), _fetched(fetched), _breaks(breaks) {}
+    bool next() override {
+        if (_index == _rows) {
+            _failed = _breaks;
+            return false;
+        }
+        _value = std::to_string(_index++);
+        _fetched++;
+        return true;
+    }
+    unsigned int fieldCount() const override { return 2; }
+    const char* field(unsigned int index) const override { return index == 0 ? _value.c_str() : nullptr; }
+    unsigned long fieldLength(unsigned int index) const override { return index == 0 ? _value.size() : 0; }
+    bool failed() const override { return _failed; }
+
+private:
+    uint64_t _rows;
+    uint64_t _index = 0;
+    std::string _value;
+    std::atomic<uint64_t>& _fetched;
+    bool _breaks;
+    bool _failed = false;
+};
+
+std::shared_ptr<connection_pool> fakePool(FakeDriverOptions options) {
+    PoolConfig config;
+    config.name = "stream";
+    config.driver = "fake";
+    config.initSize = 1;
+    config.maxSize = 1;
+    config.statementStats = true;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(0));
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+} // namespace
+
+TEST(RowStreamTest, DeliversEveryRowInOrder) {
+    std::atomic<uint64_t> fetched{0};
+    const uint64_t total = 10 * RowStream::kBatchRows + 7;
+    RowStream stream(std::make_unique<CountingResultSet>(total, fetched));
+    uint64_t expected = 0;
+    RowStream::Status status = stream.run([&](const StreamRow& row) {
+        EXPECT_EQ(row.fieldCount(), 2u);
+        EXPECT_EQ(std::string(row.field(0), row.fieldLength(0)), std::to_string(expected));
+        EXPECT_EQ(row.field(0)[row.fieldLength(0)], '\0');
+        EXPECT_EQ(row.field(1), nullptr);
+        expected++;
+        return true;
+    });
+    EXPECT_EQ(status, RowStream::Status::FINISHED);
+    EXPECT_EQ(expected, total);
+    EXPECT_EQ(stream.rows(), total);
+}
+
+TEST(RowStreamTest, ReadAheadIsBoundedByTheRing) {
+    std::atomic<uint64_t> fetched{0};
+    uint64_t consumed = 0;
+    uint64_t ahead = 0;
+    RowStream stream(std::make_unique<CountingResultSet>(20 * RowStream::kBatchRows, fetched));
+    stream.run([&](const StreamRow&) {
+        if (consumed % RowStream::kBatchRows == 0)
+            std::this_thread::sleep_for(milliseconds(1)); // slower than the reader
+        ahead = std::max(ahead, fetched.load() - consumed);
+        consumed++;
+        return true;
+    });
+    EXPECT_GT(ahead, RowStream::kBatchRows); // it did read ahead
+    EXPECT_LE(ahead, RowStream::kBatches * RowStream::kBatchRows);
+}
+
+TEST(RowStreamTest, OutsizedRowGetsItsOwnBatch) {
+    std::string big(RowStream::kBatchBytes * 3, 'x');
+    FakeDriverOptions options;
+    options.handler = [&big](const std::string&) { return FakeRows{{"a"}, {big}, {"b"}}; };
+    auto pool = fakePool(options);
+    auto conn = pool->getconnection();
+    std::vector<size_t> sizes;
+    auto status = conn->queryStream("SELECT v FROM t", [&](const StreamRow& row) {
+        sizes.push_back(row.fieldLength(0));
+        return true;
+    });
+    EXPECT_EQ(status, RowStream::Status::FINISHED);
+    EXPECT_EQ(sizes, (std::vector<size_t>{1, big.size(), 1}));
+}
+
+TEST(RowStreamTest, CallbackStopsTheStream) {
+    FakeDriverOptions options;
+    options.rowsPerQuery = 5000;
+    auto pool = fakePool(options);
+    auto conn = pool->getconnection();
+    uint64_t seen = 0;
+    auto status = conn->queryStream("SELECT v FROM t", [&](const StreamRow&) { return ++seen < 1500; });
+    EXPECT_EQ(status, RowStream::Status::CANCELLED);
+    EXPECT_EQ(seen, 1500u);
+
+    // The session was drained, the lease goes on
+    EXPECT_THROW(conn->queryStream("SELECT v FROM t", [](const StreamRow&) -> bool { throw std::runtime_error("stop"); }),
+                 std::runtime_error);
+    seen = 0;
+    EXPECT_EQ(conn->queryStream("SELECT v FROM t", [&](const StreamRow&) { return ++seen > 0; }),
+              RowStream::Status::FINISHED);
+    EXPECT_EQ(seen, 5000u);
+    auto stats = pool->statementStats();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].calls, 3u);
+    EXPECT_EQ(stats[0].errors, 0u);
+}
+
+TEST(RowStreamTest, ReportsFailures) {
+    std::atomic<uint64_t> fetched{0};
+    RowStream stream(std::make_unique<CountingResultSet>(100, fetched, true));
+    EXPECT_EQ(stream.run([](const StreamRow&) { return true; }), RowStream::Status::FAILED);
+    EXPECT_EQ(stream.rows(), 100u);
+
+    FakeDriverOptions options;
+    options.queryFailureRate = 1;
+    auto pool = fakePool(options);
+    auto conn = pool->getconnection();
+    EXPECT_EQ(conn->queryStream("SELECT v FROM t", [](const StreamRow&) { return true; }),
+              RowStream::Status::FAILED);
+}
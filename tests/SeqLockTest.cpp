@@ -0,0 +1,43 @@
+/*
+* @Description: SeqLock readers never observe a torn value
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SeqLock.hpp"
+
+namespace {
+struct Pair {
+    int64_t value;
+    int64_t negated;
+    int32_t odd[3];
+};
+}
+
+TEST(SeqLockTest, ReadersSeeWholeWrites) {
+    SeqLock<Pair> lock;
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            while (!done) {
+                Pair p = lock.load();
+                if (p.value != -p.negated || p.odd[2] != static_cast<int32_t>(p.value)) torn++;
+            }
+        });
+    }
+    for (int64_t i = 1; i <= 200000; i++) {
+        lock.store(Pair{i, -i, {0, 0, static_cast<int32_t>(i)}});
+    }
+    done = true;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(lock.load().value, 200000);
+}
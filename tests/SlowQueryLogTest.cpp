@@ -0,0 +1,144 @@
+/*
+* @Description: Slow query log: threshold, timing breakdown, call site and sampled EXPLAIN plans
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "SlowQueryLog.h"
+
+using namespace std::chrono;
+
+namespace {
+
+std::shared_ptr<connection_pool> fakePool(milliseconds threshold, int explainSampling) {
+    PoolConfig config;
+    config.name = "slow";
+    config.driver = "fake";
+    config.initSize = 1;
+    config.maxSize = 2;
+    config.slowQueryThreshold = threshold;
+    config.slowQueryExplainSampling = explainSampling;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(milliseconds(5));
+    options.handler = [](const std::string& sql) {
+        if (sql.compare(0, 20, "EXPLAIN FORMAT=JSON ") == 0) {
+            return FakeRows{{"{\n  \"query_block\": {\n    \"select_id\": 1,\n    \"message\": \"a b\"\n  }\n}"}};
+        }
+        return FakeRows{{"1"}};
+    };
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+// Lines of the sink once n entries were logged
+std::vector<std::string> waitForEntries(connection_pool& pool, RingSink& sink, uint64_t n) {
+    for (int i = 0; i < 200 && pool.metrics().slowQueries < n; i++) {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    sink.wait_idle();
+    return sink.snapshot();
+}
+
+} // namespace
+
+TEST(SlowQueryLogTest, LogsBreakdownCallSiteAndPlan) {
+    auto pool = fakePool(milliseconds(2), 1);
+    auto sink = std::make_shared<RingSink>(16);
+    pool->setSlowQuerySink(sink);
+    {
+        auto conn = pool->getconnection();
+        auto rows = conn->select("SELECT * FROM t WHERE id=5");
+        ASSERT_NE(rows, nullptr);
+    }
+    auto lines = waitForEntries(*pool, *sink, 1);
+    ASSERT_EQ(lines.size(), 1u);
+    const std::string& entry = lines[0];
+    EXPECT_NE(entry.find("[WARN] Slow query on pool slow"), std::string::npos) << entry;
+    EXPECT_NE(entry.find("server "), std::string::npos);
+    EXPECT_NE(entry.find(", 1 rows,"), std::string::npos);
+    EXPECT_NE(entry.find("  sql: SELECT * FROM t WHERE id=5"), std::string::npos);
+    EXPECT_NE(entry.find("  plan: {\"query_block\":{\"select_id\":1,\"message\":\"a b\"}}"), std::string::npos);
+    EXPECT_NE(entry.find("  at:\n  #0 "), std::string::npos);
+    auto m = pool->metrics();
+    EXPECT_EQ(m.slowQueries, 1u);
+    EXPECT_EQ(m.slowQueryPlans, 1u);
+    EXPECT_NE(renderPrometheus({m}).find("connection_pool_slow_query_plans_total{pool=\"slow\"} 1"), std::string::npos);
+}
+
+TEST(SlowQueryLogTest, LongStatementKeepsItsPlan) {
+    auto pool = fakePool(milliseconds(2), 1);
+    auto sink = std::make_shared<RingSink>(16);
+    pool->setSlowQuerySink(sink);
+    std::string sql = "SELECT * FROM t WHERE id IN (" + std::string(8000, '5') + ")";
+    {
+        auto conn = pool->getconnection();
+        ASSERT_NE(conn->select(sql), nullptr);
+    }
+    auto lines = waitForEntries(*pool, *sink, 1);
+    ASSERT_EQ(lines.size(), 1u);
+    // Cut short past the chunk size, the SQL text loses its tail, not the plan
+    EXPECT_NE(lines[0].find("  plan: {\"query_block\""), std::string::npos);
+    EXPECT_LT(lines[0].find("  plan: "), lines[0].find("  sql: SELECT * FROM t WHERE id IN (555"));
+}
+
+TEST(SlowQueryLogTest, ThresholdAndSampling) {
+    auto pool = fakePool(milliseconds(50), 2);
+    auto sink = std::make_shared<RingSink>(16);
+    pool->setSlowQuerySink(sink);
+    auto conn = pool->getconnection();
+    conn->update("UPDATE t SET k=1");
+    EXPECT_EQ(pool->metrics().slowQueries, 0u); // 5ms < 50ms
+
+    pool->updateConfig([](PoolConfig& c) { c.slowQueryThreshold = milliseconds(1); });
+    for (int i = 0; i < 4; i++) conn->update("UPDATE t SET k=" + std::to_string(i));
+    conn->update("SET NAMES utf8mb4"); // 5th slow one, sampled but cannot be explained
+    auto lines = waitForEntries(*pool, *sink, 5);
+    EXPECT_EQ(lines.size(), 5u);
+    EXPECT_EQ(pool->metrics().slowQueryPlans, 2u); // 1st and 3rd
+    size_t plans = 0;
+    for (const auto& line : lines) plans += line.find("  plan: ") != std::string::npos ? 1 : 0;
+    EXPECT_EQ(plans, 2u);
+
+    pool->updateConfig([](PoolConfig& c) { c.slowQueryThreshold = milliseconds(0); });
+    conn->update("UPDATE t SET k=9");
+    EXPECT_EQ(pool->metrics().slowQueries, 5u);
+}
+
+TEST(SlowQueryLogTest, WritesItsOwnFile) {
+    std::string path = ::testing::TempDir() + "slow_query_test.log";
+    std::remove(path.c_str());
+    auto pool = fakePool(milliseconds(1), 0);
+    pool->updateConfig([&path](PoolConfig& c) { c.slowQueryLog = path; });
+    pool->getconnection()->update("DELETE FROM t WHERE id=3");
+    pool.reset(); // drains the sink
+    std::ifstream file(path);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(text.find("sql: DELETE FROM t WHERE id=3"), std::string::npos) << text;
+    EXPECT_EQ(text.find("plan:"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(SlowQueryLogTest, Helpers) {
+    EXPECT_TRUE(SlowQueryLog::explainable("select * from t"));
+    EXPECT_TRUE(SlowQueryLog::explainable("(select a from t) union (select b from u)"));
+    EXPECT_TRUE(SlowQueryLog::explainable("with x as(select ?) select * from x"));
+    EXPECT_TRUE(SlowQueryLog::explainable("delete from t where id=?"));
+    EXPECT_FALSE(SlowQueryLog::explainable("set names ?"));
+    EXPECT_FALSE(SlowQueryLog::explainable("selection"));
+    EXPECT_FALSE(SlowQueryLog::explainable(""));
+    EXPECT_EQ(SlowQueryLog::compactJson("{\n  \"a\": \"x \\\" y\",\n  \"b\": [1, 2]\n}"),
+              "{\"a\":\"x \\\" y\",\"b\":[1,2]}");
+}
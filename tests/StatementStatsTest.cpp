@@ -0,0 +1,128 @@
+/*
+* @Description: Per fingerprint statement table: grouping, counts and its size bound
+* @Author: abellli
+* @Date: 2026-10-17
+* @LastEditTime: 2026-10-17
+*/
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "ConnectionPool.h"
+#include "FakeDriver.h"
+#include "StatementStats.h"
+
+using namespace std::chrono;
+
+namespace {
+
+std::shared_ptr<connection_pool> fakePool(bool statementStats, double failureRate = 0) {
+    PoolConfig config;
+    config.name = "stats";
+    config.driver = "fake";
+    config.initSize = 1;
+    config.maxSize = 1;
+    config.statementStats = statementStats;
+    FakeDriverOptions options;
+    options.connectLatency = LatencyDistribution::fixed(microseconds(0));
+    options.queryLatency = LatencyDistribution::fixed(microseconds(100));
+    options.queryFailureRate = failureRate;
+    options.rowsPerQuery = 3; // "1", "2", "3"
+    return connection_pool::create(config, std::make_shared<FakeDriver>(options));
+}
+
+} // namespace
+
+TEST(StatementStatsTest, GroupsByFingerprint) {
+    auto pool = fakePool(true);
+    auto conn = pool->getconnection();
+    size_t sent = 0;
+    for (int i = 0; i < 10; i++) {
+        std::string sql = "UPDATE t SET k = " + std::to_string(i * 31) + " WHERE id=" + std::to_string(i);
+        sent += sql.size();
+        EXPECT_TRUE(conn->update(sql));
+    }
+    std::string select = "SELECT v FROM t WHERE name = 'x'";
+    for (int i = 0; i < 2; i++) {
+        auto rows = conn->select(select, i == 1);
+        ASSERT_NE(rows, nullptr);
+        while (rows->next()) {}
+    }
+
+    auto stats = pool->statementStats();
+    ASSERT_EQ(stats.size(), 2u);
+    const StatementStat& update = stats[0].calls == 10 ? stats[0] : stats[1];
+    const StatementStat& read = stats[0].calls == 10 ? stats[1] : stats[0];
+    EXPECT_EQ(update.normalized, "update t set k=? where id=?");
+    EXPECT_EQ(update.calls, 10u);
+    EXPECT_EQ(update.errors, 0u);
+    EXPECT_EQ(update.rows, 10u);
+    EXPECT_EQ(update.bytes, sent);
+    EXPECT_GE(update.totalUs, 10u * 100);
+    EXPECT_GE(update.maxUs, 100u);
+    EXPECT_LE(update.meanUs(), update.maxUs);
+    EXPECT_EQ(read.normalized, "select v from t where name=?");
+    EXPECT_EQ(read.calls, 2u);
+    EXPECT_EQ(read.rows, 6u);
+    EXPECT_EQ(read.bytes, 2 * (select.size() + 3)); // three one byte values each
+
+    EXPECT_EQ(pool->metrics().statements.size(), 2u);
+    std::string text = renderPrometheus({pool->metrics()});
+    EXPECT_NE(text.find("connection_pool_statement_calls_total{pool=\"stats\",fingerprint=\""), std::string::npos);
+    EXPECT_NE(renderJson({pool->metrics()}).find("\"statement\":\"update t set k=? where id=?\",\"calls\":10"),
+              std::string::npos);
+
+    pool->resetStatementStats();
+    EXPECT_TRUE(pool->statementStats().empty());
+}
+
+TEST(StatementStatsTest, CountsErrors) {
+    auto pool = fakePool(true, 1.0);
+    auto conn = pool->getconnection();
+    EXPECT_FALSE(conn->update("DELETE FROM t WHERE id=1"));
+    EXPECT_EQ(conn->select("SELECT 1"), nullptr);
+    auto stats = pool->statementStats();
+    ASSERT_EQ(stats.size(), 2u);
+    for (const auto& s : stats) {
+        EXPECT_EQ(s.calls, 1u);
+        EXPECT_EQ(s.errors, 1u);
+        EXPECT_EQ(s.rows, 0u);
+    }
+}
+
+TEST(StatementStatsTest, OffByDefault) {
+    auto pool = fakePool(false);
+    pool->getconnection()->update("UPDATE t SET k=1");
+    EXPECT_TRUE(pool->statementStats().empty());
+    EXPECT_EQ(renderPrometheus({pool->metrics()}).find("connection_pool_statement_"), std::string::npos);
+
+    pool->updateConfig([](PoolConfig& c) { c.statementStats = true; });
+    pool->getconnection()->update("UPDATE t SET k=1");
+    EXPECT_EQ(pool->statementStats().size(), 1u);
+}
+
+TEST(StatementStatsTest, BoundedCardinality) {
+    auto stats = std::make_shared<StatementStats>();
+    const size_t extra = 100;
+    for (size_t i = 0; i < StatementStats::kMaxStatements + extra; i++) {
+        stats->record("SELECT c" + std::to_string(i) + " FROM t", 10, 1, 20, true);
+    }
+    EXPECT_EQ(stats->size(), StatementStats::kMaxStatements);
+    auto all = stats->top(StatementStats::kMaxStatements + extra);
+    ASSERT_EQ(all.size(), StatementStats::kMaxStatements + 1);
+    EXPECT_EQ(all[0].normalized, "(other)"); // 100 calls, the most total time
+    EXPECT_EQ(all[0].fingerprint, 0u);
+    EXPECT_EQ(all[0].calls, extra);
+
+    // Known shapes are still counted in their own row
+    stats->record("SELECT c7 FROM t", 10, 1, 20, true);
+    auto top = stats->top(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[1].normalized, "select c7 from t");
+    EXPECT_EQ(top[1].calls, 2u);
+
+    stats->reset();
+    EXPECT_EQ(stats->size(), 0u);
+    EXPECT_TRUE(stats->top(10).empty());
+}